@@ -0,0 +1,687 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Benchmark: runs the simulation headless on generated scenarios and
+ *  reports how fast it ticks. A scenario is a map size, a count of AI
+ *  characters, a bomb density and a chain length. Its map is the classic
+ *  layout of walls on the border and pillars every other cell, strewn with
+ *  rocks, one bomber in the top-left corner and the AI on random floor
+ *  cells. Every BENCH_WAVE_TICKS, a wave of bombs is dropped in chains along
+ *  the open rows, one bomb per tick and each in the blast range of the
+ *  last, so every chain goes off as a chain reaction. The same scenario and
+ *  seed always play the same ticks, which keeps runs from different builds
+ *  comparable.
+ *
+ *  Each scenario starts from a fresh world and is warmed up for one wave
+ *  before BENCH_DEFAULT_TICKS ticks are timed one by one. Besides the ticks
+ *  per second and the p50, p99 and worst tick times, the allocations per
+ *  tick are counted on the SDL heap (wrapped with SDL_SetMemoryFunctions)
+ *  and on the flecs one (its own counters). M*LIB containers allocate from
+ *  the C library directly and are not counted.
+ *
+ *  With --render, the dynamic layer (characters, bombs and explosions) is
+ *  also drawn after every timed tick, with the SDL software renderer into an
+ *  offscreen surface, so it runs on a box without a display or a GPU. The
+ *  sprites are gathered by the game's map view, then drawn twice from its
+ *  atlas texture: once sprite by sprite, one draw call each, then through
+ *  the map view's sprite_batch, as the game does. Both are timed up to the
+ *  pixels being written, and their draw calls counted. Maps too big for a
+ *  BENCH_MAX_TARGET target are drawn scaled down, the sprite count is what
+ *  matters.
+ *
+ *  The results go to stdout as one JSON object per line and scenario, for
+ *  scripts to compare, and a readable summary to the log.
+ *
+ *  Usage: bomberman_bench [--ticks n] [--seed n] [--render]
+ *                         [--scenario name]
+ *         bomberman_bench [--ticks n] [--seed n] [--render] --size <w>x<h>
+ *                         --ais n --bombs density --chain length
+ *  The first form runs the built-in suite, or one scenario of it. The second
+ *  runs a single custom scenario, the density being the share of the cells
+ *  bombed by each wave. */
+
+#include <stdio.h>
+
+#include "SDL3/SDL.h"
+
+/* Simulation library (game rules, prefabs, map). Pulls in Pluto. */
+#include "sim.h"
+
+/* Offscreen Pluto core, and the input callbacks it expects. */
+#include "offscreen.h"
+
+#include "map_view.h"
+
+/* Game modules dependencies. */
+#include "log.h"
+Sint32 DEBUG_LOG
+    = DEBUG_LOG_NONE; /* Minimum log level for debug_log calls to print. */
+
+#define BENCH_DEFAULT_TICKS 3000u
+#define BENCH_DEFAULT_SEED 1u
+#define BENCH_WAVE_TICKS 180u /* Longer than a fuse and its explosions. */
+#define BENCH_ROCK_PERCENT 30u /* Free floor cells starting as rocks. */
+#define BENCH_MIN_SIZE 7
+#define BENCH_MAX_SIZE 4095
+#define BENCH_STREAM_MAP 0u /* Random streams of the generator. */
+#define BENCH_STREAM_BOMBS 1u
+#define BENCH_GFX_DIR "dat/gfx"
+#define BENCH_MAX_TARGET 2048 /* Pixels per side of the render target. */
+
+struct bench_scenario
+{
+  const char *name;
+  Sint32 w;
+  Sint32 h;
+  Sint32 ai_count;
+  float bomb_density;
+  Sint32 chain_length;
+};
+
+/* The built-in suite, from a match-sized arena up to a huge one. */
+static const struct bench_scenario bench_suite[] = {
+  { "classic", 15, 15, 8, 0.01f, 2 },
+  { "classic_chains", 31, 15, 16, 0.02f, 8 },
+  { "medium_crowd", 127, 127, 1024, 0.002f, 2 },
+  { "medium_chains", 127, 127, 128, 0.01f, 24 },
+  { "large_crowd", 511, 511, 16384, 0.001f, 4 },
+  { "large_chains", 511, 511, 2048, 0.005f, 48 },
+};
+
+#define BENCH_SUITE_COUNT                                                    \
+  ((Sint32)(sizeof (bench_suite) / sizeof (bench_suite[0])))
+
+struct options
+{
+  Uint32 ticks;
+  Uint64 seed;
+  const char *scenario; /* One scenario of the suite, or NULL for all. */
+  bool b_renders;
+  bool b_is_custom;
+  struct bench_scenario custom;
+};
+
+struct bench_result
+{
+  double seconds;
+  Uint64 p50; /* Tick times, in performance counter units. */
+  Uint64 p99;
+  Uint64 max;
+  Uint64 sdl_allocations;
+  Uint64 ecs_allocations;
+  Uint64 bombs;
+  Uint64 explosions;
+  Uint64 sprites; /* Drawn over the run, --render only. */
+  Uint64 single_p50; /* Frame times sprite by sprite, like p50. */
+  Uint64 single_p99;
+  Uint64 batch_p50; /* Frame times through the sprite batch. */
+  Uint64 batch_p99;
+  Uint64 single_calls;
+  Uint64 batch_calls;
+};
+
+/* Drawing side of the benchmark, see --render. */
+struct bench_renderer
+{
+  SDL_Surface *surface;
+  SDL_Renderer *renderer;
+  struct map_view view; /* The whole map in sight, from its corner. */
+};
+
+ARRAY_DEF (arr_point, SDL_Point, M_POD_OPLIST)
+
+static SDL_AtomicInt sdl_allocations;
+static SDL_malloc_func original_malloc;
+static SDL_calloc_func original_calloc;
+static SDL_realloc_func original_realloc;
+static SDL_free_func original_free;
+
+static void *
+counting_malloc (size_t size)
+{
+  SDL_AddAtomicInt (&sdl_allocations, 1);
+  return original_malloc (size);
+}
+
+static void *
+counting_calloc (size_t count, size_t size)
+{
+  SDL_AddAtomicInt (&sdl_allocations, 1);
+  return original_calloc (count, size);
+}
+
+static void *
+counting_realloc (void *mem, size_t size)
+{
+  SDL_AddAtomicInt (&sdl_allocations, 1);
+  return original_realloc (mem, size);
+}
+
+static Uint64
+count_ecs_allocations (void)
+{
+  return (Uint64)(ecs_os_api_malloc_count + ecs_os_api_calloc_count
+                  + ecs_os_api_realloc_count);
+}
+
+static int
+compare_ticks (const void *a, const void *b)
+{
+  const Uint64 lhs = *(const Uint64 *)a;
+  const Uint64 rhs = *(const Uint64 *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+/**
+ * Lays out the map of a scenario: walls on the border, pillars on the cells
+ * with both coordinates even, rocks on a share of the rest, and the spawns.
+ * The corner the bomber starts in is kept clear.
+ * @return false if the map could not be allocated.
+ */
+static bool
+generate_map (const struct bench_scenario *scenario, Uint64 seed,
+              struct map *map)
+{
+  const Sint32 w = scenario->w;
+  const Sint32 h = scenario->h;
+  map->spawns = SDL_malloc (((size_t)scenario->ai_count + 1u)
+                            * sizeof (struct map_spawn));
+  if (map->spawns == NULL || grid_init (&map->grid, w, h) == false)
+    {
+      map_free (map);
+      return false;
+    }
+
+  struct rng_stream rng;
+  rng_stream_init (&rng, seed, BENCH_STREAM_MAP);
+  for (Sint32 y = 0; y < h; y++)
+    {
+      for (Sint32 x = 0; x < w; x++)
+        {
+          if (grid_populate (&map->grid, x, y) == false)
+            {
+              map_free (map);
+              return false;
+            }
+          Uint8 flags = 0u;
+          if (x == 0 || y == 0 || x == w - 1 || y == h - 1
+              || (x % 2 == 0 && y % 2 == 0))
+            {
+              flags = GRID_CELL_BLOCKED;
+            }
+          else if (x + y > 3
+                   && rng_bounded (rng_stream_next (&rng), 100u)
+                          < BENCH_ROCK_PERCENT)
+            {
+              flags = GRID_CELL_BLOCKED | GRID_CELL_ROCK;
+            }
+          map->grid.cells[grid_index (&map->grid, x, y)] = flags;
+        }
+    }
+
+  map->spawns[map->spawn_count++]
+      = (struct map_spawn){ .x = 1, .y = 1, .prefab = MAP_PREFAB_BOMBER };
+
+  /* Floor cells are drawn at random, a crowded map may end up with fewer
+   * characters than asked rather than searching forever. */
+  const Sint64 attempts = (Sint64)scenario->ai_count * 64;
+  for (Sint64 i = 0; i < attempts && map->spawn_count <= scenario->ai_count;
+       i++)
+    {
+      const Sint32 x = (Sint32)rng_bounded (rng_stream_next (&rng), (Uint32)w);
+      const Sint32 y = (Sint32)rng_bounded (rng_stream_next (&rng), (Uint32)h);
+      if (x + y > 3 && grid_get (&map->grid, x, y) == 0u)
+        {
+          const Sint32 prefab
+              = MAP_PREFAB_CURSED_BALLOON + map->spawn_count % 3;
+          map->spawns[map->spawn_count++]
+              = (struct map_spawn){ .x = x, .y = y, .prefab = prefab };
+        }
+    }
+  return true;
+}
+
+/**
+ * Picks where the chains of a wave start: on the open rows (odd ones), far
+ * enough from the right wall for the whole chain when the map allows it.
+ */
+static void
+plan_wave (const struct bench_scenario *scenario, struct rng_stream *rng,
+           arr_point_t chains)
+{
+  arr_point_reset (chains);
+  if (scenario->bomb_density <= 0.f)
+    {
+      return;
+    }
+
+  const double bombs = (double)scenario->bomb_density * scenario->w
+                       * scenario->h;
+  const Sint32 count
+      = SDL_max ((Sint32)(bombs / scenario->chain_length + 0.5), 1);
+  const Sint32 span = (scenario->chain_length - 1) * BOMB_DEFAULT_BLAST_RANGE;
+  const Sint32 columns = SDL_max (scenario->w - 2 - span, 1);
+  const Sint32 rows = (scenario->h - 1) / 2;
+  for (Sint32 i = 0; i < count; i++)
+    {
+      SDL_Point start;
+      start.x = 1 + (Sint32)rng_bounded (rng_stream_next (rng),
+                                         (Uint32)columns);
+      start.y = 1 + 2 * (Sint32)rng_bounded (rng_stream_next (rng),
+                                             (Uint32)rows);
+      arr_point_push_back (chains, start);
+    }
+}
+
+/**
+ * Drops the bombs of a wave due on a tick: the step-th bomb of every chain.
+ * Cells that are blocked, rocks included, are skipped.
+ */
+static void
+drop_bombs (ecs_world_t *world, const struct bench_scenario *scenario,
+            arr_point_t chains, Uint32 step)
+{
+  if ((Sint32)step >= scenario->chain_length)
+    {
+      return;
+    }
+
+  for (size_t i = 0; i < arr_point_size (chains); i++)
+    {
+      const SDL_Point *start = arr_point_cget (chains, i);
+      const Sint32 x = start->x + (Sint32)step * BOMB_DEFAULT_BLAST_RANGE;
+      place_bomb (world, 0u, x, start->y);
+    }
+}
+
+/**
+ * Sets up an offscreen software renderer big enough for the map, scaled
+ * down past BENCH_MAX_TARGET, and a map view of it.
+ * @return false if any of it failed.
+ */
+static bool
+open_renderer (struct bench_renderer *bench, ecs_world_t *world,
+               const struct bench_scenario *scenario)
+{
+  SDL_zerop (bench);
+  const SDL_FPoint size = { (float)(scenario->w * CELL_SIZE),
+                            (float)(scenario->h * CELL_SIZE) };
+  const float scale
+      = SDL_min (1.f, (float)BENCH_MAX_TARGET / SDL_max (size.x, size.y));
+  bench->surface = SDL_CreateSurface ((int)SDL_ceilf (size.x * scale),
+                                      (int)SDL_ceilf (size.y * scale),
+                                      SDL_PIXELFORMAT_RGBA32);
+  if (bench->surface != NULL)
+    {
+      bench->renderer = SDL_CreateSoftwareRenderer (bench->surface);
+    }
+  if (bench->renderer == NULL
+      || SDL_SetRenderScale (bench->renderer, scale, scale) == false
+      || map_view_init (&bench->view, world, bench->renderer, BENCH_GFX_DIR)
+             == false)
+    {
+      return false;
+    }
+  bench->view.size = size;
+  return true;
+}
+
+static void
+close_renderer (struct bench_renderer *bench)
+{
+  map_view_free (&bench->view);
+  SDL_DestroyRenderer (bench->renderer);
+  SDL_DestroySurface (bench->surface);
+  SDL_zerop (bench);
+}
+
+/**
+ * Draws the gathered sprites, one by one or batched, over a cleared target.
+ * @return the time it took to get them all written, in performance counter
+ * units.
+ */
+static Uint64
+draw_sprites (struct bench_renderer *bench, bool b_is_batched, Uint64 *calls)
+{
+  SDL_SetRenderDrawColor (bench->renderer, 0, 0, 0, 255);
+  SDL_RenderClear (bench->renderer);
+  SDL_FlushRenderer (bench->renderer);
+
+  const struct map_view *view = &bench->view;
+  const size_t count = arr_view_sprite_size (view->sprites);
+  const Uint64 start = SDL_GetPerformanceCounter ();
+  if (b_is_batched == true)
+    {
+      *calls += (Uint64)map_view_draw_sprites (&bench->view);
+    }
+  else
+    {
+      for (size_t i = 0u; i < count; i++)
+        {
+          const struct map_view_sprite *sprite
+              = arr_view_sprite_cget (view->sprites, i);
+          SDL_RenderTexture (bench->renderer, view->sheets.texture,
+                             &sprite->src, &sprite->dst);
+        }
+      *calls += (Uint64)count;
+    }
+  SDL_FlushRenderer (bench->renderer);
+  return SDL_GetPerformanceCounter () - start;
+}
+
+/**
+ * Builds the world of a scenario, warms it up, then times its ticks.
+ * @return false if the scenario could not be set up.
+ */
+static bool
+run_scenario (const struct bench_scenario *scenario,
+              const struct options *options, struct bench_result *result)
+{
+  SDL_zerop (result);
+  struct map map = { 0 };
+  const size_t count = SDL_max (options->ticks, 1u);
+  Uint64 *times = SDL_malloc (3u * count * sizeof (Uint64));
+  if (times == NULL || generate_map (scenario, options->seed, &map) == false)
+    {
+      SDL_free (times);
+      return false;
+    }
+  Uint64 *single_times = times + count;
+  Uint64 *batch_times = times + 2u * count;
+
+  ecs_world_t *world = ecs_init ();
+  init_offscreen_pluto (world, &map.grid, "Doomsday (bench)");
+  init_sim (world);
+  seed_sim (world, options->seed);
+  create_map (world, &map);
+  create_bombers (world, &map, 1, 0);
+  create_characters (world, &map);
+  map_free (&map);
+
+  struct bench_renderer bench = { 0 };
+  if (options->b_renders == true
+      && open_renderer (&bench, world, scenario) == false)
+    {
+      SDL_Log ("Failed to set up drawing: %s", SDL_GetError ());
+      close_renderer (&bench);
+      fini_sim (world);
+      ecs_fini (world);
+      SDL_Quit ();
+      SDL_free (times);
+      return false;
+    }
+
+  struct rng_stream rng;
+  rng_stream_init (&rng, options->seed, BENCH_STREAM_BOMBS);
+  arr_point_t chains;
+  arr_point_init (chains);
+
+  const Uint32 total = BENCH_WAVE_TICKS + options->ticks;
+  Sint32 sdl_start = 0;
+  Sint32 sdl_drawing = 0; /* Allocations of the drawing, not of the ticks. */
+  Uint64 ecs_start = 0u;
+  for (Uint32 tick = 0u; tick < total; tick++)
+    {
+      const Uint32 step = tick % BENCH_WAVE_TICKS;
+      if (step == 0u)
+        {
+          plan_wave (scenario, &rng, chains);
+        }
+      drop_bombs (world, scenario, chains, step);
+
+      if (tick == BENCH_WAVE_TICKS)
+        {
+          sdl_start = SDL_GetAtomicInt (&sdl_allocations);
+          ecs_start = count_ecs_allocations ();
+        }
+      const Uint64 start = SDL_GetPerformanceCounter ();
+      tick_sim (world);
+      ecs_progress (world, 0.f);
+      const Uint64 end = SDL_GetPerformanceCounter ();
+      if (tick >= BENCH_WAVE_TICKS)
+        {
+          times[tick - BENCH_WAVE_TICKS] = end - start;
+          result->seconds += (double)(end - start);
+        }
+      if (tick >= BENCH_WAVE_TICKS && options->b_renders == true)
+        {
+          const Sint32 before = SDL_GetAtomicInt (&sdl_allocations);
+          map_view_gather (&bench.view, world);
+          single_times[tick - BENCH_WAVE_TICKS]
+              = draw_sprites (&bench, false, &result->single_calls);
+          batch_times[tick - BENCH_WAVE_TICKS]
+              = draw_sprites (&bench, true, &result->batch_calls);
+          result->sprites += arr_view_sprite_size (bench.view.sprites);
+          sdl_drawing += SDL_GetAtomicInt (&sdl_allocations) - before;
+        }
+    }
+  result->sdl_allocations = (Uint64)(Uint32)(
+      SDL_GetAtomicInt (&sdl_allocations) - sdl_start - sdl_drawing);
+  result->ecs_allocations = count_ecs_allocations () - ecs_start;
+
+  const game_s *game = ecs_singleton_get (world, game_s);
+  const struct entity_pool *bombs = &game->pools[SIM_POOL_BOMBS];
+  const struct entity_pool *explosions = &game->pools[SIM_POOL_EXPLOSIONS];
+  result->bombs = bombs->created + bombs->reused;
+  result->explosions = explosions->created + explosions->reused;
+
+  arr_point_clear (chains);
+  close_renderer (&bench);
+  fini_sim (world);
+  ecs_fini (world);
+  SDL_Quit ();
+
+  if (options->ticks > 0u)
+    {
+      SDL_qsort (times, options->ticks, sizeof (Uint64), compare_ticks);
+      result->p50 = times[options->ticks / 2u];
+      result->p99 = times[(Uint64)options->ticks * 99u / 100u];
+      result->max = times[options->ticks - 1u];
+    }
+  if (options->ticks > 0u && options->b_renders == true)
+    {
+      SDL_qsort (single_times, options->ticks, sizeof (Uint64),
+                 compare_ticks);
+      SDL_qsort (batch_times, options->ticks, sizeof (Uint64),
+                 compare_ticks);
+      result->single_p50 = single_times[options->ticks / 2u];
+      result->single_p99 = single_times[(Uint64)options->ticks * 99u / 100u];
+      result->batch_p50 = batch_times[options->ticks / 2u];
+      result->batch_p99 = batch_times[(Uint64)options->ticks * 99u / 100u];
+    }
+  result->seconds /= (double)SDL_GetPerformanceFrequency ();
+  SDL_free (times);
+  return true;
+}
+
+static void
+report (const struct bench_scenario *scenario, const struct options *options,
+        const struct bench_result *result)
+{
+  const double to_us = 1e6 / (double)SDL_GetPerformanceFrequency ();
+  const double ticks_per_second
+      = result->seconds > 0.0 ? (double)options->ticks / result->seconds
+                              : 0.0;
+  const double ticks = (double)SDL_max (options->ticks, 1u);
+
+  SDL_Log ("%s: %dx%d, %d AI, bombs %.4f x %d: %.1f ticks/s, p50 %.1f us, "
+           "p99 %.1f us, max %.1f us, %.2f allocations per tick",
+           scenario->name, scenario->w, scenario->h, scenario->ai_count,
+           (double)scenario->bomb_density, scenario->chain_length,
+           ticks_per_second, (double)result->p50 * to_us,
+           (double)result->p99 * to_us, (double)result->max * to_us,
+           (double)(result->sdl_allocations + result->ecs_allocations)
+               / ticks);
+  SDL_Log ("%s: %llu bombs and %llu explosions over the run",
+           scenario->name, (unsigned long long)result->bombs,
+           (unsigned long long)result->explosions);
+  if (options->b_renders == true)
+    {
+      SDL_Log ("%s: %.1f sprites per frame, one by one p50 %.1f us, p99 "
+               "%.1f us, batched p50 %.1f us, p99 %.1f us, %.1f draw calls "
+               "per frame",
+               scenario->name, (double)result->sprites / ticks,
+               (double)result->single_p50 * to_us,
+               (double)result->single_p99 * to_us,
+               (double)result->batch_p50 * to_us,
+               (double)result->batch_p99 * to_us,
+               (double)result->batch_calls / ticks);
+    }
+
+  printf ("{\"scenario\":\"%s\",\"w\":%d,\"h\":%d,\"ais\":%d,"
+          "\"bomb_density\":%g,\"chain\":%d,\"seed\":%llu,\"ticks\":%u,"
+          "\"ticks_per_sec\":%.1f,\"p50_us\":%.2f,\"p99_us\":%.2f,"
+          "\"max_us\":%.2f,\"sdl_allocs_per_tick\":%.3f,"
+          "\"ecs_allocs_per_tick\":%.3f,\"bombs\":%llu,\"explosions\":%llu",
+          scenario->name, scenario->w, scenario->h, scenario->ai_count,
+          (double)scenario->bomb_density, scenario->chain_length,
+          (unsigned long long)options->seed, options->ticks,
+          ticks_per_second, (double)result->p50 * to_us,
+          (double)result->p99 * to_us, (double)result->max * to_us,
+          (double)result->sdl_allocations / ticks,
+          (double)result->ecs_allocations / ticks,
+          (unsigned long long)result->bombs,
+          (unsigned long long)result->explosions);
+  if (options->b_renders == true)
+    {
+      printf (",\"sprites_per_frame\":%.1f,\"single_p50_us\":%.2f,"
+              "\"single_p99_us\":%.2f,\"single_calls_per_frame\":%.1f,"
+              "\"batch_p50_us\":%.2f,\"batch_p99_us\":%.2f,"
+              "\"batch_calls_per_frame\":%.1f",
+              (double)result->sprites / ticks,
+              (double)result->single_p50 * to_us,
+              (double)result->single_p99 * to_us,
+              (double)result->single_calls / ticks,
+              (double)result->batch_p50 * to_us,
+              (double)result->batch_p99 * to_us,
+              (double)result->batch_calls / ticks);
+    }
+  printf ("}\n");
+  fflush (stdout);
+}
+
+/**
+ * @return false on an unknown or incomplete option, or an unusable custom
+ * scenario.
+ */
+static bool
+parse_args (int argc, char *argv[], struct options *options)
+{
+  *options = (struct options){ .ticks = BENCH_DEFAULT_TICKS,
+                               .seed = BENCH_DEFAULT_SEED,
+                               .custom = { .name = "custom",
+                                           .w = 31,
+                                           .h = 15,
+                                           .ai_count = 16,
+                                           .bomb_density = 0.f,
+                                           .chain_length = 1 } };
+  for (int i = 1; i < argc; i++)
+    {
+      const char *arg = argv[i];
+      const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+      if (SDL_strcmp (arg, "--render") == 0)
+        {
+          options->b_renders = true;
+          continue;
+        }
+      else if (value == NULL)
+        {
+          return false;
+        }
+      else if (SDL_strcmp (arg, "--ticks") == 0)
+        {
+          options->ticks = (Uint32)SDL_strtoul (value, NULL, 10);
+        }
+      else if (SDL_strcmp (arg, "--seed") == 0)
+        {
+          options->seed = (Uint64)SDL_strtoull (value, NULL, 10);
+        }
+      else if (SDL_strcmp (arg, "--scenario") == 0)
+        {
+          options->scenario = value;
+        }
+      else if (SDL_strcmp (arg, "--size") == 0)
+        {
+          char *end = NULL;
+          options->custom.w = (Sint32)SDL_strtol (value, &end, 10);
+          options->custom.h
+              = *end == 'x' ? (Sint32)SDL_strtol (end + 1, NULL, 10) : 0;
+          options->b_is_custom = true;
+        }
+      else if (SDL_strcmp (arg, "--ais") == 0)
+        {
+          options->custom.ai_count = (Sint32)SDL_strtol (value, NULL, 10);
+          options->b_is_custom = true;
+        }
+      else if (SDL_strcmp (arg, "--bombs") == 0)
+        {
+          options->custom.bomb_density = (float)SDL_atof (value);
+          options->b_is_custom = true;
+        }
+      else if (SDL_strcmp (arg, "--chain") == 0)
+        {
+          options->custom.chain_length = (Sint32)SDL_strtol (value, NULL, 10);
+          options->b_is_custom = true;
+        }
+      else
+        {
+          return false;
+        }
+      i++;
+    }
+
+  const struct bench_scenario *custom = &options->custom;
+  return custom->w >= BENCH_MIN_SIZE && custom->w <= BENCH_MAX_SIZE
+         && custom->h >= BENCH_MIN_SIZE && custom->h <= BENCH_MAX_SIZE
+         && custom->ai_count >= 0 && custom->bomb_density >= 0.f
+         && custom->bomb_density <= 1.f && custom->chain_length >= 1
+         && (Uint32)custom->chain_length <= BENCH_WAVE_TICKS;
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct options options;
+  if (parse_args (argc, argv, &options) == false)
+    {
+      SDL_Log ("Usage: %s [--ticks n] [--seed n] [--render] "
+               "[--scenario name]\n"
+               "       %s [--ticks n] [--seed n] [--render] --size <w>x<h> "
+               "--ais n --bombs density --chain length",
+               argv[0], argv[0]);
+      return 1;
+    }
+
+  /* Before SDL allocates anything, so every block goes through the same
+   * functions. */
+  SDL_GetOriginalMemoryFunctions (&original_malloc, &original_calloc,
+                                  &original_realloc, &original_free);
+  SDL_SetMemoryFunctions (counting_malloc, counting_calloc, counting_realloc,
+                          original_free);
+
+  Sint32 run_count = 0;
+  for (Sint32 i = 0; i < (options.b_is_custom ? 1 : BENCH_SUITE_COUNT); i++)
+    {
+      const struct bench_scenario *scenario
+          = options.b_is_custom ? &options.custom : &bench_suite[i];
+      if (options.b_is_custom == false && options.scenario != NULL
+          && SDL_strcmp (options.scenario, scenario->name) != 0)
+        {
+          continue;
+        }
+
+      struct bench_result result;
+      if (run_scenario (scenario, &options, &result) == false)
+        {
+          SDL_Log ("Failed to set up scenario %s", scenario->name);
+          return 1;
+        }
+      report (scenario, &options, &result);
+      run_count++;
+    }
+
+  if (run_count == 0)
+    {
+      SDL_Log ("No scenario named %s", options.scenario);
+      return 1;
+    }
+  return 0;
+}
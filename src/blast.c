@@ -0,0 +1,250 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Blast engine. */
+
+#include "blast.h"
+
+#define WORD_BITS 64
+#define WORD_OF(bit) ((bit) / WORD_BITS)
+#define BIT_OF(bit) ((Uint64)1u << ((bit) % WORD_BITS))
+
+static Sint32
+lowest_bit (Uint64 word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll (word);
+#else
+  Sint32 n = 0;
+  while ((word & 1u) == 0u)
+    {
+      word >>= 1;
+      n++;
+    }
+  return n;
+#endif
+}
+
+static Sint32
+highest_bit (Uint64 word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return WORD_BITS - 1 - __builtin_clzll (word);
+#else
+  Sint32 n = 0;
+  while (word >>= 1)
+    {
+      n++;
+    }
+  return n;
+#endif
+}
+
+/* Masks keeping the bits at or above / at or below a position in a word. */
+static Uint64
+mask_from (Sint32 bit)
+{
+  return ~(Uint64)0u << (bit % WORD_BITS);
+}
+
+static Uint64
+mask_to (Sint32 bit)
+{
+  return ~(Uint64)0u >> (WORD_BITS - 1 - bit % WORD_BITS);
+}
+
+/**
+ * @return the index of the first set bit in [from, to], or -1.
+ */
+static Sint32
+first_set (const Uint64 *mask, Sint32 from, Sint32 to)
+{
+  const Sint32 last = WORD_OF (to);
+  for (Sint32 i = WORD_OF (from); i <= last; i++)
+    {
+      Uint64 word = mask[i];
+      if (i == WORD_OF (from))
+        {
+          word &= mask_from (from);
+        }
+      if (i == last)
+        {
+          word &= mask_to (to);
+        }
+      if (word != 0u)
+        {
+          return i * WORD_BITS + lowest_bit (word);
+        }
+    }
+  return -1;
+}
+
+/**
+ * @return the index of the last set bit in [from, to], or -1.
+ */
+static Sint32
+last_set (const Uint64 *mask, Sint32 from, Sint32 to)
+{
+  const Sint32 first = WORD_OF (from);
+  for (Sint32 i = WORD_OF (to); i >= first; i--)
+    {
+      Uint64 word = mask[i];
+      if (i == WORD_OF (to))
+        {
+          word &= mask_to (to);
+        }
+      if (i == first)
+        {
+          word &= mask_from (from);
+        }
+      if (word != 0u)
+        {
+          return i * WORD_BITS + highest_bit (word);
+        }
+    }
+  return -1;
+}
+
+/* Reach of an arm going towards higher indices, from pos along a mask of
+ * length len. */
+static Sint32
+reach_forward (const Uint64 *mask, Sint32 pos, Sint32 len, Sint32 range)
+{
+  const Sint32 to = SDL_min (pos + range, len - 1);
+  if (to <= pos)
+    {
+      return 0;
+    }
+  const Sint32 hit = first_set (mask, pos + 1, to);
+  return (hit < 0 ? to : hit - 1) - pos;
+}
+
+static Sint32
+reach_backward (const Uint64 *mask, Sint32 pos, Sint32 range)
+{
+  const Sint32 from = SDL_max (pos - range, 0);
+  if (from >= pos)
+    {
+      return 0;
+    }
+  const Sint32 hit = last_set (mask, from, pos - 1);
+  return pos - (hit < 0 ? from : hit + 1);
+}
+
+bool
+blast_board_init (struct blast_board *board, const struct grid *grid)
+{
+  blast_board_free (board);
+
+  board->w = grid->w;
+  board->h = grid->h;
+  board->row_words = (grid->w + WORD_BITS - 1) / WORD_BITS;
+  board->col_words = (grid->h + WORD_BITS - 1) / WORD_BITS;
+
+  const size_t row_size = (size_t)board->row_words * (size_t)board->h;
+  const size_t col_size = (size_t)board->col_words * (size_t)board->w;
+  board->rows = SDL_calloc (row_size, sizeof (Uint64));
+  board->cols = SDL_calloc (col_size, sizeof (Uint64));
+  board->hits = SDL_calloc (row_size, sizeof (Uint64));
+  if (board->rows == NULL || board->cols == NULL || board->hits == NULL)
+    {
+      blast_board_free (board);
+      return false;
+    }
+
+  /* Everything starts blocked, void included, then the open cells of the
+   * populated chunks are cleared. */
+  SDL_memset (board->rows, 0xFF, row_size * sizeof (Uint64));
+  SDL_memset (board->cols, 0xFF, col_size * sizeof (Uint64));
+  for (Sint32 i = 0; i < grid_cell_count (grid); i++)
+    {
+      const SDL_Point cell = grid_position (grid, i);
+      if ((grid->cells[i] & GRID_CELL_BLOCKED) == 0u
+          && grid_contains (grid, cell.x, cell.y))
+        {
+          blast_board_set_blocked (board, cell.x, cell.y, false);
+        }
+    }
+
+  return true;
+}
+
+void
+blast_board_free (struct blast_board *board)
+{
+  SDL_free (board->rows);
+  SDL_free (board->cols);
+  SDL_free (board->hits);
+  SDL_zerop (board);
+}
+
+void
+blast_board_set_blocked (struct blast_board *board, Sint32 x, Sint32 y,
+                         bool b_is_blocked)
+{
+  Uint64 *row = &board->rows[y * board->row_words + WORD_OF (x)];
+  Uint64 *col = &board->cols[x * board->col_words + WORD_OF (y)];
+  if (b_is_blocked == true)
+    {
+      *row |= BIT_OF (x);
+      *col |= BIT_OF (y);
+    }
+  else
+    {
+      *row &= ~BIT_OF (x);
+      *col &= ~BIT_OF (y);
+    }
+}
+
+void
+blast_board_cross (const struct blast_board *board, Sint32 x, Sint32 y,
+                   Sint32 range, struct blast_cross *cross)
+{
+  const Uint64 *row = &board->rows[y * board->row_words];
+  const Uint64 *col = &board->cols[x * board->col_words];
+
+  cross->x = x;
+  cross->y = y;
+  cross->left = reach_backward (row, x, range);
+  cross->right = reach_forward (row, x, board->w, range);
+  cross->up = reach_backward (col, y, range);
+  cross->down = reach_forward (col, y, board->h, range);
+}
+
+bool
+blast_board_claim (struct blast_board *board, Sint32 x, Sint32 y)
+{
+  Uint64 *word = &board->hits[y * board->row_words + WORD_OF (x)];
+  if ((*word & BIT_OF (x)) != 0u)
+    {
+      return false;
+    }
+  *word |= BIT_OF (x);
+  return true;
+}
+
+void
+blast_board_release (struct blast_board *board,
+                     const struct blast_cross *cross)
+{
+  Uint64 *row = &board->hits[cross->y * board->row_words];
+  const Sint32 from = cross->x - cross->left;
+  const Sint32 to = cross->x + cross->right;
+  for (Sint32 i = WORD_OF (from); i <= WORD_OF (to); i++)
+    {
+      Uint64 span = ~(Uint64)0u;
+      if (i == WORD_OF (from))
+        {
+          span &= mask_from (from);
+        }
+      if (i == WORD_OF (to))
+        {
+          span &= mask_to (to);
+        }
+      row[i] &= ~span;
+    }
+
+  for (Sint32 y = cross->y - cross->up; y <= cross->y + cross->down; y++)
+    {
+      board->hits[y * board->row_words + WORD_OF (cross->x)]
+          &= ~BIT_OF (cross->x);
+    }
+}
@@ -0,0 +1,63 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Blast engine: keeps one bitmask per row and per column of the blocked
+ *  cells, so the four arms of a bomb's cross are found with a couple of
+ *  shift/mask operations instead of a cell by cell walk. */
+
+#ifndef BOMBERMAN_BLAST_H
+#define BOMBERMAN_BLAST_H
+
+#include "SDL3/SDL.h"
+
+#include "grid.h"
+
+struct blast_board
+{
+  Sint32 w;
+  Sint32 h;
+  Sint32 row_words; /* 64-bit words per row mask. */
+  Sint32 col_words; /* 64-bit words per column mask. */
+  Uint64 *rows;     /* Blocked cells, h masks of row_words words. */
+  Uint64 *cols;     /* Blocked cells, w masks of col_words words. */
+  Uint64 *hits;     /* Cells claimed by the current batch, laid out as rows. */
+};
+
+/* Reach of each arm, in cells, not counting the centre. */
+struct blast_cross
+{
+  Sint32 x;
+  Sint32 y;
+  Sint32 left;
+  Sint32 right;
+  Sint32 up;
+  Sint32 down;
+};
+
+/**
+ * Builds the row and column masks from the blocked flags of the grid. Any
+ * storage previously held by the board is released first.
+ * @return false if an allocation failed.
+ */
+bool blast_board_init (struct blast_board *board, const struct grid *grid);
+void blast_board_free (struct blast_board *board);
+
+void blast_board_set_blocked (struct blast_board *board, Sint32 x, Sint32 y,
+                              bool b_is_blocked);
+
+/**
+ * Computes the cross of a blast centred on (x, y). Each arm stops before the
+ * first blocked cell, at the map edge, or after range cells.
+ */
+void blast_board_cross (const struct blast_board *board, Sint32 x, Sint32 y,
+                        Sint32 range, struct blast_cross *cross);
+
+/**
+ * Marks a cell as hit for the current batch.
+ * @return true if the cell was not hit yet by an earlier cross of the batch.
+ */
+bool blast_board_claim (struct blast_board *board, Sint32 x, Sint32 y);
+
+/** Clears the hits a cross left behind, once its batch is resolved. */
+void blast_board_release (struct blast_board *board,
+                          const struct blast_cross *cross);
+
+#endif /* BOMBERMAN_BLAST_H */
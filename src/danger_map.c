@@ -0,0 +1,262 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Danger map. A bomb goes off at the earlier of its fuse and the first
+ *  blast reaching its cell, and a cell burns at the earliest detonation
+ *  among the crosses covering it. Adding a bomb can only bring ticks
+ *  forward, which is propagated through the bombs it reaches. Removing one
+ *  only ever happens when it goes off along with its whole chain, so the
+ *  cells it covered just need a fresh look at the bombs still around.
+ *  Unblocking cells can lengthen crosses and break chains apart, which is
+ *  rare enough for every bomb to be added again. */
+
+#include "danger_map.h"
+
+static bool
+cross_covers (const struct blast_cross *cross, Sint32 x, Sint32 y)
+{
+  if (y == cross->y)
+    {
+      return x >= cross->x - cross->left && x <= cross->x + cross->right;
+    }
+  if (x == cross->x)
+    {
+      return y >= cross->y - cross->up && y <= cross->y + cross->down;
+    }
+  return false;
+}
+
+static const struct danger_bomb *
+bomb_at (const struct danger_map *map, const struct grid *grid, Sint32 x,
+         Sint32 y)
+{
+  const Sint32 cell = grid_index (grid, x, y);
+  if (cell < 0 || map->bomb_slots[cell] < 0)
+    {
+      return NULL;
+    }
+  return &map->bombs[map->bomb_slots[cell]];
+}
+
+/* Earliest detonation among the registered bombs reaching a cell. */
+static Uint64
+earliest_blast (const struct danger_map *map, const struct grid *grid,
+                Sint32 x, Sint32 y)
+{
+  Uint64 best = DANGER_MAP_SAFE;
+  for (Sint32 i = x - map->max_range; i <= x + map->max_range; i++)
+    {
+      const struct danger_bomb *bomb = bomb_at (map, grid, i, y);
+      if (bomb != NULL && bomb->tick < best
+          && cross_covers (&bomb->cross, x, y))
+        {
+          best = bomb->tick;
+        }
+    }
+  for (Sint32 j = y - map->max_range; j <= y + map->max_range; j++)
+    {
+      const struct danger_bomb *bomb = bomb_at (map, grid, x, j);
+      if (j != y && bomb != NULL && bomb->tick < best
+          && cross_covers (&bomb->cross, x, y))
+        {
+          best = bomb->tick;
+        }
+    }
+  return best;
+}
+
+/* Brings the cell forward to tick, and the bomb sitting on it if any. */
+static void
+lower_cell (struct danger_map *map, const struct grid *grid, Sint32 x,
+            Sint32 y, Uint64 tick, Sint32 *count)
+{
+  const Sint32 cell = grid_index (grid, x, y);
+  map->ticks[cell] = SDL_min (map->ticks[cell], tick);
+
+  const Sint32 slot = map->bomb_slots[cell];
+  if (slot >= 0 && map->bombs[slot].tick > tick)
+    {
+      map->bombs[slot].tick = tick;
+      map->stack[(*count)++] = slot;
+    }
+}
+
+static bool
+reserve_bombs (struct danger_map *map, Sint32 count)
+{
+  if (count <= map->bomb_capacity)
+    {
+      return true;
+    }
+
+  const Sint32 capacity = SDL_max (map->bomb_capacity * 2, 16);
+  struct danger_bomb *bombs
+      = SDL_realloc (map->bombs, (size_t)capacity * sizeof (*bombs));
+  if (bombs == NULL)
+    {
+      return false;
+    }
+  map->bombs = bombs;
+  Sint32 *stack = SDL_realloc (map->stack, (size_t)capacity * sizeof (Sint32));
+  if (stack == NULL)
+    {
+      return false;
+    }
+  map->stack = stack;
+  map->bomb_capacity = capacity;
+  return true;
+}
+
+bool
+danger_map_init (struct danger_map *map, const struct grid *grid)
+{
+  danger_map_free (map);
+
+  const Sint32 cell_count = grid_cell_count (grid);
+  const size_t size = SDL_max ((size_t)cell_count, (size_t)1u);
+  map->ticks = SDL_malloc (size * sizeof (Uint64));
+  map->bomb_slots = SDL_malloc (size * sizeof (Sint32));
+  if (map->ticks == NULL || map->bomb_slots == NULL)
+    {
+      danger_map_free (map);
+      return false;
+    }
+
+  for (Sint32 i = 0; i < cell_count; i++)
+    {
+      map->ticks[i] = DANGER_MAP_SAFE;
+      map->bomb_slots[i] = -1;
+    }
+
+  return true;
+}
+
+void
+danger_map_free (struct danger_map *map)
+{
+  SDL_free (map->ticks);
+  SDL_free (map->bomb_slots);
+  SDL_free (map->bombs);
+  SDL_free (map->stack);
+  SDL_zerop (map);
+}
+
+bool
+danger_map_add_bomb (struct danger_map *map, const struct grid *grid,
+                     const struct blast_board *board, Sint32 x, Sint32 y,
+                     Sint32 range, Uint64 fuse_tick)
+{
+  const Sint32 cell = grid_index (grid, x, y);
+  if (cell < 0 || map->bomb_slots[cell] >= 0
+      || reserve_bombs (map, map->bomb_count + 1) == false)
+    {
+      return false;
+    }
+
+  const Sint32 slot = map->bomb_count++;
+  struct danger_bomb *bomb = &map->bombs[slot];
+  bomb->cell = cell;
+  bomb->range = range;
+  bomb->fuse_tick = fuse_tick;
+  bomb->tick = SDL_min (fuse_tick, map->ticks[cell]);
+  blast_board_cross (board, x, y, range, &bomb->cross);
+  map->bomb_slots[cell] = slot;
+  map->max_range = SDL_max (map->max_range, range);
+
+  Sint32 count = 0;
+  map->stack[count++] = slot;
+  while (count > 0)
+    {
+      const struct danger_bomb *chained = &map->bombs[map->stack[--count]];
+      const struct blast_cross cross = chained->cross;
+      const Uint64 tick = chained->tick;
+
+      lower_cell (map, grid, cross.x, cross.y, tick, &count);
+      for (Sint32 i = 1; i <= cross.up; i++)
+        {
+          lower_cell (map, grid, cross.x, cross.y - i, tick, &count);
+        }
+      for (Sint32 i = 1; i <= cross.left; i++)
+        {
+          lower_cell (map, grid, cross.x - i, cross.y, tick, &count);
+        }
+      for (Sint32 i = 1; i <= cross.down; i++)
+        {
+          lower_cell (map, grid, cross.x, cross.y + i, tick, &count);
+        }
+      for (Sint32 i = 1; i <= cross.right; i++)
+        {
+          lower_cell (map, grid, cross.x + i, cross.y, tick, &count);
+        }
+    }
+
+  return true;
+}
+
+void
+danger_map_remove_bomb (struct danger_map *map, const struct grid *grid,
+                        Sint32 x, Sint32 y)
+{
+  const Sint32 cell = grid_index (grid, x, y);
+  if (cell < 0 || map->bomb_slots[cell] < 0)
+    {
+      return;
+    }
+
+  /* Fill the hole with the last bomb so the table stays packed. */
+  const Sint32 slot = map->bomb_slots[cell];
+  const struct blast_cross cross = map->bombs[slot].cross;
+  map->bombs[slot] = map->bombs[--map->bomb_count];
+  map->bomb_slots[map->bombs[slot].cell] = slot;
+  map->bomb_slots[cell] = -1;
+
+  for (Sint32 i = cross.x - cross.left; i <= cross.x + cross.right; i++)
+    {
+      map->ticks[grid_index (grid, i, cross.y)]
+          = earliest_blast (map, grid, i, cross.y);
+    }
+  for (Sint32 j = cross.y - cross.up; j <= cross.y + cross.down; j++)
+    {
+      if (j != cross.y)
+        {
+          map->ticks[grid_index (grid, cross.x, j)]
+              = earliest_blast (map, grid, cross.x, j);
+        }
+    }
+}
+
+/* Resets the cells a cross covers, as if no bomb reached them. */
+static void
+clear_cross (struct danger_map *map, const struct grid *grid,
+             const struct blast_cross *cross)
+{
+  for (Sint32 i = cross->x - cross->left; i <= cross->x + cross->right; i++)
+    {
+      map->ticks[grid_index (grid, i, cross->y)] = DANGER_MAP_SAFE;
+    }
+  for (Sint32 j = cross->y - cross->up; j <= cross->y + cross->down; j++)
+    {
+      map->ticks[grid_index (grid, cross->x, j)] = DANGER_MAP_SAFE;
+    }
+}
+
+void
+danger_map_refresh (struct danger_map *map, const struct grid *grid,
+                    const struct blast_board *board)
+{
+  const Sint32 count = map->bomb_count;
+  for (Sint32 i = 0; i < count; i++)
+    {
+      clear_cross (map, grid, &map->bombs[i].cross);
+      map->bomb_slots[map->bombs[i].cell] = -1;
+    }
+
+  /* Each bomb is added back into its own slot, read before it is
+   * written. */
+  map->bomb_count = 0;
+  for (Sint32 i = 0; i < count; i++)
+    {
+      const struct danger_bomb bomb = map->bombs[i];
+      const SDL_Point cell = grid_position (grid, bomb.cell);
+      danger_map_add_bomb (map, grid, board, cell.x, cell.y, bomb.range,
+                           bomb.fuse_tick);
+    }
+}
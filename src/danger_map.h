@@ -0,0 +1,90 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Danger map: for every cell, the tick at which the next pending blast
+ *  reaches it, chain reactions included. It is updated when a bomb is
+ *  placed or goes off rather than re-simulated by every reader, so checking
+ *  how long a cell stays safe is a single load. Cells already on fire are
+ *  not tracked here, see GRID_CELL_EXPLOSION. Like the flow field, the map
+ *  is addressed with the dense cell indices of its grid. */
+
+#ifndef BOMBERMAN_DANGER_MAP_H
+#define BOMBERMAN_DANGER_MAP_H
+
+#include "SDL3/SDL.h"
+
+#include "blast.h"
+#include "grid.h"
+
+#define DANGER_MAP_SAFE UINT64_MAX
+
+/* A pending bomb, as the danger map sees it. */
+struct danger_bomb
+{
+  Uint64 tick; /* Detonation tick, chains included. */
+  Uint64 fuse_tick;
+  Sint32 cell;
+  Sint32 range;
+  struct blast_cross cross;
+};
+
+struct danger_map
+{
+  Sint32 max_range;   /* Longest arm ever registered. */
+  Uint64 *ticks;      /* Tick the next blast reaches each cell. */
+  Sint32 *bomb_slots; /* Per cell, its bomb in bombs, or -1. */
+  struct danger_bomb *bombs;
+  Sint32 bomb_count;
+  Sint32 bomb_capacity;
+  Sint32 *stack; /* Bombs left to propagate, bomb_capacity long. */
+};
+
+/**
+ * Allocates a map over the stored cells of a grid, with no bomb. Any storage
+ * previously held by the map is released first.
+ * @return false if the allocation failed.
+ */
+bool danger_map_init (struct danger_map *map, const struct grid *grid);
+void danger_map_free (struct danger_map *map);
+
+/**
+ * Registers a bomb going off at fuse_tick unless a blast reaches it sooner.
+ * Its cross is taken from the board as it stands, and bombs it reaches are
+ * brought forward to its own detonation tick.
+ * @return false if the bomb could not be stored.
+ */
+bool danger_map_add_bomb (struct danger_map *map, const struct grid *grid,
+                          const struct blast_board *board, Sint32 x, Sint32 y,
+                          Sint32 range, Uint64 fuse_tick);
+
+/**
+ * Forgets the bomb of a cell once it went off. The bombs of its chain go
+ * off within the same tick and are expected to be removed as well.
+ */
+void danger_map_remove_bomb (struct danger_map *map, const struct grid *grid,
+                             Sint32 x, Sint32 y);
+
+/**
+ * Takes the crosses of the pending bombs from the board again, after cells
+ * were unblocked, and redoes their chains. Bombs brought forward by a chain
+ * keep their fuse otherwise.
+ */
+void danger_map_refresh (struct danger_map *map, const struct grid *grid,
+                         const struct blast_board *board);
+
+/**
+ * @return the ticks left before a blast reaches the cell, 0 if one is due
+ * now, or DANGER_MAP_SAFE if no pending bomb reaches it.
+ */
+static inline Uint64
+danger_map_ticks_left (const struct danger_map *map, const struct grid *grid,
+                       Sint32 x, Sint32 y, Uint64 now)
+{
+  const Sint32 index = grid_index (grid, x, y);
+  const Uint64 tick = index < 0 ? DANGER_MAP_SAFE : map->ticks[index];
+  if (tick == DANGER_MAP_SAFE)
+    {
+      return DANGER_MAP_SAFE;
+    }
+  return tick > now ? tick - now : 0u;
+}
+
+#endif /* BOMBERMAN_DANGER_MAP_H */
@@ -0,0 +1,63 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Recycling pool for short-lived prefab instances. */
+
+#include "entity_pool.h"
+
+void
+entity_pool_init (struct entity_pool *pool, ecs_entity_t prefab)
+{
+  pool->prefab = prefab;
+  pool->reset_count = 0;
+  arr_entity_init (pool->free);
+  pool->created = 0u;
+  pool->reused = 0u;
+  pool->released = 0u;
+}
+
+void
+entity_pool_free (struct entity_pool *pool)
+{
+  arr_entity_clear (pool->free);
+  SDL_zerop (pool);
+}
+
+void
+entity_pool_reset_on_reuse (struct entity_pool *pool, ecs_id_t id)
+{
+  SDL_assert (pool->reset_count < ENTITY_POOL_MAX_RESETS);
+  pool->resets[pool->reset_count++] = id;
+}
+
+ecs_entity_t
+entity_pool_acquire (ecs_world_t *world, struct entity_pool *pool)
+{
+  if (arr_entity_empty_p (pool->free))
+    {
+      pool->created++;
+      return ecs_new_w_pair (world, EcsIsA, pool->prefab);
+    }
+
+  ecs_entity_t ent = 0u;
+  arr_entity_pop_back (&ent, pool->free);
+  pool->reused++;
+
+  for (Sint32 i = 0; i < pool->reset_count; i++)
+    {
+      const ecs_id_t id = pool->resets[i];
+      const ecs_type_info_t *type_info = ecs_get_type_info (world, id);
+      ecs_set_id (world, ent, id, (size_t)type_info->size,
+                  ecs_get_id (world, pool->prefab, id));
+    }
+  ecs_enable (world, ent, true);
+
+  return ent;
+}
+
+void
+entity_pool_release (ecs_world_t *world, struct entity_pool *pool,
+                     ecs_entity_t ent)
+{
+  ecs_enable (world, ent, false);
+  arr_entity_push_back (pool->free, ent);
+  pool->released++;
+}
@@ -0,0 +1,51 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Recycling pool for short-lived prefab instances (bombs, explosions).
+ *  Released entities are disabled rather than deleted, and handed out again
+ *  with their per-instance state reset from the prefab, which spares flecs
+ *  the entity index and table churn of a create/delete cycle. */
+
+#ifndef BOMBERMAN_ENTITY_POOL_H
+#define BOMBERMAN_ENTITY_POOL_H
+
+/* Pluto framework. */
+#include "pluto.h"
+
+#define ENTITY_POOL_MAX_RESETS 4
+
+struct entity_pool
+{
+  ecs_entity_t prefab;
+  ecs_id_t resets[ENTITY_POOL_MAX_RESETS]; /* Copied from the prefab. */
+  Sint32 reset_count;
+  arr_entity_t free;
+  Uint64 created;  /* Instances built from scratch. */
+  Uint64 reused;   /* Allocations avoided by handing out a free instance. */
+  Uint64 released; /* Instances given back to the pool. */
+};
+
+void entity_pool_init (struct entity_pool *pool, ecs_entity_t prefab);
+
+/**
+ * Forgets the free instances, which are left to the world to delete.
+ */
+void entity_pool_free (struct entity_pool *pool);
+
+/**
+ * Adds a component to reset from the prefab whenever an instance is reused.
+ */
+void entity_pool_reset_on_reuse (struct entity_pool *pool, ecs_id_t id);
+
+/**
+ * @return an enabled instance of the pool's prefab, recycled when possible.
+ */
+ecs_entity_t entity_pool_acquire (ecs_world_t *world,
+                                  struct entity_pool *pool);
+
+/**
+ * Disables an instance and keeps it for a later acquire. Relationship pairs
+ * are left as they are, strip them before releasing.
+ */
+void entity_pool_release (ecs_world_t *world, struct entity_pool *pool,
+                          ecs_entity_t ent);
+
+#endif /* BOMBERMAN_ENTITY_POOL_H */
@@ -0,0 +1,319 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Flow field. Distances only shrink through a FIFO relaxation. When a cell
+ *  stops holding a distance up (it closes or stops being a source), the cells
+ *  which can no longer keep theirs are raised to unreachable level by level,
+ *  then relaxed again from their surviving neighbours. */
+
+#include "flow_field.h"
+
+enum flow_field_cell_flags
+{
+  FLOW_FIELD_BLOCKED = 1u << 0,
+  FLOW_FIELD_SOURCE = 1u << 1,
+  FLOW_FIELD_QUEUED = 1u << 2, /* In the relaxation ring. */
+  FLOW_FIELD_WANTED = 1u << 3, /* Scratch mark of flow_field_set_sources. */
+};
+
+/* Same order as the ties documented in flow_field_step. */
+static const SDL_Point neighbours[4]
+    = { { 0, -1 }, { -1, 0 }, { 0, 1 }, { 1, 0 } };
+
+/**
+ * @return the index of the n-th neighbour of a cell, or -1 when it falls off
+ * the stored part of the grid.
+ */
+static Sint32
+neighbour_of (const struct grid *grid, Sint32 cell, Sint32 n)
+{
+  const SDL_Point pos = grid_position (grid, cell);
+  return grid_index (grid, pos.x + neighbours[n].x, pos.y + neighbours[n].y);
+}
+
+static Uint32
+closest_neighbour (const struct flow_field *field, const struct grid *grid,
+                   Sint32 cell)
+{
+  Uint32 best = FLOW_FIELD_UNREACHABLE;
+  for (Sint32 n = 0; n < 4; n++)
+    {
+      const Sint32 other = neighbour_of (grid, cell, n);
+      if (other >= 0)
+        {
+          best = SDL_min (best, field->dist[other]);
+        }
+    }
+  return best;
+}
+
+static void
+push (struct flow_field *field, Sint32 cell)
+{
+  if ((field->flags[cell] & FLOW_FIELD_QUEUED) != 0u)
+    {
+      return;
+    }
+  field->flags[cell] |= FLOW_FIELD_QUEUED;
+  field->queue[(field->queue_head + field->queue_count) % field->cell_count]
+      = cell;
+  field->queue_count++;
+}
+
+/* Lowers the neighbours of every queued cell until nothing improves. */
+static void
+relax (struct flow_field *field, const struct grid *grid)
+{
+  while (field->queue_count > 0)
+    {
+      const Sint32 cell = field->queue[field->queue_head];
+      field->queue_head = (field->queue_head + 1) % field->cell_count;
+      field->queue_count--;
+      field->flags[cell] &= (Uint8)~FLOW_FIELD_QUEUED;
+
+      const Uint32 dist = field->dist[cell];
+      if (dist == FLOW_FIELD_UNREACHABLE)
+        {
+          continue;
+        }
+      for (Sint32 n = 0; n < 4; n++)
+        {
+          const Sint32 other = neighbour_of (grid, cell, n);
+          if (other < 0
+              || (field->flags[other] & (FLOW_FIELD_BLOCKED | FLOW_FIELD_SOURCE))
+                     != 0u
+              || field->dist[other] <= dist + 1u)
+            {
+              continue;
+            }
+          field->dist[other] = dist + 1u;
+          push (field, other);
+        }
+    }
+}
+
+/* Whether a neighbour other than the raised ones still sits at dist. */
+static bool
+is_supported (const struct flow_field *field, const struct grid *grid,
+              Sint32 cell, Uint32 dist)
+{
+  for (Sint32 n = 0; n < 4; n++)
+    {
+      const Sint32 other = neighbour_of (grid, cell, n);
+      if (other >= 0 && field->dist[other] == dist)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+/**
+ * Drops the distance held by a cell and repairs what depended on it. The
+ * raise walks outwards one distance level at a time, so by the time a cell
+ * is checked every cell of the level below which lost its support has
+ * already been raised.
+ */
+static void
+invalidate (struct flow_field *field, const struct grid *grid, Sint32 cell)
+{
+  if (field->dist[cell] == FLOW_FIELD_UNREACHABLE)
+    {
+      return;
+    }
+
+  Sint32 count = 1;
+  field->raised[0] = cell;
+  field->raised_dist[0] = field->dist[cell];
+  field->dist[cell] = FLOW_FIELD_UNREACHABLE;
+
+  for (Sint32 i = 0; i < count; i++)
+    {
+      const Sint32 raised = field->raised[i];
+      const Uint32 dist = field->raised_dist[i];
+      for (Sint32 n = 0; n < 4; n++)
+        {
+          const Sint32 other = neighbour_of (grid, raised, n);
+          if (other < 0
+              || (field->flags[other] & (FLOW_FIELD_BLOCKED | FLOW_FIELD_SOURCE))
+                     != 0u
+              || field->dist[other] != dist + 1u
+              || is_supported (field, grid, other, dist) == true)
+            {
+              continue;
+            }
+          field->raised[count] = other;
+          field->raised_dist[count] = dist + 1u;
+          field->dist[other] = FLOW_FIELD_UNREACHABLE;
+          count++;
+        }
+    }
+
+  for (Sint32 i = 0; i < count; i++)
+    {
+      const Sint32 raised = field->raised[i];
+      if ((field->flags[raised] & FLOW_FIELD_BLOCKED) != 0u)
+        {
+          continue;
+        }
+      const Uint32 best = closest_neighbour (field, grid, raised);
+      if (best != FLOW_FIELD_UNREACHABLE)
+        {
+          field->dist[raised] = best + 1u;
+          push (field, raised);
+        }
+    }
+  relax (field, grid);
+}
+
+bool
+flow_field_init (struct flow_field *field, const struct grid *grid)
+{
+  flow_field_free (field);
+
+  const size_t size = SDL_max ((size_t)grid_cell_count (grid), (size_t)1u);
+  field->cell_count = grid_cell_count (grid);
+  field->dist = SDL_malloc (size * sizeof (Uint32));
+  field->flags = SDL_calloc (size, sizeof (Uint8));
+  field->queue = SDL_malloc (size * sizeof (Sint32));
+  field->raised = SDL_malloc (size * sizeof (Sint32));
+  field->raised_dist = SDL_malloc (size * sizeof (Uint32));
+  field->sources = SDL_malloc (size * sizeof (Sint32));
+  if (field->dist == NULL || field->flags == NULL || field->queue == NULL
+      || field->raised == NULL || field->raised_dist == NULL
+      || field->sources == NULL)
+    {
+      flow_field_free (field);
+      return false;
+    }
+
+  for (Sint32 i = 0; i < field->cell_count; i++)
+    {
+      field->dist[i] = FLOW_FIELD_UNREACHABLE;
+      if ((grid->cells[i] & GRID_CELL_BLOCKED) != 0u)
+        {
+          field->flags[i] |= FLOW_FIELD_BLOCKED;
+        }
+    }
+
+  return true;
+}
+
+void
+flow_field_free (struct flow_field *field)
+{
+  SDL_free (field->dist);
+  SDL_free (field->flags);
+  SDL_free (field->queue);
+  SDL_free (field->raised);
+  SDL_free (field->raised_dist);
+  SDL_free (field->sources);
+  SDL_zerop (field);
+}
+
+void
+flow_field_set_blocked (struct flow_field *field, const struct grid *grid,
+                        Sint32 x, Sint32 y, bool b_is_blocked)
+{
+  const Sint32 cell = grid_index (grid, x, y);
+  if (cell < 0)
+    {
+      return;
+    }
+  const bool b_was_blocked = (field->flags[cell] & FLOW_FIELD_BLOCKED) != 0u;
+  if (b_is_blocked == b_was_blocked)
+    {
+      return;
+    }
+
+  if (b_is_blocked == true)
+    {
+      field->flags[cell] |= FLOW_FIELD_BLOCKED;
+      if ((field->flags[cell] & FLOW_FIELD_SOURCE) == 0u)
+        {
+          invalidate (field, grid, cell);
+        }
+      return;
+    }
+
+  field->flags[cell] &= (Uint8)~FLOW_FIELD_BLOCKED;
+  if ((field->flags[cell] & FLOW_FIELD_SOURCE) == 0u)
+    {
+      const Uint32 best = closest_neighbour (field, grid, cell);
+      if (best != FLOW_FIELD_UNREACHABLE)
+        {
+          field->dist[cell] = best + 1u;
+          push (field, cell);
+          relax (field, grid);
+        }
+    }
+}
+
+void
+flow_field_set_sources (struct flow_field *field, const struct grid *grid,
+                        const Sint32 *cells, Sint32 count)
+{
+  for (Sint32 i = 0; i < count; i++)
+    {
+      field->flags[cells[i]] |= FLOW_FIELD_WANTED;
+    }
+
+  /* New sources go first: cells they take over are no longer raised when
+   * the old ones are dropped, which keeps a source moving by one cell
+   * cheap. */
+  const Sint32 previous_count = field->source_count;
+  for (Sint32 i = 0; i < count; i++)
+    {
+      const Sint32 cell = cells[i];
+      if ((field->flags[cell] & FLOW_FIELD_SOURCE) != 0u)
+        {
+          continue;
+        }
+      field->flags[cell] |= FLOW_FIELD_SOURCE;
+      field->dist[cell] = 0u;
+      field->sources[field->source_count++] = cell;
+      push (field, cell);
+    }
+  relax (field, grid);
+
+  Sint32 kept = 0;
+  for (Sint32 i = 0; i < field->source_count; i++)
+    {
+      const Sint32 cell = field->sources[i];
+      if (i >= previous_count || (field->flags[cell] & FLOW_FIELD_WANTED) != 0u)
+        {
+          field->sources[kept++] = cell;
+          continue;
+        }
+      field->flags[cell] &= (Uint8)~FLOW_FIELD_SOURCE;
+      invalidate (field, grid, cell);
+    }
+  field->source_count = kept;
+
+  for (Sint32 i = 0; i < count; i++)
+    {
+      field->flags[cells[i]] &= (Uint8)~FLOW_FIELD_WANTED;
+    }
+}
+
+SDL_Point
+flow_field_step (const struct flow_field *field, const struct grid *grid,
+                 Sint32 x, Sint32 y)
+{
+  const Sint32 cell = grid_index (grid, x, y);
+  SDL_Point step = { 0, 0 };
+  if (cell < 0 || field->dist[cell] == FLOW_FIELD_UNREACHABLE)
+    {
+      return step;
+    }
+
+  Uint32 best = field->dist[cell];
+  for (Sint32 n = 0; n < 4; n++)
+    {
+      const Sint32 other = neighbour_of (grid, cell, n);
+      if (other >= 0 && field->dist[other] < best)
+        {
+          best = field->dist[other];
+          step = neighbours[n];
+        }
+    }
+  return step;
+}
@@ -0,0 +1,73 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Flow field (Dijkstra map) over the cell grid: every cell holds its step
+ *  distance to the nearest source, so any number of agents can head for the
+ *  sources with a neighbour lookup each. Blocking, unblocking and moving the
+ *  sources only repair the part of the field whose distances change. The
+ *  field is addressed with the dense cell indices of the grid it was built
+ *  on, which has to be passed along to every call. */
+
+#ifndef BOMBERMAN_FLOW_FIELD_H
+#define BOMBERMAN_FLOW_FIELD_H
+
+#include "SDL3/SDL.h"
+
+#include "grid.h"
+
+#define FLOW_FIELD_UNREACHABLE UINT32_MAX
+
+struct flow_field
+{
+  Sint32 cell_count;
+  Uint32 *dist;  /* Steps to the nearest source, per dense cell index. */
+  Uint8 *flags;  /* See flow_field.c. */
+  Sint32 *queue; /* Ring of cells waiting to relax their neighbours. */
+  Sint32 queue_head;
+  Sint32 queue_count;
+  Sint32 *raised; /* Cells invalidated by the last removal. */
+  Uint32 *raised_dist;
+  Sint32 *sources;
+  Sint32 source_count;
+};
+
+/**
+ * Allocates a field over the stored cells of a grid, closing its blocked
+ * cells. There is no source yet, so every cell is unreachable. Any storage
+ * previously held by the field is released first.
+ * @return false if the allocation failed.
+ */
+bool flow_field_init (struct flow_field *field, const struct grid *grid);
+void flow_field_free (struct flow_field *field);
+
+/**
+ * Opens or closes a cell. A closed cell can still be a source, a bomber
+ * standing on their own bomb remains a target.
+ */
+void flow_field_set_blocked (struct flow_field *field,
+                             const struct grid *grid, Sint32 x, Sint32 y,
+                             bool b_is_blocked);
+
+/**
+ * Replaces the sources with the given dense cell indices. Cells which were
+ * already sources are left alone, duplicates are ignored.
+ */
+void flow_field_set_sources (struct flow_field *field,
+                             const struct grid *grid, const Sint32 *cells,
+                             Sint32 count);
+
+static inline Uint32
+flow_field_get (const struct flow_field *field, const struct grid *grid,
+                Sint32 x, Sint32 y)
+{
+  const Sint32 index = grid_index (grid, x, y);
+  return index < 0 ? FLOW_FIELD_UNREACHABLE : field->dist[index];
+}
+
+/**
+ * @return the step towards the closest neighbour nearer to a source than
+ * (x, y), or { 0, 0 } at a source and where no source can be reached. Ties
+ * go up, left, down then right.
+ */
+SDL_Point flow_field_step (const struct flow_field *field,
+                           const struct grid *grid, Sint32 x, Sint32 y);
+
+#endif /* BOMBERMAN_FLOW_FIELD_H */
@@ -0,0 +1,86 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Packed cell grid. */
+
+#include "grid.h"
+
+bool
+grid_init (struct grid *grid, Sint32 w, Sint32 h)
+{
+  grid_free (grid);
+
+  const Sint32 chunks_w = (w + GRID_CHUNK_SIZE - 1) / GRID_CHUNK_SIZE;
+  const Sint32 chunks_h = (h + GRID_CHUNK_SIZE - 1) / GRID_CHUNK_SIZE;
+  const size_t chunk_count = (size_t)chunks_w * (size_t)chunks_h;
+  grid->chunks = SDL_malloc (SDL_max (chunk_count, (size_t)1u)
+                             * sizeof (Sint32));
+  grid->slot_chunks = SDL_malloc (SDL_max (chunk_count, (size_t)1u)
+                                  * sizeof (Sint32));
+  if (grid->chunks == NULL || grid->slot_chunks == NULL)
+    {
+      grid_free (grid);
+      return false;
+    }
+  for (size_t i = 0; i < chunk_count; i++)
+    {
+      grid->chunks[i] = -1;
+    }
+  grid->w = w;
+  grid->h = h;
+  grid->chunks_w = chunks_w;
+  grid->chunks_h = chunks_h;
+
+  return true;
+}
+
+void
+grid_free (struct grid *grid)
+{
+  SDL_free (grid->chunks);
+  SDL_free (grid->slot_chunks);
+  SDL_free (grid->cells);
+  SDL_zerop (grid);
+}
+
+bool
+grid_reserve (struct grid *grid, Sint32 slot_count)
+{
+  if (slot_count <= grid->slot_capacity)
+    {
+      return true;
+    }
+
+  Uint8 *cells
+      = SDL_realloc (grid->cells, (size_t)slot_count * GRID_CHUNK_CELLS);
+  if (cells == NULL)
+    {
+      return false;
+    }
+  grid->cells = cells;
+  grid->slot_capacity = slot_count;
+  return true;
+}
+
+bool
+grid_populate (struct grid *grid, Sint32 x, Sint32 y)
+{
+  const Sint32 chunk
+      = (y >> GRID_CHUNK_BITS) * grid->chunks_w + (x >> GRID_CHUNK_BITS);
+  if (grid->chunks[chunk] >= 0)
+    {
+      return true;
+    }
+
+  const Sint32 slot = grid->slot_count;
+  if (slot == grid->slot_capacity
+      && grid_reserve (grid, SDL_max (grid->slot_capacity * 2, 4)) == false)
+    {
+      return false;
+    }
+  SDL_memset (&grid->cells[slot * GRID_CHUNK_CELLS],
+              GRID_CELL_VOID | GRID_CELL_BLOCKED, GRID_CHUNK_CELLS);
+  grid->chunks[chunk] = slot;
+  grid->slot_chunks[slot] = chunk;
+  grid->slot_count++;
+
+  return true;
+}
@@ -0,0 +1,149 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Packed cell grid: one byte of flags per cell. The map is cut in square
+ *  chunks and only the chunks holding part of the map get storage, so a huge
+ *  arena costs what its populated chunks cost. Each stored cell also has a
+ *  dense index, which the other per-cell tables (flow field, danger map) use
+ *  to size and address their own storage. */
+
+#ifndef BOMBERMAN_GRID_H
+#define BOMBERMAN_GRID_H
+
+#include "SDL3/SDL.h"
+
+#define GRID_CHUNK_BITS 5
+#define GRID_CHUNK_SIZE (1 << GRID_CHUNK_BITS) /* Cells per chunk side. */
+#define GRID_CHUNK_MASK (GRID_CHUNK_SIZE - 1)
+#define GRID_CHUNK_CELLS (GRID_CHUNK_SIZE * GRID_CHUNK_SIZE)
+
+enum grid_cell_flags
+{
+  GRID_CELL_BLOCKED = 1u << 0,
+  GRID_CELL_BOMB = 1u << 1,
+  GRID_CELL_EXPLOSION = 1u << 2,
+  GRID_CELL_ROCK = 1u << 3, /* The blocking object is a rock. */
+  GRID_CELL_VOID = 1u << 4, /* Outside the map, always blocked as well. */
+};
+
+struct grid
+{
+  Sint32 w;
+  Sint32 h;
+  Sint32 chunks_w;
+  Sint32 chunks_h;
+  Sint32 *chunks;      /* Storage slot of each chunk, -1 if unpopulated. */
+  Sint32 *slot_chunks; /* Chunk stored in each slot. */
+  Sint32 slot_count;
+  Sint32 slot_capacity;
+  Uint8 *cells; /* GRID_CHUNK_CELLS flags per slot, row-major within. */
+};
+
+/**
+ * Sets up a w * h grid with no chunk populated, every cell is void. Any
+ * storage previously held by the grid is released first, so a zeroed struct
+ * or a used grid can both be passed.
+ * @return false if the allocation failed.
+ */
+bool grid_init (struct grid *grid, Sint32 w, Sint32 h);
+void grid_free (struct grid *grid);
+
+/**
+ * Makes room for slot_count chunks in total, so as many can be populated
+ * without reallocating.
+ * @return false if the allocation failed.
+ */
+bool grid_reserve (struct grid *grid, Sint32 slot_count);
+
+/**
+ * Gives storage to the chunk holding (x, y), if it has none yet. The cells of
+ * a new chunk start out void.
+ * @return false if the allocation failed.
+ */
+bool grid_populate (struct grid *grid, Sint32 x, Sint32 y);
+
+/**
+ * @return the number of dense cell indices, stored cells included.
+ */
+static inline Sint32
+grid_cell_count (const struct grid *grid)
+{
+  return grid->slot_count * GRID_CHUNK_CELLS;
+}
+
+static inline bool
+grid_contains (const struct grid *grid, Sint32 x, Sint32 y)
+{
+  return x >= 0 && y >= 0 && x < grid->w && y < grid->h;
+}
+
+/**
+ * @return the dense index of a cell, or -1 if it is off the grid or in an
+ * unpopulated chunk.
+ */
+static inline Sint32
+grid_index (const struct grid *grid, Sint32 x, Sint32 y)
+{
+  if (grid_contains (grid, x, y) == false)
+    {
+      return -1;
+    }
+  const Sint32 slot = grid->chunks[(y >> GRID_CHUNK_BITS) * grid->chunks_w
+                                   + (x >> GRID_CHUNK_BITS)];
+  if (slot < 0)
+    {
+      return -1;
+    }
+  return slot * GRID_CHUNK_CELLS + ((y & GRID_CHUNK_MASK) << GRID_CHUNK_BITS)
+         + (x & GRID_CHUNK_MASK);
+}
+
+/* Inverse of grid_index. */
+static inline SDL_Point
+grid_position (const struct grid *grid, Sint32 index)
+{
+  const Sint32 chunk = grid->slot_chunks[index / GRID_CHUNK_CELLS];
+  const Sint32 local = index & (GRID_CHUNK_CELLS - 1);
+  return (SDL_Point){
+    .x = (chunk % grid->chunks_w) * GRID_CHUNK_SIZE + (local & GRID_CHUNK_MASK),
+    .y = (chunk / grid->chunks_w) * GRID_CHUNK_SIZE + (local >> GRID_CHUNK_BITS)
+  };
+}
+
+/**
+ * @return the flags of a cell. Cells which are not stored read as void.
+ */
+static inline Uint8
+grid_get (const struct grid *grid, Sint32 x, Sint32 y)
+{
+  const Sint32 index = grid_index (grid, x, y);
+  return index < 0 ? (Uint8)(GRID_CELL_VOID | GRID_CELL_BLOCKED)
+                   : grid->cells[index];
+}
+
+static inline bool
+grid_has (const struct grid *grid, Sint32 x, Sint32 y, Uint8 flag)
+{
+  return (grid_get (grid, x, y) & flag) != 0u;
+}
+
+/* Writes to cells which are not stored are dropped. */
+static inline void
+grid_set (struct grid *grid, Sint32 x, Sint32 y, Uint8 flag)
+{
+  const Sint32 index = grid_index (grid, x, y);
+  if (index >= 0)
+    {
+      grid->cells[index] |= flag;
+    }
+}
+
+static inline void
+grid_clear (struct grid *grid, Sint32 x, Sint32 y, Uint8 flag)
+{
+  const Sint32 index = grid_index (grid, x, y);
+  if (index >= 0)
+    {
+      grid->cells[index] &= (Uint8)~flag;
+    }
+}
+
+#endif /* BOMBERMAN_GRID_H */
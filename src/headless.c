@@ -0,0 +1,234 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Headless runner: builds the world, loads a map and steps the simulation
+ *  for a fixed number of ticks without presenting anything. Meant for CI and
+ *  batch machines which have neither a display nor a GPU. Every tick is
+ *  also snapshotted into a rollback history, and the end of the run is rolled
+ *  back and replayed to check the simulation comes out the same.
+ *
+ *  With --replay, it plays a recorded match back as fast as it can instead,
+ *  and checks it ends in the recorded state. The map is the one the replay
+ *  names, unless another path is given.
+ *
+ *  Usage: bomberman_headless [ticks] [map path] [seed]
+ *         bomberman_headless --replay <replay path> [map path] */
+
+#include "SDL3/SDL.h"
+
+/* Simulation library (game rules, prefabs, map). Pulls in Pluto. */
+#include "sim.h"
+
+/* Offscreen Pluto core, and the input callbacks it expects. */
+#include "offscreen.h"
+
+/* Game modules dependencies. */
+#include "log.h"
+Sint32 DEBUG_LOG
+    = DEBUG_LOG_NONE; /* Minimum log level for debug_log calls to print. */
+
+#define HEADLESS_DEFAULT_TICKS 10000u
+#define HEADLESS_DEFAULT_SEED 1u
+
+/**
+ * Plays every tick of a replay, then compares the final state with the
+ * recorded one.
+ * @return whether the replay came out as recorded.
+ */
+static bool
+play_replay (ecs_world_t *world, const struct replay *replay)
+{
+  const double frequency = (double)SDL_GetPerformanceFrequency ();
+  const Uint64 start = SDL_GetPerformanceCounter ();
+  for (Uint64 tick = 0u; tick < replay->tick_count; tick++)
+    {
+      const Uint8 *inputs = replay->inputs + tick * replay->player_count;
+      for (Sint32 player = 0;
+           player < SDL_min (replay->player_count, SIM_MAX_PLAYERS); player++)
+        {
+          write_sim_input (world, get_player_controller (world, player),
+                           inputs[player]);
+        }
+      tick_sim (world);
+      ecs_progress (world, 0.f);
+    }
+  const Uint64 end = SDL_GetPerformanceCounter ();
+
+  const double seconds = (double)(end - start) / frequency;
+  SDL_Log ("replay of %llu ticks in %.3f s (%.1f ticks/s)",
+           (unsigned long long)replay->tick_count, seconds,
+           seconds > 0.0 ? (double)replay->tick_count / seconds : 0.0);
+  if (replay->b_has_state_hash == false)
+    {
+      SDL_Log ("replay has no final state, it was not closed");
+      return true;
+    }
+
+  const bool b_matches = hash_sim (world) == replay->state_hash;
+  SDL_Log ("final state %s", b_matches == true ? "matches" : "DIFFERS");
+  return b_matches;
+}
+
+int
+main (int argc, char *argv[])
+{
+  const bool b_is_replay
+      = argc > 2 && SDL_strcmp (argv[1], "--replay") == 0;
+  struct replay replay = { 0 };
+  if (b_is_replay == true && replay_load (argv[2], &replay) == false)
+    {
+      SDL_Log ("Failed to load replay %s", argv[2]);
+      return 1;
+    }
+  /* Players past the sim's controllers could not be played back, and the
+   * match would not come out as recorded. */
+  if (b_is_replay == true && replay.player_count > SIM_MAX_PLAYERS)
+    {
+      SDL_Log ("Replay %s has %d players, at most %d are supported",
+               argv[2], replay.player_count, SIM_MAX_PLAYERS);
+      replay_free (&replay);
+      return 1;
+    }
+
+  Uint32 tick_count = HEADLESS_DEFAULT_TICKS;
+  const char *map_path = "dat/maps/map0.txt";
+  Uint64 seed = HEADLESS_DEFAULT_SEED;
+  Sint32 player_count = 1;
+  if (b_is_replay == true)
+    {
+      map_path = argc > 3 ? argv[3] : replay.map_path;
+      seed = replay.seed;
+      player_count = replay.player_count;
+    }
+  else
+    {
+      tick_count = argc > 1 ? (Uint32)SDL_strtoul (argv[1], NULL, 10)
+                            : HEADLESS_DEFAULT_TICKS;
+      map_path = argc > 2 ? argv[2] : map_path;
+      seed = argc > 3 ? (Uint64)SDL_strtoull (argv[3], NULL, 10) : seed;
+    }
+
+  struct map map = { 0 };
+  if (map_load (map_path, &map) == false)
+    {
+      SDL_Log ("Failed to load map %s", map_path);
+      return 1;
+    }
+  if (b_is_replay == true
+      && replay_map_checksum (&map.grid) != replay.map_checksum)
+    {
+      SDL_Log ("Map %s is not the one the replay was recorded on", map_path);
+      return 1;
+    }
+
+  ecs_world_t *world = ecs_init ();
+  init_offscreen_pluto (world, &map.grid, "Doomsday (headless)");
+
+  init_sim (world);
+  seed_sim (world, seed);
+  create_map (world, &map);
+  create_bombers (world, &map, player_count, 0);
+  create_characters (world, &map);
+  map_free (&map);
+
+  if (b_is_replay == true)
+    {
+      const bool b_matches = play_replay (world, &replay);
+      replay_free (&replay);
+      fini_sim (world);
+      ecs_fini (world);
+      SDL_Quit ();
+      return b_matches == true ? 0 : 1;
+    }
+
+  /* Every tick is also recorded into a rollback history, its cost is
+   * reported on its own. */
+  struct snapshot_ring history = { 0 };
+  Uint8 *state = NULL;
+  size_t state_capacity = 0u;
+  size_t state_size = 0u;
+  Uint64 snapshot_time = 0u;
+  if (snapshot_ring_init (&history, SNAPSHOT_HISTORY_FRAMES) == false)
+    {
+      SDL_Log ("Failed to allocate the snapshot history");
+      fini_sim (world);
+      ecs_fini (world);
+      SDL_Quit ();
+      return 1;
+    }
+
+  const double frequency = (double)SDL_GetPerformanceFrequency ();
+  const Uint64 start = SDL_GetPerformanceCounter ();
+  for (Uint32 tick = 0u; tick < tick_count; tick++)
+    {
+      tick_sim (world);
+      ecs_progress (world, 0.f);
+
+      const Uint64 snapshot_start = SDL_GetPerformanceCounter ();
+      state_size = snapshot_sim (world, &state, &state_capacity);
+      snapshot_ring_push (&history,
+                          ecs_singleton_get (world, game_s)->timers.now,
+                          state, state_size);
+      snapshot_time += SDL_GetPerformanceCounter () - snapshot_start;
+    }
+  const Uint64 end = SDL_GetPerformanceCounter ();
+
+  const double seconds = (double)(end - start - snapshot_time) / frequency;
+  SDL_Log ("%u ticks in %.3f s (%.1f ticks/s)", tick_count, seconds,
+           seconds > 0.0 ? (double)tick_count / seconds : 0.0);
+  SDL_Log ("snapshots: %.2f us per tick, %d ticks of history in %llu bytes "
+           "(%llu bytes per state)",
+           tick_count > 0u
+               ? (double)snapshot_time * 1e6 / frequency / tick_count
+               : 0.0,
+           history.count, (unsigned long long)snapshot_ring_bytes (&history),
+           (unsigned long long)state_size);
+
+  /* Roll half the history back and play it again, the match has to end up
+   * in the very same state. */
+  const Uint64 now = ecs_singleton_get (world, game_s)->timers.now;
+  const Uint64 rollback = SDL_min ((Uint64)tick_count / 2u,
+                                   (Uint64)SNAPSHOT_HISTORY_FRAMES / 2u);
+  size_t past_size = 0u;
+  const Uint8 *past = snapshot_ring_get (&history, now - rollback, &past_size);
+  Uint8 *expected = SDL_malloc (SDL_max (state_size, (size_t)1u));
+  if (rollback > 0u && past != NULL && expected != NULL)
+    {
+      SDL_memcpy (expected, state, state_size);
+      const Uint64 restore_start = SDL_GetPerformanceCounter ();
+      const bool b_is_restored = restore_sim (world, past, past_size);
+      const Uint64 restore_end = SDL_GetPerformanceCounter ();
+      for (Uint64 tick = 0u; tick < rollback; tick++)
+        {
+          tick_sim (world);
+          ecs_progress (world, 0.f);
+        }
+      const size_t replayed_size
+          = snapshot_sim (world, &state, &state_capacity);
+      SDL_Log ("rollback of %llu ticks: restored in %.2f us, replay %s",
+               (unsigned long long)rollback,
+               (double)(restore_end - restore_start) * 1e6 / frequency,
+               b_is_restored == true && replayed_size == state_size
+                       && SDL_memcmp (expected, state, state_size) == 0
+                   ? "matches"
+                   : "DIFFERS");
+    }
+  SDL_free (expected);
+  SDL_free (state);
+  snapshot_ring_free (&history);
+
+  const game_s *game = ecs_singleton_get (world, game_s);
+  static const char *pool_names[SIM_POOL_COUNT] = { "bombs", "explosions" };
+  for (Sint32 i = 0; i < SIM_POOL_COUNT; i++)
+    {
+      const struct entity_pool *pool = &game->pools[i];
+      SDL_Log ("pool %s: %llu created, %llu reused, %llu released",
+               pool_names[i], (unsigned long long)pool->created,
+               (unsigned long long)pool->reused,
+               (unsigned long long)pool->released);
+    }
+
+  fini_sim (world);
+  ecs_fini (world);
+  SDL_Quit ();
+
+  return 0;
+}
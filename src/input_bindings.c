@@ -0,0 +1,317 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette */
+
+#include "input_bindings.h"
+
+#include "log.h"
+
+#define INPUT_MAX_CONTROL_NAME 64
+
+static const struct input_binding default_bindings[] = {
+  { 0, INPUT_DEVICE_KEY, SDL_SCANCODE_W, SIM_INPUT_UP, false },
+  { 0, INPUT_DEVICE_KEY, SDL_SCANCODE_S, SIM_INPUT_DOWN, false },
+  { 0, INPUT_DEVICE_KEY, SDL_SCANCODE_A, SIM_INPUT_LEFT, false },
+  { 0, INPUT_DEVICE_KEY, SDL_SCANCODE_D, SIM_INPUT_RIGHT, false },
+  { 0, INPUT_DEVICE_KEY, SDL_SCANCODE_SPACE, SIM_INPUT_BOMB, false },
+  { 1, INPUT_DEVICE_KEY, SDL_SCANCODE_UP, SIM_INPUT_UP, false },
+  { 1, INPUT_DEVICE_KEY, SDL_SCANCODE_DOWN, SIM_INPUT_DOWN, false },
+  { 1, INPUT_DEVICE_KEY, SDL_SCANCODE_LEFT, SIM_INPUT_LEFT, false },
+  { 1, INPUT_DEVICE_KEY, SDL_SCANCODE_RIGHT, SIM_INPUT_RIGHT, false },
+  { 1, INPUT_DEVICE_KEY, SDL_SCANCODE_RSHIFT, SIM_INPUT_BOMB, false },
+  { 0, INPUT_DEVICE_PAD, SDL_GAMEPAD_BUTTON_DPAD_UP, SIM_INPUT_UP, false },
+  { 0, INPUT_DEVICE_PAD, SDL_GAMEPAD_BUTTON_DPAD_DOWN, SIM_INPUT_DOWN, false },
+  { 0, INPUT_DEVICE_PAD, SDL_GAMEPAD_BUTTON_DPAD_LEFT, SIM_INPUT_LEFT, false },
+  { 0, INPUT_DEVICE_PAD, SDL_GAMEPAD_BUTTON_DPAD_RIGHT, SIM_INPUT_RIGHT,
+    false },
+  { 0, INPUT_DEVICE_PAD, SDL_GAMEPAD_BUTTON_SOUTH, SIM_INPUT_BOMB, false },
+  { 1, INPUT_DEVICE_PAD, SDL_GAMEPAD_BUTTON_DPAD_UP, SIM_INPUT_UP, false },
+  { 1, INPUT_DEVICE_PAD, SDL_GAMEPAD_BUTTON_DPAD_DOWN, SIM_INPUT_DOWN, false },
+  { 1, INPUT_DEVICE_PAD, SDL_GAMEPAD_BUTTON_DPAD_LEFT, SIM_INPUT_LEFT, false },
+  { 1, INPUT_DEVICE_PAD, SDL_GAMEPAD_BUTTON_DPAD_RIGHT, SIM_INPUT_RIGHT,
+    false },
+  { 1, INPUT_DEVICE_PAD, SDL_GAMEPAD_BUTTON_SOUTH, SIM_INPUT_BOMB, false },
+};
+
+/* Input of a binding file word, or 0 for none. */
+static Uint8
+input_of (const char *word)
+{
+  static const struct
+  {
+    const char *word;
+    Uint8 input;
+  } inputs[] = { { "up", SIM_INPUT_UP },
+                 { "down", SIM_INPUT_DOWN },
+                 { "left", SIM_INPUT_LEFT },
+                 { "right", SIM_INPUT_RIGHT },
+                 { "bomb", SIM_INPUT_BOMB } };
+  for (size_t i = 0u; i < SDL_arraysize (inputs); i++)
+    {
+      if (SDL_strcasecmp (word, inputs[i].word) == 0)
+        {
+          return inputs[i].input;
+        }
+    }
+  return 0u;
+}
+
+/**
+ * Reads one line of a binding file.
+ * @return false if it is not a binding.
+ */
+static bool
+parse_binding (const char *line, struct input_binding *binding)
+{
+  char input[16];
+  char device[16];
+  char control[INPUT_MAX_CONTROL_NAME];
+  Sint32 player = 0;
+  if (SDL_sscanf (line, "%d %15s %15s %63[^\r\n]", &player, input, device,
+                  control)
+      != 4)
+    {
+      return false;
+    }
+
+  *binding = (struct input_binding){ .player = player - 1,
+                                     .input = input_of (input) };
+  if (SDL_strcasecmp (device, "key") == 0)
+    {
+      binding->device = INPUT_DEVICE_KEY;
+      binding->control = (Sint32)SDL_GetScancodeFromName (control);
+      binding->control = binding->control != SDL_SCANCODE_UNKNOWN
+                             ? binding->control
+                             : -1;
+    }
+  else if (SDL_strcasecmp (device, "pad") == 0)
+    {
+      binding->device = INPUT_DEVICE_PAD;
+      binding->control = (Sint32)SDL_GetGamepadButtonFromString (control);
+    }
+  else
+    {
+      return false;
+    }
+  return binding->player >= 0 && binding->player < SIM_MAX_PLAYERS
+         && binding->input != 0u && binding->control >= 0;
+}
+
+static void
+use_default_bindings (struct input_bindings *bindings)
+{
+  arr_input_binding_reset (bindings->bindings);
+  for (size_t i = 0u; i < SDL_arraysize (default_bindings); i++)
+    {
+      arr_input_binding_push_back (bindings->bindings, default_bindings[i]);
+    }
+}
+
+bool
+input_bindings_load (struct input_bindings *bindings, const char *path)
+{
+  SDL_zerop (bindings);
+  arr_input_binding_init (bindings->bindings);
+
+  char *text = SDL_LoadFile (path, NULL);
+  if (text == NULL)
+    {
+      use_default_bindings (bindings);
+      return false;
+    }
+
+  Sint32 line_number = 1;
+  for (char *line = text; *line != '\0'; line_number++)
+    {
+      char *end = SDL_strchr (line, '\n');
+      if (end != NULL)
+        {
+          *end = '\0';
+        }
+      while (*line == ' ' || *line == '\t')
+        {
+          line++;
+        }
+
+      struct input_binding binding;
+      if (*line == '\0' || *line == '\r' || *line == '#')
+        {
+          /* Blank line or comment. */
+        }
+      else if (parse_binding (line, &binding) == true)
+        {
+          arr_input_binding_push_back (bindings->bindings, binding);
+        }
+      else
+        {
+          log_error (0, "%s:%d: not a binding, skipped", path, line_number);
+        }
+      line = end != NULL ? end + 1 : line + SDL_strlen (line);
+    }
+
+  SDL_free (text);
+  return true;
+}
+
+void
+input_bindings_free (struct input_bindings *bindings)
+{
+  for (Sint32 player = 0; player < SIM_MAX_PLAYERS; player++)
+    {
+      SDL_CloseGamepad (bindings->pads[player]);
+    }
+  arr_input_binding_clear (bindings->bindings);
+  SDL_zerop (bindings);
+}
+
+/* Player a gamepad is assigned to, or -1. */
+static Sint32
+player_of_pad (const struct input_bindings *bindings, SDL_JoystickID id)
+{
+  for (Sint32 player = 0; player < SIM_MAX_PLAYERS; player++)
+    {
+      if (bindings->pads[player] != NULL
+          && SDL_GetGamepadID (bindings->pads[player]) == id)
+        {
+          return player;
+        }
+    }
+  return -1;
+}
+
+static void
+add_pad (struct input_bindings *bindings, SDL_JoystickID id)
+{
+  for (Sint32 player = 0; player < SIM_MAX_PLAYERS; player++)
+    {
+      if (bindings->pads[player] == NULL)
+        {
+          bindings->pads[player] = SDL_OpenGamepad (id);
+          return;
+        }
+    }
+}
+
+static void
+remove_pad (struct input_bindings *bindings, SDL_JoystickID id)
+{
+  const Sint32 player = player_of_pad (bindings, id);
+  if (player < 0)
+    {
+      return;
+    }
+  SDL_CloseGamepad (bindings->pads[player]);
+  bindings->pads[player] = NULL;
+
+  /* Whatever the pad held is released. */
+  for (size_t i = 0u; i < arr_input_binding_size (bindings->bindings); i++)
+    {
+      struct input_binding *binding
+          = arr_input_binding_get (bindings->bindings, i);
+      if (binding->device == INPUT_DEVICE_PAD && binding->player == player)
+        {
+          binding->b_is_held = false;
+        }
+    }
+}
+
+/**
+ * Updates the bindings of a control. The pad is -1 for keys, or the player
+ * the pad belongs to.
+ */
+static void
+set_control (struct input_bindings *bindings, Uint8 device, Sint32 pad,
+             Sint32 control, bool b_is_down, Uint64 timestamp, Uint64 frame)
+{
+  for (size_t i = 0u; i < arr_input_binding_size (bindings->bindings); i++)
+    {
+      struct input_binding *binding
+          = arr_input_binding_get (bindings->bindings, i);
+      if (binding->device != device || binding->control != control
+          || (device == INPUT_DEVICE_PAD && binding->player != pad))
+        {
+          continue;
+        }
+
+      const Sint32 player = binding->player;
+      if (b_is_down == true && binding->b_is_held == false
+          && (bindings->pressed[player] & binding->input) == 0u)
+        {
+          if (bindings->pressed[player] == 0u)
+            {
+              bindings->press_ns[player] = timestamp;
+              bindings->press_frame[player] = frame;
+            }
+          bindings->pressed[player] |= binding->input;
+        }
+      binding->b_is_held = b_is_down;
+    }
+}
+
+void
+input_bindings_handle_event (struct input_bindings *bindings,
+                             const SDL_Event *event, Uint64 frame)
+{
+  switch (event->type)
+    {
+    case SDL_EVENT_KEY_DOWN:
+    case SDL_EVENT_KEY_UP:
+      if (event->key.repeat == false)
+        {
+          set_control (bindings, INPUT_DEVICE_KEY, -1, event->key.scancode,
+                       event->key.down, event->key.timestamp, frame);
+        }
+      break;
+    case SDL_EVENT_GAMEPAD_BUTTON_DOWN:
+    case SDL_EVENT_GAMEPAD_BUTTON_UP:
+      set_control (bindings, INPUT_DEVICE_PAD,
+                   player_of_pad (bindings, event->gbutton.which),
+                   event->gbutton.button, event->gbutton.down,
+                   event->gbutton.timestamp, frame);
+      break;
+    case SDL_EVENT_GAMEPAD_ADDED:
+      add_pad (bindings, event->gdevice.which);
+      break;
+    case SDL_EVENT_GAMEPAD_REMOVED:
+      remove_pad (bindings, event->gdevice.which);
+      break;
+    default:
+      break;
+    }
+}
+
+void
+input_bindings_snapshot (const struct input_bindings *bindings,
+                         struct input_snapshot *snapshot)
+{
+  SDL_memcpy (snapshot->inputs, bindings->pressed, sizeof (snapshot->inputs));
+  for (size_t i = 0u; i < arr_input_binding_size (bindings->bindings); i++)
+    {
+      const struct input_binding *binding
+          = arr_input_binding_cget (bindings->bindings, i);
+      if (binding->b_is_held == true)
+        {
+          snapshot->inputs[binding->player] |= binding->input;
+        }
+    }
+}
+
+void
+input_bindings_consume (struct input_bindings *bindings, Uint64 frame)
+{
+  const Uint64 now = SDL_GetTicksNS ();
+  struct input_latency *latency = &bindings->latency;
+  for (Sint32 player = 0; player < SIM_MAX_PLAYERS; player++)
+    {
+      if (bindings->pressed[player] == 0u)
+        {
+          continue;
+        }
+      const Uint64 elapsed = now > bindings->press_ns[player]
+                                 ? now - bindings->press_ns[player]
+                                 : 0u;
+      latency->presses++;
+      latency->total_ns += elapsed;
+      latency->max_ns = SDL_max (latency->max_ns, elapsed);
+      latency->late += bindings->press_frame[player] != frame ? 1u : 0u;
+      bindings->pressed[player] = 0u;
+    }
+}
@@ -0,0 +1,101 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Input bindings: a table mapping keys and gamepad buttons to the inputs of
+ *  the players (see sim_input_bits). The game follows the SDL events to know
+ *  what is held, then builds one snapshot of every player's input per tick.
+ *  A press is kept until the next snapshot has been acted on, so a tap
+ *  shorter than a frame still counts.
+ *
+ *  Bindings are read from a text file, one per line:
+ *    <player> <input> key <scancode name>
+ *    <player> <input> pad <gamepad button name>
+ *  with players counted from 1, inputs among up, down, left, right and
+ *  bomb, and the names SDL gives (see SDL_GetScancodeFromName and
+ *  SDL_GetGamepadButtonFromString). Lines starting with '#' are comments.
+ *  Gamepads go to the players in the order they are plugged in.
+ *
+ *  The latency between a press (its SDL event timestamp) and the tick
+ *  acting on it is measured as the game goes. */
+
+#ifndef BOMBERMAN_INPUT_BINDINGS_H
+#define BOMBERMAN_INPUT_BINDINGS_H
+
+#include "SDL3/SDL.h"
+
+/* M*Lib containers. */
+#include "m-array.h"
+
+#include "sim.h"
+
+enum input_device
+{
+  INPUT_DEVICE_KEY,
+  INPUT_DEVICE_PAD
+};
+
+struct input_binding
+{
+  Sint32 player;
+  Uint8 device;   /* See input_device. */
+  Sint32 control; /* Scancode or gamepad button. */
+  Uint8 input;    /* A sim_input_bits flag. */
+  bool b_is_held;
+};
+
+ARRAY_DEF (arr_input_binding, struct input_binding, M_POD_OPLIST)
+
+/* Input of every player for one tick. */
+struct input_snapshot
+{
+  Uint8 inputs[SIM_MAX_PLAYERS];
+};
+
+struct input_latency
+{
+  Uint64 presses; /* Fresh presses acted on, one per player and tick. */
+  Uint64 total_ns;
+  Uint64 max_ns;
+  Uint64 late; /* Presses acted on a frame after the one polling them. */
+};
+
+struct input_bindings
+{
+  arr_input_binding_t bindings;
+  Uint8 pressed[SIM_MAX_PLAYERS]; /* Pressed since the last acted tick. */
+  Uint64 press_ns[SIM_MAX_PLAYERS];    /* Earliest of these presses. */
+  Uint64 press_frame[SIM_MAX_PLAYERS]; /* Frame it was polled on. */
+  SDL_Gamepad *pads[SIM_MAX_PLAYERS];
+  struct input_latency latency;
+};
+
+/**
+ * Reads the bindings from a file. If it cannot be read, the default
+ * bindings are used instead: WASD and space for player 1, the arrows and
+ * right shift for player 2, and the d-pad and south button on gamepads.
+ * @return false if the defaults had to be used.
+ */
+bool input_bindings_load (struct input_bindings *bindings, const char *path);
+void input_bindings_free (struct input_bindings *bindings);
+
+/**
+ * Follows the keyboard and gamepad events, opening the gamepads as they are
+ * plugged in. Other events are ignored.
+ * @param frame Number of the frame polling the event.
+ */
+void input_bindings_handle_event (struct input_bindings *bindings,
+                                  const SDL_Event *event, Uint64 frame);
+
+/**
+ * Builds the input of every player for the coming tick: what is held, and
+ * what was pressed since the last tick acted on.
+ */
+void input_bindings_snapshot (const struct input_bindings *bindings,
+                              struct input_snapshot *snapshot);
+
+/**
+ * Marks the last snapshot as acted on by a tick: the pending presses are
+ * counted in the latency and forgotten.
+ * @param frame Number of the frame running the tick.
+ */
+void input_bindings_consume (struct input_bindings *bindings, Uint64 frame);
+
+#endif /* BOMBERMAN_INPUT_BINDINGS_H */
@@ -0,0 +1,177 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Fixed set of worker threads. */
+
+#include "job_pool.h"
+
+#define JOB_POOL_MAX_THREADS 64
+
+struct job_pool
+{
+  SDL_Thread *threads[JOB_POOL_MAX_THREADS];
+  Sint32 thread_count;
+  SDL_Mutex *mutex;
+  SDL_Condition *wake;
+  SDL_Condition *done;
+  Uint64 generation; /* Bumped for every job handed to the workers. */
+  Sint32 pending;    /* Workers still busy on the current job. */
+  bool b_is_quitting;
+
+  job_pool_fn fn;
+  void *ctx;
+  size_t count;
+  size_t chunk_size;
+  SDL_AtomicInt next_chunk;
+};
+
+static void
+run_chunks (struct job_pool *pool)
+{
+  while (true)
+    {
+      const size_t chunk = (size_t)SDL_AddAtomicInt (&pool->next_chunk, 1);
+      const size_t begin = chunk * pool->chunk_size;
+      if (begin >= pool->count)
+        {
+          return;
+        }
+      pool->fn (pool->ctx, begin,
+                SDL_min (begin + pool->chunk_size, pool->count));
+    }
+}
+
+static int
+worker_main (void *data)
+{
+  struct job_pool *pool = data;
+  Uint64 seen = 0u;
+
+  while (true)
+    {
+      SDL_LockMutex (pool->mutex);
+      while (pool->generation == seen && pool->b_is_quitting == false)
+        {
+          SDL_WaitCondition (pool->wake, pool->mutex);
+        }
+      if (pool->b_is_quitting == true)
+        {
+          SDL_UnlockMutex (pool->mutex);
+          return 0;
+        }
+      seen = pool->generation;
+      SDL_UnlockMutex (pool->mutex);
+
+      run_chunks (pool);
+
+      SDL_LockMutex (pool->mutex);
+      pool->pending--;
+      if (pool->pending == 0)
+        {
+          SDL_SignalCondition (pool->done);
+        }
+      SDL_UnlockMutex (pool->mutex);
+    }
+}
+
+struct job_pool *
+job_pool_create (Sint32 thread_count)
+{
+  if (thread_count < 0)
+    {
+      thread_count = SDL_GetNumLogicalCPUCores () - 1;
+    }
+  thread_count = SDL_clamp (thread_count, 0, JOB_POOL_MAX_THREADS);
+
+  struct job_pool *pool = SDL_calloc (1, sizeof (struct job_pool));
+  if (pool == NULL)
+    {
+      return NULL;
+    }
+  pool->mutex = SDL_CreateMutex ();
+  pool->wake = SDL_CreateCondition ();
+  pool->done = SDL_CreateCondition ();
+  if (pool->mutex == NULL || pool->wake == NULL || pool->done == NULL)
+    {
+      job_pool_destroy (pool);
+      return NULL;
+    }
+
+  for (Sint32 i = 0; i < thread_count; i++)
+    {
+      pool->threads[i] = SDL_CreateThread (worker_main, "job_pool", pool);
+      if (pool->threads[i] == NULL)
+        {
+          break;
+        }
+      pool->thread_count++;
+    }
+
+  return pool;
+}
+
+void
+job_pool_destroy (struct job_pool *pool)
+{
+  if (pool == NULL)
+    {
+      return;
+    }
+
+  if (pool->mutex != NULL)
+    {
+      SDL_LockMutex (pool->mutex);
+      pool->b_is_quitting = true;
+      SDL_BroadcastCondition (pool->wake);
+      SDL_UnlockMutex (pool->mutex);
+    }
+  for (Sint32 i = 0; i < pool->thread_count; i++)
+    {
+      SDL_WaitThread (pool->threads[i], NULL);
+    }
+
+  SDL_DestroyCondition (pool->done);
+  SDL_DestroyCondition (pool->wake);
+  SDL_DestroyMutex (pool->mutex);
+  SDL_free (pool);
+}
+
+Sint32
+job_pool_get_thread_count (const struct job_pool *pool)
+{
+  return pool->thread_count;
+}
+
+void
+job_pool_run (struct job_pool *pool, size_t count, size_t chunk_size,
+              job_pool_fn fn, void *ctx)
+{
+  if (count == 0u)
+    {
+      return;
+    }
+  chunk_size = SDL_max (chunk_size, (size_t)1u);
+  if (pool == NULL || pool->thread_count == 0 || count <= chunk_size)
+    {
+      fn (ctx, 0u, count);
+      return;
+    }
+
+  SDL_LockMutex (pool->mutex);
+  pool->fn = fn;
+  pool->ctx = ctx;
+  pool->count = count;
+  pool->chunk_size = chunk_size;
+  SDL_SetAtomicInt (&pool->next_chunk, 0);
+  pool->pending = pool->thread_count;
+  pool->generation++;
+  SDL_BroadcastCondition (pool->wake);
+  SDL_UnlockMutex (pool->mutex);
+
+  run_chunks (pool);
+
+  SDL_LockMutex (pool->mutex);
+  while (pool->pending > 0)
+    {
+      SDL_WaitCondition (pool->done, pool->mutex);
+    }
+  SDL_UnlockMutex (pool->mutex);
+}
@@ -0,0 +1,33 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Fixed set of worker threads splitting a range of items between them. The
+ *  calling thread works alongside the workers and only returns once the
+ *  whole range is done, so a job is a parallel for loop. */
+
+#ifndef BOMBERMAN_JOB_POOL_H
+#define BOMBERMAN_JOB_POOL_H
+
+#include "SDL3/SDL.h"
+
+/* Processes the items in [begin, end). Must not touch the ECS world. */
+typedef void (*job_pool_fn) (void *ctx, size_t begin, size_t end);
+
+struct job_pool;
+
+/**
+ * @param thread_count Workers to spawn besides the calling thread. A negative
+ * count picks one less than the number of logical cores.
+ * @return NULL if the pool could not be created.
+ */
+struct job_pool *job_pool_create (Sint32 thread_count);
+void job_pool_destroy (struct job_pool *pool);
+
+Sint32 job_pool_get_thread_count (const struct job_pool *pool);
+
+/**
+ * Runs fn over [0, count) in chunks of chunk_size items and waits for all of
+ * them. Small ranges are run inline on the calling thread.
+ */
+void job_pool_run (struct job_pool *pool, size_t count, size_t chunk_size,
+                   job_pool_fn fn, void *ctx);
+
+#endif /* BOMBERMAN_JOB_POOL_H */
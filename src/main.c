@@ -18,407 +18,92 @@
 #include "SDL3/SDL.h"
 #include "randombytes.h"
 
-/* Pluto framework. */
-#include "pluto.h"
+/* Simulation library (game rules, prefabs, map). Pulls in Pluto. */
+#include "sim.h"
 
 /* Game modules dependencies. */
 #include "input_man.h"
 #include "log.h"
 Sint32 DEBUG_LOG
     = DEBUG_LOG_NONE; /* Minimum log level for debug_log calls to print. */
-#include "render_target.h"
 
-#define CELL_SIZE 32
-#define MAP_CELL_COUNT_W 30
-#define MAP_CELL_COUNT_H 15
-#define MAP_WIDTH (CELL_SIZE * MAP_CELL_COUNT_W)
-#define MAP_HEIGHT (CELL_SIZE * MAP_CELL_COUNT_H)
-#define LOGIC_WIDTH (MAP_WIDTH / 2)
-#define LOGIC_HEIGHT (MAP_HEIGHT)
+#include "input_bindings.h"
+#include "map_view.h"
+#include "netplay.h"
 
-/* Game-specific components. */
-typedef struct singleton_game
-{
-  ecs_entity_t P1;
-  ecs_entity_t P2;
-  ecs_entity_t AI;
-  ecs_entity_t camera;
-  mat2d_entity_t cells;
-  ecs_entity_t current_scene;
-  dict_string_to_query_ptr_t queries;
-} game_s;
-
-typedef struct component_bomb_storage
-{
-  Sint8 max_count;
-  Sint8 count;
-} bomb_storage_c;
-
-typedef struct component_brain
-{
-  bool b_is_active;
-} brain_c;
-
-typedef struct component_cell_data
-{
-  bool b_is_blocked;
-  bool b_has_bomb;
-  bool b_has_explosion;
-} cell_data_c;
-
-typedef struct component_lifetime
-{
-  Uint32 duration;
-  void (*on_delete_callback) (ecs_world_t *world, ecs_entity_t ent);
-} lifetime_c;
-
-typedef struct component_controller
-{
-  SDL_Point control_delta;
-  ecs_entity_t pawn;
-} controller_c;
+#define BINDINGS_PATH "dat/bindings.txt"
+#define MAX_FRAME_TICKS 4 /* Past this many ticks per frame, the game slows. */
 
-ECS_COMPONENT_DECLARE (game_s);
-
-ECS_COMPONENT_DECLARE (bomb_storage_c);
-ECS_COMPONENT_DECLARE (brain_c);
-ECS_COMPONENT_DECLARE (cell_data_c);
-ECS_COMPONENT_DECLARE (controller_c);
-ECS_COMPONENT_DECLARE (lifetime_c);
-
-/* Game-specific hooks */
-
-static void
-brain (void *ptr, Sint32 count, const ecs_type_info_t *type_info)
+/* Command line, see parse_args. */
+struct options
 {
-  brain_c *brain = ptr;
-  for (Sint32 i = 0; i < count; i++)
-    {
-      brain[i].b_is_active = true;
-    }
-}
+  const char *map_path;
+  const char *replay_path; /* Where to record the match, or NULL. */
+  const char *trace_path;  /* Where to write the profile, or NULL. */
+  struct netplay_params net;
+  bool b_is_netplay;
+};
 
-static void
-cell_data (void *ptr, Sint32 count, const ecs_type_info_t *type_info)
-{
-  cell_data_c *cell_data = ptr;
-  for (Sint32 i = 0; i < count; i++)
-    {
-      cell_data[i].b_is_blocked = false;
-      cell_data[i].b_has_bomb = false;
-      cell_data[i].b_has_explosion = false;
-    }
-}
-
-static void
-controller (void *ptr, Sint32 count, const ecs_type_info_t *type_info)
-{
-  controller_c *controller = ptr;
-  for (Sint32 i = 0; i < count; i++)
-    {
-      controller[i].control_delta = (SDL_Point){ .x = 0, .y = 0 };
-      controller[i].pawn = 0u;
-    }
-}
-
-static void
-lifetime (void *ptr, Sint32 count, const ecs_type_info_t *type_info)
-{
-  lifetime_c *lifetime = ptr;
-  for (Sint32 i = 0; i < count; i++)
-    {
-      lifetime->duration = 500u;
-      lifetime->on_delete_callback = NULL;
-    }
-}
-
-/* Game-specific systems. */
-
-static void
-system_lifetime_progress (ecs_iter_t *it)
+/**
+ * Reads the command line:
+ *   Bomberman [map path] [--host port | --join host port]
+ *             [--loss percent] [--delay ms] [--record replay path]
+ *             [--trace trace path]
+ * --loss and --delay degrade the outgoing packets, for trying netplay out
+ * over loopback. --record writes the match down for bomberman_headless to
+ * play back. --trace profiles the game, the trace of the last seconds is
+ * written on F9 and on quitting (see profiler.h).
+ * @return false if it could not be understood.
+ */
+static bool
+parse_args (int argc, char *argv[], struct options *options)
 {
-  lifetime_c *lifetime = ecs_field (it, lifetime_c, 0);
-
-  for (Sint32 i = 0; i < it->count; i++)
+  options->map_path = "dat/maps/map0.txt";
+  for (int i = 1; i < argc; i++)
     {
-      if (lifetime[i].duration > 0)
+      const bool b_has_value = i + 1 < argc;
+      if (SDL_strcmp (argv[i], "--host") == 0 && b_has_value == true)
         {
-          lifetime[i].duration--;
+          options->b_is_netplay = true;
+          options->net.host = NULL;
+          options->net.port = (Uint16)SDL_strtoul (argv[++i], NULL, 10);
         }
-      else
+      else if (SDL_strcmp (argv[i], "--join") == 0 && i + 2 < argc)
         {
-          if (lifetime[i].on_delete_callback != NULL)
-            {
-              lifetime[i].on_delete_callback (it->world, it->entities[i]);
-            }
-          ecs_delete (it->world, it->entities[i]);
+          options->b_is_netplay = true;
+          options->net.host = argv[++i];
+          options->net.port = (Uint16)SDL_strtoul (argv[++i], NULL, 10);
         }
-    }
-}
-
-/* */
-
-static bool
-can_character_move (ecs_world_t *world, ecs_entity_t ent, SDL_Point dir)
-{
-  const game_s *game = ecs_singleton_get (world, game_s);
-  const index_c *index = ecs_get (world, ent, index_c);
-  ecs_entity_t cell = *arr_entity_get (
-      *mat2d_entity_get (game->cells, index->y + dir.y), index->x + dir.x);
-  const cell_data_c *cell_data = ecs_get (world, cell, cell_data_c);
-  if (cell_data->b_is_blocked == true)
-    {
-      return false;
-    }
-
-  movement_c *movement = ecs_get_mut (world, ent, movement_c);
-  if (movement->cooldown > 0)
-    {
-      movement->cooldown--;
-      return false;
-    }
-
-  return true;
-}
-
-/**
- *
- * @param world
- * @param ent Player controller or AI entity (expected to have a controller
- * component).
- */
-static void
-try_move_character (ecs_world_t *world, ecs_entity_t ent)
-{
-  const controller_c *controller = ecs_get (world, ent, controller_c);
-
-  if (controller->control_delta.x == 0 && controller->control_delta.y == 0)
-    {
-      return;
-    }
-
-  if (can_character_move (world, controller->pawn, controller->control_delta)
-      == true)
-    {
-      movement_c *movement = ecs_get_mut (world, controller->pawn, movement_c);
-
-      movement->delta.x = controller->control_delta.x;
-      movement->delta.y = controller->control_delta.y;
-
-      movement->cooldown = movement->default_cooldown;
-      ecs_modified (world, controller->pawn, movement_c);
-    }
-}
-
-static void
-TEST_try_play_all_brains (ecs_world_t *world)
-{
-  static Uint32 cooldown;
-  if (cooldown < 2u)
-    {
-      cooldown++;
-      return;
-    }
-  cooldown = 0u;
-  const game_s *game = ecs_singleton_get (world, game_s);
-  ecs_iter_t it = ecs_query_iter (
-      world, *dict_string_to_query_ptr_get (game->queries,
-                                            STRING_CTE ("get_all_brains")));
-  while (ecs_query_next (&it))
-    {
-      brain_c *brain = ecs_field (&it, brain_c, 0);
-      movement_c *movement = ecs_field (&it, movement_c, 1);
-
-      controller_c *AI_controller
-          = ecs_get_mut (it.world, game->AI, controller_c);
-
-      for (Sint32 i = 0; i < it.count; i++)
+      else if (SDL_strcmp (argv[i], "--loss") == 0 && b_has_value == true)
         {
-          AI_controller->pawn = it.entities[i];
-          AI_controller->control_delta = (SDL_Point){ 0, 0 };
-          Uint8 buf;
-          randombytes (&buf, sizeof (Uint8));
-          if (buf < UINT8_MAX / 4)
-            {
-              AI_controller->control_delta.y = -1;
-            }
-          else if (buf < ((UINT8_MAX / 4) * 2))
-            {
-              AI_controller->control_delta.x = -1;
-            }
-          else if (buf < ((UINT8_MAX / 4) * 3))
-            {
-              AI_controller->control_delta.y = 1;
-            }
-          else
-            {
-              AI_controller->control_delta.x = 1;
-            }
-          try_move_character (world, game->AI);
+          options->net.loss_percent = SDL_atoi (argv[++i]);
         }
-    }
-}
-
-void
-check_characters_damage (ecs_world_t *world)
-{
-  const game_s *game = ecs_singleton_get (world, game_s);
-  ecs_iter_t it = ecs_query_iter (
-      world, *dict_string_to_query_ptr_get (
-                 game->queries, STRING_CTE ("get_all_characters")));
-  while (ecs_query_next (&it))
-    {
-      index_c *index = ecs_field (&it, index_c, 1);
-      for (Sint32 i = 0; i < it.count; i++)
+      else if (SDL_strcmp (argv[i], "--delay") == 0 && b_has_value == true)
         {
-          ecs_entity_t cell = *arr_entity_get (
-              *mat2d_entity_get (game->cells, index[i].y), index[i].x);
-          cell_data_c *cell_data = ecs_get_mut (world, cell, cell_data_c);
-          if (cell_data->b_has_explosion == true)
-            {
-              ecs_delete (world, it.entities[i]);
-            }
+          options->net.delay_ms = (Uint32)SDL_strtoul (argv[++i], NULL, 10);
         }
-    }
-}
-
-void
-dispell_explosion (ecs_world_t *world, ecs_entity_t ent)
-{
-  const game_s *game = ecs_singleton_get (world, game_s);
-  index_c *index = ecs_get_mut (world, ent, index_c);
-  ecs_entity_t cell
-      = *arr_entity_get (*mat2d_entity_get (game->cells, index->y), index->x);
-  cell_data_c *cell_data = ecs_get_mut (world, cell, cell_data_c);
-  cell_data->b_has_explosion = false;
-}
-
-static void
-spawn_explosion (ecs_world_t *world, ecs_entity_t ent, Sint32 dx, Sint32 dy,
-                 Sint32 range)
-{
-  ecs_id_t instigator_rel = ecs_lookup (world, "instigator");
-  ecs_entity_t instigator = ecs_get_target (world, ent, instigator_rel, 0);
-
-  ecs_entity_t pfb = ecs_lookup (world, "explosion_pfb");
-  const game_s *game = ecs_singleton_get (world, game_s);
-  const index_c *index_b = ecs_get (world, ent, index_c);
-
-  for (Sint32 i = 0; i < range; i++)
-    {
-      SDL_Point potential_spawn
-          = (SDL_Point){ .x = index_b->x + dx * i, .y = index_b->y + dy * i };
-
-      if (potential_spawn.x < 0 || potential_spawn.x >= MAP_CELL_COUNT_W
-          || potential_spawn.y < 0 || potential_spawn.y >= MAP_CELL_COUNT_H)
+      else if (SDL_strcmp (argv[i], "--record") == 0 && b_has_value == true)
         {
-          break;
+          options->replay_path = argv[++i];
         }
-
-      ecs_entity_t cell = *arr_entity_get (
-          *mat2d_entity_get (game->cells, potential_spawn.y),
-          potential_spawn.x);
-
-      cell_data_c *cell_data = ecs_get_mut (world, cell, cell_data_c);
-      if (cell_data->b_is_blocked)
+      else if (SDL_strcmp (argv[i], "--trace") == 0 && b_has_value == true)
         {
-          return;
+          options->trace_path = argv[++i];
+        }
+      else if (argv[i][0] != '-')
+        {
+          options->map_path = argv[i];
+        }
+      else
+        {
+          return false;
         }
-
-      ecs_entity_t new = ecs_new_w_pair (world, EcsIsA, pfb);
-      index_c *index = ecs_ensure (world, new, index_c);
-      index->x = potential_spawn.x;
-      index->y = potential_spawn.y;
-      ecs_modified (world, new, index_c);
-      ecs_add_pair (world, new, instigator_rel, instigator);
-
-      cell_data->b_has_explosion = true;
-    }
-}
-
-#define create_explosion_top_col(world, ent)                                  \
-  spawn_explosion (world, ent, 0, -1, 3)
-#define create_explosion_left_row(world, ent)                                 \
-  spawn_explosion (world, ent, -1, 0, 3)
-#define create_explosion_bot_col(world, ent)                                  \
-  spawn_explosion (world, ent, 0, 1, 3)
-#define create_explosion_right_row(world, ent)                                \
-  spawn_explosion (world, ent, 1, 0, 3)
-#define create_explosion_center(world, ent)                                   \
-  spawn_explosion (world, ent, 0, 0, 1)
-
-static void
-create_explosion (ecs_world_t *world, ecs_entity_t ent)
-{
-  create_explosion_center (world, ent);
-  create_explosion_top_col (world, ent);
-  create_explosion_left_row (world, ent);
-  create_explosion_bot_col (world, ent);
-  create_explosion_right_row (world, ent);
-}
-
-void
-detonate_bomb (ecs_world_t *world, ecs_entity_t ent)
-{
-  create_explosion (world, ent);
-
-  const game_s *game = ecs_singleton_get (world, game_s);
-
-  ecs_entity_t instigator
-      = ecs_get_target (world, ent, ecs_lookup (world, "instigator"), 0);
-
-  bomb_storage_c *bomb_storage_p
-      = ecs_get_mut (world, instigator, bomb_storage_c);
-
-  const index_c *index = ecs_get (world, ent, index_c);
-
-  bomb_storage_p->count++;
-
-  ecs_entity_t cell = *arr_entity_get (
-      *mat2d_entity_get (game->cells, (size_t)index->y), (size_t)index->x);
-  cell_data_c *cell_data = ecs_get_mut (world, cell, cell_data_c);
-  cell_data->b_has_bomb = false;
-}
-
-bool
-try_place_bomb (ecs_world_t *world, ecs_entity_t player)
-{
-  const game_s *game = ecs_singleton_get (world, game_s);
-
-  const controller_c *controller = ecs_get (world, player, controller_c);
-
-  bomb_storage_c *bomb_storage_p
-      = ecs_get_mut (world, controller->pawn, bomb_storage_c);
-  const index_c *index_p = ecs_get (world, controller->pawn, index_c);
-
-  ecs_entity_t cell = *arr_entity_get (
-      *mat2d_entity_get (game->cells, (size_t)index_p->y), (size_t)index_p->x);
-  cell_data_c *cell_data = ecs_get_mut (world, cell, cell_data_c);
-
-  log_debug (DEBUG_LOG_NONE, "Player bomb: %d", bomb_storage_p->count);
-  const bool b_player_is_out_of_bombs = bomb_storage_p->count <= 0;
-  const bool b_cell_already_has_bomb = cell_data->b_has_bomb == true;
-  if (b_player_is_out_of_bombs || b_cell_already_has_bomb)
-    {
-      return false;
     }
-
-  ecs_entity_t pfb = ecs_lookup (world, "bomb_pfb");
-  ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-  index_c *index = ecs_get_mut (world, ent, index_c);
-  index->x = index_p->x;
-  index->y = index_p->y;
-  ecs_modified (world, ent, index_c);
-  cell_data->b_has_bomb = true;
-
-  ecs_add_pair (world, ent, ecs_lookup (world, "instigator"),
-                controller->pawn);
-
-  bomb_storage_p->count--;
-
   return true;
 }
 
+/* Hotkeys. What the players control goes through the input bindings, see
+ * input_bindings.h. */
 void
 handle_key_press (struct input_man *input_man, SDL_Scancode key, void *param)
 {
@@ -434,84 +119,25 @@ handle_key_press (struct input_man *input_man, SDL_Scancode key, void *param)
       core->b_is_fullscreen_presentation = !core->b_is_fullscreen_presentation;
       SDL_SetWindowFullscreen (core->win, core->b_is_fullscreen_presentation);
     }
+  if (key == SDL_SCANCODE_F9 && profiler_write () == true)
+    {
+      log_debug (DEBUG_LOG_NONE, "Trace written");
+    }
   if (key == SDL_SCANCODE_G)
     {
       if (b_has_shift_mod == true)
         {
-          ecs_iter_t it = ecs_query_iter (
-              world, *dict_string_to_query_ptr_get (
-                         game->queries, STRING_CTE ("get_all_rocks")));
-          while (ecs_query_next (&it))
-            {
-              for (Sint32 i = 0; i < it.count; i++)
-                {
-                  box_c *box = ecs_get_mut (world, it.entities[i], box_c);
-                  box->b_is_shown = !box->b_is_shown;
-                  ecs_modified (world, it.entities[i], box_c);
-                  cache_c *cache
-                      = ecs_get_mut (world, it.entities[i], cache_c);
-                  cache->b_should_regenerate = true;
-                  ecs_modified (world, it.entities[i], cache_c);
-                }
-            }
+          /* The map view outlines the rocks when their prefab shows its
+           * box, every rock is painted again with the new one. */
+          const ecs_entity_t pfb = game->handles.rock_pfb;
+          box_c *box = ecs_ensure (world, pfb, box_c);
+          box->b_is_shown = !box->b_is_shown;
+          ecs_modified (world, pfb, box_c);
+          tilemap_c *tilemap
+              = ecs_get_mut (world, ecs_id (tilemap_c), tilemap_c);
+          tilemap_mark_all (&tilemap->map, TILE_ROCK);
         }
     }
-
-  /* Player 1. */
-  if (key == SDL_SCANCODE_W)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P1, controller_c);
-      controller->control_delta.y = -1;
-    }
-  if (key == SDL_SCANCODE_A)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P1, controller_c);
-      controller->control_delta.x = -1;
-    }
-  if (key == SDL_SCANCODE_S)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P1, controller_c);
-      controller->control_delta.y = 1;
-    }
-  if (key == SDL_SCANCODE_D)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P1, controller_c);
-      controller->control_delta.x = 1;
-    }
-  if (key == SDL_SCANCODE_SPACE)
-    {
-      {
-        try_place_bomb (world, game->P1);
-      }
-    }
-
-  /* Player 2.*/
-  if (key == SDL_SCANCODE_UP)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P2, controller_c);
-      controller->control_delta.y = -1;
-    }
-  if (key == SDL_SCANCODE_LEFT)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P2, controller_c);
-      controller->control_delta.x = -1;
-    }
-  if (key == SDL_SCANCODE_DOWN)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P2, controller_c);
-      controller->control_delta.y = 1;
-    }
-  if (key == SDL_SCANCODE_RIGHT)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P2, controller_c);
-      controller->control_delta.x = 1;
-    }
-  if (key == SDL_SCANCODE_RSHIFT)
-    {
-      {
-        try_place_bomb (world, game->P2);
-      }
-    }
 }
 
 void
@@ -522,65 +148,8 @@ handle_key_release (struct input_man *input_man, SDL_Scancode key, void *param)
 void
 handle_key_hold (struct input_man *input_man, SDL_Scancode key, void *param)
 {
-  ecs_world_t *world = param;
-  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
-
-  /* Player 1. */
-  if (key == SDL_SCANCODE_W)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P1, controller_c);
-      controller->control_delta.y = -1;
-    }
-  if (key == SDL_SCANCODE_A)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P1, controller_c);
-      controller->control_delta.x = -1;
-    }
-  if (key == SDL_SCANCODE_S)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P1, controller_c);
-      controller->control_delta.y = 1;
-    }
-  if (key == SDL_SCANCODE_D)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P1, controller_c);
-      controller->control_delta.x = 1;
-    }
-  if (key == SDL_SCANCODE_SPACE)
-    {
-      {
-        try_place_bomb (world, game->P1);
-      }
-    }
-
-  /* Player 2.*/
-  if (key == SDL_SCANCODE_UP)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P2, controller_c);
-      controller->control_delta.y = -1;
-    }
-  if (key == SDL_SCANCODE_LEFT)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P2, controller_c);
-      controller->control_delta.x = -1;
-    }
-  if (key == SDL_SCANCODE_DOWN)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P2, controller_c);
-      controller->control_delta.y = 1;
-    }
-  if (key == SDL_SCANCODE_RIGHT)
-    {
-      controller_c *controller = ecs_get_mut (world, game->P2, controller_c);
-      controller->control_delta.x = 1;
-    }
-  if (key == SDL_SCANCODE_RSHIFT)
-    {
-      {
-        try_place_bomb (world, game->P2);
-      }
-    }
 }
+
 void
 handle_mouse_press (struct input_man *input_man, SDL_FPoint pos, Uint8 button,
                     void *param)
@@ -603,559 +172,152 @@ handle_mouse_motion (struct input_man *input_man, SDL_FPoint pos,
 {
 }
 
-SDL_FPoint
-get_relative_from_index (ecs_entity_t ent, ecs_world_t *world)
-{
-  const index_c *index = ecs_get (world, ent, index_c);
-  SDL_FPoint result = { .x = index->x * CELL_SIZE, .y = index->y * CELL_SIZE };
-  return result;
-}
-
-static void
-TEST_spawn_entities (ecs_world_t *world)
-{
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "char_cursed_balloon_pfb");
-    ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-
-    index_c *index = ecs_get_mut (world, ent, index_c);
-    index->x = 8;
-    index->y = 8;
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "char_cursed_balloon_pfb");
-    ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-
-    index_c *index = ecs_get_mut (world, ent, index_c);
-    index->x = 18;
-    index->y = 11;
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "char_cursed_balloon_pfb");
-    ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-
-    index_c *index = ecs_get_mut (world, ent, index_c);
-    index->x = 6;
-    index->y = 12;
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "char_cursed_balloon_pfb");
-    ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-
-    index_c *index = ecs_get_mut (world, ent, index_c);
-    index->x = 24;
-    index->y = 13;
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "char_cop_car_pfb");
-    ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-
-    index_c *index = ecs_get_mut (world, ent, index_c);
-    index->x = 13;
-    index->y = 3;
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "char_ghost_pfb");
-    ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-
-    index_c *index = ecs_get_mut (world, ent, index_c);
-    index->x = 18;
-    index->y = 7;
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "char_ghost_pfb");
-    ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-
-    index_c *index = ecs_get_mut (world, ent, index_c);
-    index->x = 17;
-    index->y = 6;
-  }
-}
-
-static void
-TEST_create_game_master (ecs_world_t *world)
-{
-  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
-  ecs_entity_t ent = ecs_entity (world, { .name = "game_master" });
-  ecs_add (world, ent, controller_c);
-  game->AI = ent;
-}
-
-static void
-create_bombers (ecs_world_t *world)
-{
-  const game_s *game = ecs_singleton_get (world, game_s);
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_character_pfb");
-    ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-    ecs_set_name (world, ent, "bomber1");
-
-    bomb_storage_c *bomb_storage = ecs_ensure (world, ent, bomb_storage_c);
-    bomb_storage->max_count = 2;
-    bomb_storage->count = bomb_storage->max_count;
-
-    index_c *index = ecs_get_mut (world, ent, index_c);
-    index->x = 1;
-    index->y = 1;
-
-    ecs_add (world, ent, scroll_to_c);
-
-    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
-    string_set_str (sprite->name, "T_Flipbook_Bomber1.png");
-
-    controller_c *controller = ecs_get_mut (world, game->P1, controller_c);
-    controller->pawn = ent;
-  }
-  //  {
-  //    ecs_entity_t pfb = ecs_lookup (world, "grid_character_pfb");
-  //    ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-  //    ecs_set_name (world, ent, "bomber2");
-  //
-  //    bomb_storage_c *bomb_storage = ecs_ensure (world, ent, bomb_storage_c);
-  //    bomb_storage->max_count = 2;
-  //    bomb_storage->count = bomb_storage->max_count;
-  //
-  //    index_c *index = ecs_get_mut (world, ent, index_c);
-  //    index->x = 1;
-  //    index->y = 13;
-  //
-  //    ecs_add (world, ent, scroll_to_c);
-  //
-  //    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
-  //    string_set_str (sprite->name, "T_Flipbook_Bomber2.png");
-  //
-  //    controller_c *controller = ecs_get_mut (world, game->P2, controller_c);
-  //    controller->pawn = ent;
-  //  }
-}
-
-static void
-create_layers (ecs_world_t *world)
-{
-  const game_s *game = ecs_singleton_get (world, game_s);
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "layer_pfb");
-    ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-    ecs_set_name (world, ent, "layer_map");
-
-    layer_c *layer = ecs_get_mut (world, ent, layer_c);
-    layer->value = 0;
-
-    render_target_c *render_target = ecs_get_mut (world, ent, render_target_c);
-    string_set_str (render_target->name, "RT_static");
-  }
-}
-
-static void
-create_player_controllers (ecs_world_t *world)
-{
-  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
-  {
-    ecs_entity_t ent = ecs_entity (
-        world,
-        { .name = "player1",
-          .add = ecs_ids (EcsPrefab, ecs_isa (ecs_lookup (
-                                         world, "player_controller_pfb"))) });
-    game->P1 = ent;
-  }
-  {
-    ecs_entity_t ent = ecs_entity (
-        world,
-        { .name = "player2",
-          .add = ecs_ids (EcsPrefab, ecs_isa (ecs_lookup (
-                                         world, "player_controller_pfb"))) });
-    game->P2 = ent;
-  }
-}
-
+/**
+ * Records the inputs of the tick about to be simulated. Online, the ticks
+ * are recorded once both peers agree on them instead.
+ */
 static void
-create_map (ecs_world_t *world)
+record_tick (struct replay_recorder *recorder, ecs_world_t *world,
+             const struct netplay *netplay)
 {
-  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
-
-  SDL_IOStream *io_stream = SDL_IOFromFile ("dat/maps/map0.txt", "r");
-  if (!io_stream)
+  if (recorder->io == NULL)
     {
-      log_error (0, "Failed to open map file");
       return;
     }
 
-  for (Sint32 j = 0; j < MAP_CELL_COUNT_H; j++)
+  Uint8 inputs[SIM_MAX_PLAYERS];
+  if (netplay == NULL)
     {
-      arr_entity_t row;
-      arr_entity_init (row);
-
-      Sint32 i = 0; // Track valid characters per row
-
-      while (i < MAP_CELL_COUNT_W)
+      for (Sint32 player = 0; player < SIM_MAX_PLAYERS; player++)
         {
-          char c = 0;
-          if (SDL_ReadIO (io_stream, &c, sizeof (char)) != sizeof (char))
-            {
-              log_error (0, "Failed to read from map file");
-              break;
-            }
-
-          if (SDL_isalnum (c) == false)
-            {
-              continue;
-            }
-
-          log_debug (DEBUG_LOG_SPAM, "%c", c);
-
-          ecs_entity_t cell = 0u;
-          {
-            ecs_entity_t pfb = ecs_lookup (world, "grid_cell_pfb");
-            cell = ecs_new_w_pair (world, EcsIsA, pfb);
-            string_t temp;
-            string_init_printf (temp, "cell_%d_%d", i, j);
-            log_debug (0, "Cell %s created...", string_get_cstr (temp));
-            ecs_set_name (world, cell, string_get_cstr (temp));
-            index_c *index = ecs_get_mut (world, cell, index_c);
-            index->x = i;
-            index->y = j;
-            arr_entity_push_back (row, cell);
-          }
-          {
-            ecs_entity_t pfb = ecs_lookup (world, "floor_pfb");
-            ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-            string_t temp;
-            string_init_printf (temp, "floor_%d_%d", i, j);
-            ecs_set_name (world, ent, string_get_cstr (temp));
-            index_c *index = ecs_get_mut (world, ent, index_c);
-            index->x = i;
-            index->y = j;
-          }
-
-          array_c *array = ecs_get_mut (world, cell, array_c);
-          cell_data_c *cell_data = ecs_get_mut (world, cell, cell_data_c);
-
-          ecs_entity_t pfb = 0u;
-          string_t temp;
-          switch (c)
-            {
-            case '0':
-              {
-                break;
-              }
-            case '1':
-              {
-                pfb = ecs_lookup (world, "wall_pfb");
-                string_init_printf (temp, "wall_%d_%d", i, j);
-                cell_data->b_is_blocked = true;
-                break;
-              }
-            case '2':
-              {
-                pfb = ecs_lookup (world, "rock_pfb");
-                string_init_printf (temp, "rock_%d_%d", i, j);
-                cell_data->b_is_blocked = true;
-                break;
-              }
-            default:
-              {
-                break;
-              }
-            }
-
-          if (pfb != 0u)
-            {
-              ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
-              ecs_set_name (world, ent, string_get_cstr (temp));
-              index_c *index = ecs_get_mut (world, ent, index_c);
-              index->x = i;
-              index->y = j;
-
-              arr_entity_push_back (array->content, ent);
-            }
-
-          i++;
+          inputs[player]
+              = read_sim_input (world, get_player_controller (world, player));
         }
-      mat2d_entity_push_back (game->cells, row);
+      replay_record_tick (recorder, inputs);
+      return;
+    }
+  while (netplay_get_settled_inputs (netplay, recorder->ticks, inputs)
+         == true)
+    {
+      replay_record_tick (recorder, inputs);
     }
-
-  SDL_CloseIO (io_stream);
 }
 
 static void
-init_game_character_prefabs (ecs_world_t *world)
+log_input_latency (const struct input_latency *latency)
 {
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_object_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "grid_character_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-    //    anim_player_c *anim_player = ecs_ensure (ecs, ent, anim_player_c);
-
-    layer_c *layer = ecs_get_mut (world, ent, layer_c);
-    layer->value = 2;
-
-    movement_c *movement = ecs_ensure (world, ent, movement_c);
-    movement->default_cooldown = 10u;
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_character_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "grid_AI_character_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-
-    ecs_add (world, ent, brain_c);
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_AI_character_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "char_cursed_balloon_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-
-    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
-    string_init_set_str (sprite->name, "T_Flipbook_CursedBalloon.png");
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_AI_character_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "char_ghost_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-
-    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
-    string_init_set_str (sprite->name, "T_Flipbook_Ghost.png");
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_AI_character_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "char_cop_car_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-
-    anim_player_c *anim_player = ecs_ensure (world, ent, anim_player_c);
-    struct anim_flipbook *flipbook
-        = SDL_malloc (sizeof (struct anim_flipbook));
-    flipbook->frame_count = (SDL_Point){ 6, 1 };
-    flipbook->frame_size = (SDL_FPoint){ 32.f, 32.f };
-    string_init_set_str (flipbook->name, "T_Flipbook_CopCar.png");
-    flipbook->play_speed = 24u;
-    struct anim_pose *pose = SDL_malloc (sizeof (struct anim_pose));
-    dict_sint32_anim_flipbook_init (pose->directions);
-    dict_sint32_anim_flipbook_set_at (pose->directions, 0, flipbook);
-    dict_string_anim_pose_init (anim_player->poses);
-    dict_string_anim_pose_set_at (anim_player->poses, STRING_CTE ("default"),
-                                  pose);
-    string_init_set_str (anim_player->control_pose, "default");
-    anim_player->control_direction = 0;
-
-    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
-  }
+  if (latency->presses == 0u)
+    {
+      return;
+    }
+  SDL_Log ("Input latency over %llu presses: %.2f ms on average, %.2f ms at "
+           "worst, %llu acted on a later frame than polled",
+           (unsigned long long)latency->presses,
+           (double)latency->total_ns / 1e6 / (double)latency->presses,
+           (double)latency->max_ns / 1e6, (unsigned long long)latency->late);
 }
 
+/**
+ * Switches ecs_progress between the ticks, which run the game systems
+ * without drawing anything, and the frames, which draw the match as it
+ * stands without advancing it. Only the game systems are turned off for
+ * the frames: OnStore depends on PreStore, which depends on PostUpdate and
+ * OnUpdate, so disabling those phases would skip the drawing as well.
+ */
 static void
-init_game_prefabs (ecs_world_t *world)
+set_drawing (ecs_world_t *world, bool b_is_drawing)
 {
-  {
-    ecs_entity_t ent = ecs_entity (world, { .name = "player_controller_pfb",
-                                            .add = ecs_ids (EcsPrefab) });
-    ecs_add (world, ent, controller_c);
-  }
-  {
-    ecs_entity_t ent = ecs_entity (
-        world, { .name = "layer_pfb", .add = ecs_ids (EcsPrefab) });
-    bounds_c *bounds = ecs_ensure (world, ent, bounds_c);
-    bounds->size = (SDL_FPoint){ MAP_WIDTH, MAP_HEIGHT };
-    box_c *box = ecs_ensure (world, ent, box_c);
-    box->b_is_shown = false;
-    box->b_uses_color = true;
-    color_c *color = ecs_ensure (world, ent, color_c);
-    color->default_r = 0u;
-    color->default_g = 0u;
-    color->default_b = 0u;
-    ecs_add (world, ent, layer_c);
-    origin_c *origin = ecs_ensure (world, ent, origin_c);
-    render_target_c *render_target = ecs_ensure (world, ent, render_target_c);
-    visibility_c *visibility = ecs_ensure (world, ent, visibility_c);
-    visibility->b_state = true;
-  }
-  {
-    ecs_entity_t ent = ecs_entity (
-        world, { .name = "grid_cell_pfb", .add = ecs_ids (EcsPrefab) });
-    array_c *array = ecs_ensure (world, ent, array_c);
-    cell_data_c *cell_data = ecs_ensure (world, ent, cell_data_c);
-    index_c *index = ecs_ensure (world, ent, index_c);
-  }
-  {
-    ecs_entity_t ent = ecs_entity (
-        world, { .name = "grid_element_pfb", .add = ecs_ids (EcsPrefab) });
-    index_c *index = ecs_ensure (world, ent, index_c);
-    origin_c *origin = ecs_ensure (world, ent, origin_c);
-    origin->relative_callback = get_relative_from_index;
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_element_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "grid_object_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-    bounds_c *bounds = ecs_ensure (world, ent, bounds_c);
-    bounds->size = (SDL_FPoint){ CELL_SIZE, CELL_SIZE };
-    box_c *box = ecs_ensure (world, ent, box_c);
-    box->b_is_shown = false;
-    box->b_uses_color = true;
-    color_c *color = ecs_ensure (world, ent, color_c);
-    color->default_r = 0u;
-    color->default_g = 155u;
-    color->default_b = 0u;
-    layer_c *layer = ecs_ensure (world, ent, layer_c);
-    layer->value = 1;
-    sprite_c *sprite = ecs_ensure (world, ent, sprite_c);
-    visibility_c *visibility = ecs_ensure (world, ent, visibility_c);
-    visibility->b_state = true;
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_object_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "grid_object_static_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-    cache_c *cache = ecs_ensure (world, ent, cache_c);
-    string_set_str (cache->cache_name, "RT_static");
-
-    origin_c *origin = ecs_get_mut (world, ent, origin_c);
-    origin->b_is_screen_based = true;
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_object_static_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "floor_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-    color_c *color = ecs_ensure (world, ent, color_c);
-    color->default_r = 125u;
-    color->default_g = 0u;
-    color->default_b = 125u;
-    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
-    sprite->b_uses_color = true;
-    string_set_str (sprite->name, "T_Sprite_Floor0.png");
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_object_static_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "rock_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
-    string_set_str (sprite->name, "T_Sprite_Rock0.png");
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_object_static_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "factory_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
-    string_set_str (sprite->name, "T_Sprite_Factory.png");
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_object_static_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "wall_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-    color_c *color = ecs_ensure (world, ent, color_c);
-    color->default_r = 66u;
-    color->default_g = 125u;
-    color->default_b = 45u;
-    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
-    sprite->b_uses_color = true;
-    string_set_str (sprite->name, "T_Sprite_Wall0.png");
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_object_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "bomb_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-    lifetime_c *lifetime = ecs_ensure (world, ent, lifetime_c);
-    lifetime->on_delete_callback = detonate_bomb;
-    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
-    string_set_str (sprite->name, "T_Flipbook_Bomb.png");
-  }
-  {
-    ecs_entity_t pfb = ecs_lookup (world, "grid_object_pfb");
-    ecs_entity_t ent
-        = ecs_entity (world, { .name = "explosion_pfb",
-                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
-    anim_player_c *anim_player = ecs_ensure (world, ent, anim_player_c);
-    dict_string_anim_pose_init (anim_player->poses);
-    struct anim_pose *pose = SDL_malloc (sizeof (struct anim_pose));
-    dict_sint32_anim_flipbook_init (pose->directions);
-    struct anim_flipbook *flipbook
-        = SDL_malloc (sizeof (struct anim_flipbook));
-    string_init_set_str (flipbook->name, "T_Flipbook_Explo0.png");
-    flipbook->frame_size = (SDL_FPoint){ 32.f, 32.f };
-    flipbook->frame_count = (SDL_Point){ 4, 1 };
-    flipbook->play_speed = 18u;
-    dict_sint32_anim_flipbook_set_at (pose->directions, 0, flipbook);
-    dict_string_anim_pose_set_at (anim_player->poses, STRING_CTE ("default"),
-                                  pose);
-    string_init_set_str (anim_player->control_pose, "default");
-    anim_player->control_direction = 0;
-    lifetime_c *lifetime = ecs_ensure (world, ent, lifetime_c);
-    lifetime->duration = 150u;
-    lifetime->on_delete_callback = dispell_explosion;
-    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
-  }
+  enable_sim_systems (world, !b_is_drawing);
+  ecs_enable (world, EcsPreStore, b_is_drawing);
+  ecs_enable (world, EcsOnStore, b_is_drawing);
 }
 
-static void
-init_game_queries (ecs_world_t *world)
+/**
+ * @return the time between two frames, the refresh period of the window's
+ * display, or a tick if it is unknown.
+ */
+static Uint64
+get_frame_period (SDL_Window *window)
 {
-  game_s *game = ecs_singleton_ensure (world, game_s);
-  dict_string_to_query_ptr_init (game->queries);
-  {
-    ecs_query_t *q = ecs_query (
-        world, { .terms = { { ecs_isa (ecs_lookup (world, "rock_pfb")) } } });
-    dict_string_to_query_ptr_set_at (game->queries,
-                                     STRING_CTE ("get_all_rocks"), q);
-  }
-  {
-    ecs_query_t *q = ecs_query (
-        world,
-        { .terms
-          = { { .id = ecs_isa (ecs_lookup (world, "grid_character_pfb")) },
-              { .id = ecs_id (index_c) } } });
-    dict_string_to_query_ptr_set_at (game->queries,
-                                     STRING_CTE ("get_all_characters"), q);
-  }
-  {
-    ecs_query_t *q
-        = ecs_query (world, { .terms = { { .id = ecs_id (brain_c) },
-                                         { .id = ecs_id (movement_c) } } });
-    dict_string_to_query_ptr_set_at (game->queries,
-                                     STRING_CTE ("get_all_brains"), q);
-  }
+  const SDL_DisplayMode *mode
+      = SDL_GetCurrentDisplayMode (SDL_GetDisplayForWindow (window));
+  if (mode == NULL || mode->refresh_rate <= 0.f)
+    {
+      return SIM_TICK_NS;
+    }
+  return (Uint64)((double)SDL_NS_PER_SECOND / (double)mode->refresh_rate);
 }
 
+/**
+ * Closes the replay with the hash of the final state, which playback checks.
+ * Online, the last ticks may still be unsettled and the state is left out.
+ */
 static void
-init_game_systems (ecs_world_t *world)
+close_replay (struct replay_recorder *recorder, ecs_world_t *world,
+              const struct netplay *netplay)
 {
-  ECS_SYSTEM (world, system_lifetime_progress, EcsOnUpdate, lifetime_c);
+  const Uint64 hash
+      = recorder->io != NULL && netplay == NULL ? hash_sim (world) : 0u;
+  if (replay_record_close (recorder, netplay == NULL ? &hash : NULL)
+      == false)
+    {
+      log_error (0, "Failed to write the replay");
+    }
 }
 
-static void
-init_game_hooks (ecs_world_t *world)
+int
+main (int argc, char *argv[])
 {
-  ecs_type_hooks_t brain_hooks = { .ctor = brain };
-  ecs_set_hooks_id (world, ecs_id (brain_c), &brain_hooks);
+  struct options options = { 0 };
+  if (parse_args (argc, argv, &options) == false)
+    {
+      SDL_Log ("Usage: %s [map path] [--host port | --join host port] "
+               "[--loss percent] [--delay ms] [--record replay path] "
+               "[--trace trace path]",
+               argv[0]);
+      return 1;
+    }
 
-  ecs_type_hooks_t cell_data_hooks = { .ctor = cell_data };
-  ecs_set_hooks_id (world, ecs_id (cell_data_c), &cell_data_hooks);
+  struct map map = { 0 };
+  if (map_load (options.map_path, &map) == false)
+    {
+      log_error (0, "Failed to load map %s", options.map_path);
+      return 1;
+    }
 
-  ecs_type_hooks_t controller_hooks = { .ctor = controller };
-  ecs_set_hooks_id (world, ecs_id (controller_c), &controller_hooks);
+  /* The flecs systems are only zoned if the profiler is up before the
+   * world. */
+  if (options.trace_path != NULL
+      && profiler_init (options.trace_path) == false)
+    {
+      log_error (0, "Failed to set up the profiler");
+    }
 
-  ecs_type_hooks_t lifetime_hooks = { .ctor = lifetime };
-  ecs_set_hooks_id (world, ecs_id (lifetime_c), &lifetime_hooks);
-}
+  /* Peers agree on the seed before anything is built. */
+  Uint64 seed = 0u;
+  randombytes (&seed, sizeof (Uint64));
+  struct netplay *netplay = NULL;
+  Sint32 local_player = 0;
+  if (options.b_is_netplay == true)
+    {
+      options.net.seed = seed;
+      netplay = netplay_connect (&options.net);
+      if (netplay == NULL)
+        {
+          return 1;
+        }
+      seed = netplay_get_seed (netplay);
+      local_player = netplay_get_local_player (netplay);
+    }
 
-int
-main (int argc, char *argv[])
-{
   ecs_world_t *world = ecs_init ();
 
   struct pluto_core_params params
       = { .init_flags = SDL_INIT_VIDEO,
           .initial_window_size = { .x = LOGIC_WIDTH, .y = LOGIC_HEIGHT },
           .initial_logical_size = { .x = LOGIC_WIDTH, .y = LOGIC_HEIGHT },
-          .initial_layout_size = { .x = MAP_WIDTH, .y = MAP_HEIGHT },
+          .initial_layout_size
+          = { .x = map.grid.w * CELL_SIZE, .y = map.grid.h * CELL_SIZE },
           .window_name = "Doomsday",
           .window_flags = SDL_WINDOW_RESIZABLE,
           .default_user_scaling = 1.f,
@@ -1171,58 +333,83 @@ main (int argc, char *argv[])
           .initial_constant_scroll_speed = 1.f,
           .initial_scroll_style = PLUTO_SCROLL_STYLE_CONSTANT,
           .b_should_initially_clamp_scroll_x = true,
-          .b_should_initially_ignore_scroll_y = true,
+          .b_should_initially_ignore_scroll_y
+          = map.grid.h <= VIEW_CELL_COUNT_H,
           .initial_scroll_poll_frequency_ms = 100u };
   core_s *core = init_pluto (world, &params);
+  if (SDL_InitSubSystem (SDL_INIT_GAMEPAD) == false)
+    {
+      log_error (0, "Failed to start the gamepads: %s", SDL_GetError ());
+    }
+  struct input_bindings bindings;
+  if (input_bindings_load (&bindings, BINDINGS_PATH) == false)
+    {
+      log_error (0, "Failed to read %s, using the default bindings",
+                 BINDINGS_PATH);
+    }
 
-  ECS_TAG (world, instigator);
-
-  ECS_COMPONENT_DEFINE (world, game_s);
-  game_s *game = ecs_singleton_ensure (world, game_s);
-  mat2d_entity_init (game->cells);
-
-  ECS_COMPONENT_DEFINE (world, bomb_storage_c);
-  ECS_COMPONENT_DEFINE (world, brain_c);
-  ECS_COMPONENT_DEFINE (world, cell_data_c);
-  ECS_COMPONENT_DEFINE (world, controller_c);
-  ECS_COMPONENT_DEFINE (world, lifetime_c);
-
+  profiler_begin ("satlas_dir_to_sheets");
   satlas_dir_to_sheets (core->atlas, "dat/gfx", false, STRING_CTE ("sprites"));
-
-  render_target_add_to_pool (core->rts, STRING_CTE ("RT_static"),
-                             (SDL_Point){ MAP_WIDTH, MAP_HEIGHT });
-  render_target_clear (core->rts, STRING_CTE ("RT_static"), 0, 0, 0, 255);
-
-  init_game_hooks (world);
-  init_game_prefabs (world);
-  init_game_character_prefabs (world);
-  init_game_queries (world);
-  init_game_systems (world);
-  TEST_create_game_master (world);
-  create_player_controllers (world);
-  create_layers (world);
-  create_map (world);
-  create_bombers (world);
-  TEST_spawn_entities (world);
-
+  profiler_end ();
+
+  init_sim (world);
+  seed_sim (world, seed);
+  log_debug (DEBUG_LOG_NONE, "Match seed: %llu", (unsigned long long)seed);
+  struct replay_recorder recorder = { 0 };
+  if (options.replay_path != NULL
+      && replay_record_open (&recorder, options.replay_path, seed,
+                             options.map_path, &map.grid, SIM_MAX_PLAYERS)
+             == false)
+    {
+      log_error (0, "Failed to create the replay %s", options.replay_path);
+    }
+  profiler_begin ("create_map");
+  create_map (world, &map);
+  profiler_end ();
+  static struct map_view view;
+  if (map_view_init (&view, world, core->rend, "dat/gfx") == false)
+    {
+      log_error (0, "Failed to load the sheets of the map: %s",
+                 SDL_GetError ());
+    }
+  else
+    {
+      map_view_add_system (&view, world);
+    }
+  create_bombers (world, &map, SIM_MAX_PLAYERS, local_player);
+  create_characters (world, &map);
+  map_free (&map);
+
+  /* The match advances by whole ticks at SIM_TICK_RATE, as many as the
+   * time elapsed calls for. Frames are drawn in between, interpolated, then
+   * the game sleeps until the next one is due. */
+  const Uint64 frame_period = get_frame_period (core->win);
+  Uint64 last_ns = SDL_GetTicksNS ();
+  Uint64 next_frame_ns = last_ns;
+  Uint64 lag_ns = 0u;
   SDL_Event e;
-  while (1)
+  for (Uint64 frame = 0u;; frame++)
     {
-
-      controller_c *controller_p1
-          = ecs_get_mut (world, game->P1, controller_c);
-      controller_p1->control_delta.x = 0;
-      controller_p1->control_delta.y = 0;
-
-      controller_c *controller_p2
-          = ecs_get_mut (world, game->P2, controller_c);
-      controller_p2->control_delta.x = 0;
-      controller_p2->control_delta.y = 0;
-
+      profiler_begin ("frame");
+      profiler_begin ("input");
       while (SDL_PollEvent (&e) > 0)
         {
+          input_bindings_handle_event (&bindings, &e, frame);
           if (e.type == SDL_EVENT_QUIT)
             {
+              log_input_latency (&bindings.latency);
+              input_bindings_free (&bindings);
+              if (options.trace_path != NULL && profiler_write () == false)
+                {
+                  log_error (0, "Failed to write the trace %s",
+                             options.trace_path);
+                }
+              profiler_quit ();
+              close_replay (&recorder, world, netplay);
+              netplay_destroy (netplay);
+              map_view_free (&view);
+              fini_sim (world);
+              ecs_fini (world);
               SDL_Quit ();
               exit (0);
             }
@@ -1253,17 +440,80 @@ main (int argc, char *argv[])
             }
         }
       input_man_bounce_keys (core->input_man, world);
-      try_move_character (world, game->P1);
-      try_move_character (world, game->P2);
-      TEST_try_play_all_brains (world);
-      check_characters_damage (world);
+      profiler_end ();
+
+      const Uint64 now_ns = SDL_GetTicksNS ();
+      lag_ns = SDL_min (lag_ns + (now_ns - last_ns),
+                        (Uint64)MAX_FRAME_TICKS * SIM_TICK_NS);
+      last_ns = now_ns;
+      set_drawing (world, false);
+      for (; lag_ns >= SIM_TICK_NS; lag_ns -= SIM_TICK_NS)
+        {
+          struct input_snapshot snapshot;
+          input_bindings_snapshot (&bindings, &snapshot);
+
+          /* Online, the bindings of player 1 drive the local player and the
+           * peer's inputs come from the network. A tick waiting on the peer
+           * is given up rather than caught up with later. */
+          if (netplay != NULL
+              && netplay_begin_tick (netplay, world, snapshot.inputs[0])
+                     == false)
+            {
+              continue;
+            }
+          if (netplay == NULL)
+            {
+              for (Sint32 player = 0; player < SIM_MAX_PLAYERS; player++)
+                {
+                  write_sim_input (world,
+                                   get_player_controller (world, player),
+                                   snapshot.inputs[player]);
+                }
+            }
+          record_tick (&recorder, world, netplay);
+          tick_sim (world);
+          input_bindings_consume (&bindings, frame);
+          profiler_begin ("ecs_progress");
+          ecs_progress (world, 0.f);
+          profiler_end ();
+          if (netplay != NULL)
+            {
+              netplay_end_tick (netplay, world);
+            }
+        }
+      interpolate_sim (world, (float)lag_ns / (float)SIM_TICK_NS);
+
+      set_drawing (world, true);
       SDL_SetRenderDrawColor (core->rend, 0, 0, 0, 255);
       SDL_RenderClear (core->rend);
       SDL_SetRenderDrawColor (core->rend, 0, 0, 188, 255);
       SDL_RenderFillRect (core->rend,
                           &(SDL_FRect){ 0.f, 0.f, LOGIC_WIDTH, LOGIC_HEIGHT });
+      profiler_begin ("map_view_draw");
+      map_view_draw (&view, world);
+      profiler_end ();
+      profiler_begin ("ecs_progress");
       ecs_progress (world, 0.f);
+      profiler_end ();
+      profiler_begin ("SDL_RenderPresent");
       SDL_RenderPresent (core->rend);
+      profiler_end ();
+
+      /* A frame running late is not made up for, the next one is paced from
+       * now. */
+      next_frame_ns += frame_period;
+      const Uint64 end_ns = SDL_GetTicksNS ();
+      if (end_ns < next_frame_ns)
+        {
+          profiler_begin ("SDL_DelayNS");
+          SDL_DelayNS (next_frame_ns - end_ns);
+          profiler_end ();
+        }
+      else
+        {
+          next_frame_ns = end_ns;
+        }
+      profiler_end ();
     }
 
   return 0;
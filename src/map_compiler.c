@@ -0,0 +1,64 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Map compiler: converts a text map into the compiled format, which the
+ *  game loads with a single read and a copy of the cells.
+ *
+ *  Usage: bomberman_mapc <text map> [compiled map]
+ *  The compiled map defaults to the text map path with its extension
+ *  replaced by MAP_BINARY_EXTENSION. */
+
+#include "SDL3/SDL.h"
+
+#include "map_file.h"
+
+int
+main (int argc, char *argv[])
+{
+  if (argc < 2)
+    {
+      SDL_Log ("Usage: %s <text map> [compiled map]", argv[0]);
+      return 1;
+    }
+
+  const char *in_path = argv[1];
+  char *out_path = NULL;
+  if (argc > 2)
+    {
+      out_path = SDL_strdup (argv[2]);
+    }
+  else
+    {
+      const char *dot = SDL_strrchr (in_path, '.');
+      const char *slash = SDL_strrchr (in_path, '/');
+      const int stem_length = dot != NULL && (slash == NULL || dot > slash)
+                                  ? (int)(dot - in_path)
+                                  : (int)SDL_strlen (in_path);
+      SDL_asprintf (&out_path, "%.*s%s", stem_length, in_path,
+                    MAP_BINARY_EXTENSION);
+    }
+  if (out_path == NULL)
+    {
+      return 1;
+    }
+
+  struct map map = { 0 };
+  int status = 0;
+  if (map_load_text (in_path, &map) == false)
+    {
+      SDL_Log ("Failed to load map %s", in_path);
+      status = 1;
+    }
+  else if (map_save_binary (out_path, &map) == false)
+    {
+      SDL_Log ("Failed to write %s", out_path);
+      status = 1;
+    }
+  else
+    {
+      SDL_Log ("%s: %dx%d cells, %d chunks, %d spawns", out_path, map.grid.w,
+               map.grid.h, map.grid.slot_count, map.spawn_count);
+    }
+
+  map_free (&map);
+  SDL_free (out_path);
+  return status;
+}
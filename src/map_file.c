@@ -0,0 +1,324 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Map files. Compiled maps are a binn object with these keys:
+ *    "version"  uint32, MAP_BINARY_VERSION
+ *    "w", "h"   int32, size of the map in cells
+ *    "chunks"   blob, int32 chunk index (cy * chunks_w + cx) of each slot
+ *    "cells"    blob, GRID_CHUNK_CELLS flag bytes per slot, in slot order
+ *    "spawns"   blob, int32 x, y and prefab id of each spawn
+ *  The int32 blobs are little-endian. */
+
+#include "map_file.h"
+
+#include "binn.h"
+
+SDL_COMPILE_TIME_ASSERT (map_spawn_ints,
+                         sizeof (struct map_spawn) == 3 * sizeof (Sint32));
+
+/* Flags of a text map character, or GRID_CELL_VOID for no cell. */
+static Uint8
+flags_of (char c)
+{
+  switch (c)
+    {
+    case '1':
+      return GRID_CELL_BLOCKED;
+    case '2':
+      return GRID_CELL_BLOCKED | GRID_CELL_ROCK;
+    default:
+      return SDL_isalnum (c) ? 0u : GRID_CELL_VOID;
+    }
+}
+
+/* Prefab spawning on a text map character, or -1 for none. */
+static Sint32
+prefab_of (char c)
+{
+  switch (c)
+    {
+    case 'P':
+      return MAP_PREFAB_BOMBER;
+    case 'b':
+      return MAP_PREFAB_CURSED_BALLOON;
+    case 'c':
+      return MAP_PREFAB_COP_CAR;
+    case 'g':
+      return MAP_PREFAB_GHOST;
+    default:
+      return -1;
+    }
+}
+
+void
+map_free (struct map *map)
+{
+  grid_free (&map->grid);
+  SDL_free (map->spawns);
+  SDL_zerop (map);
+}
+
+bool
+map_load_text (const char *path, struct map *map)
+{
+  map_free (map);
+
+  size_t size = 0u;
+  char *text = SDL_LoadFile (path, &size);
+  if (text == NULL)
+    {
+      return false;
+    }
+
+  /* First pass for the size, carriage returns do not count. */
+  Sint32 w = 0;
+  Sint32 h = 0;
+  Sint32 x = 0;
+  Sint32 spawn_count = 0;
+  for (size_t k = 0u; k < size; k++)
+    {
+      if (text[k] == '\n')
+        {
+          w = SDL_max (w, x);
+          x = 0;
+          h++;
+        }
+      else if (text[k] != '\r')
+        {
+          spawn_count += prefab_of (text[k]) >= 0 ? 1 : 0;
+          x++;
+        }
+    }
+  if (x > 0)
+    {
+      w = SDL_max (w, x);
+      h++;
+    }
+
+  map->spawns
+      = SDL_malloc (SDL_max ((size_t)spawn_count, (size_t)1u)
+                    * sizeof (struct map_spawn));
+  if (map->spawns == NULL || grid_init (&map->grid, w, h) == false)
+    {
+      map_free (map);
+      SDL_free (text);
+      return false;
+    }
+
+  x = 0;
+  Sint32 y = 0;
+  for (size_t k = 0u; k < size; k++)
+    {
+      const char c = text[k];
+      if (c == '\n')
+        {
+          x = 0;
+          y++;
+          continue;
+        }
+      if (c == '\r')
+        {
+          continue;
+        }
+
+      const Uint8 flags = flags_of (c);
+      if (flags != GRID_CELL_VOID)
+        {
+          if (grid_populate (&map->grid, x, y) == false)
+            {
+              map_free (map);
+              SDL_free (text);
+              return false;
+            }
+          map->grid.cells[grid_index (&map->grid, x, y)] = flags;
+        }
+      const Sint32 prefab = prefab_of (c);
+      if (prefab >= 0)
+        {
+          map->spawns[map->spawn_count++]
+              = (struct map_spawn){ .x = x, .y = y, .prefab = prefab };
+        }
+      x++;
+    }
+
+  SDL_free (text);
+  return true;
+}
+
+/* Copies count little-endian int32 out of a blob, which may be unaligned. */
+static void
+read_ints (Sint32 *dst, const void *src, Sint32 count)
+{
+  SDL_memcpy (dst, src, (size_t)count * sizeof (Sint32));
+  for (Sint32 i = 0; i < count; i++)
+    {
+      dst[i] = (Sint32)SDL_Swap32LE ((Uint32)dst[i]);
+    }
+}
+
+/* Checks and places the slots read from a compiled map into its grid. */
+static bool
+place_chunks (struct grid *grid, const void *chunks, const void *cells,
+              Sint32 slot_count)
+{
+  if (grid_reserve (grid, slot_count) == false)
+    {
+      return false;
+    }
+  read_ints (grid->slot_chunks, chunks, slot_count);
+  const Sint32 chunk_count = grid->chunks_w * grid->chunks_h;
+  for (Sint32 slot = 0; slot < slot_count; slot++)
+    {
+      const Sint32 chunk = grid->slot_chunks[slot];
+      if (chunk < 0 || chunk >= chunk_count || grid->chunks[chunk] >= 0)
+        {
+          return false;
+        }
+      grid->chunks[chunk] = slot;
+    }
+  SDL_memcpy (grid->cells, cells, (size_t)slot_count * GRID_CHUNK_CELLS);
+  grid->slot_count = slot_count;
+  return true;
+}
+
+static bool
+place_spawns (struct map *map, const void *spawns, Sint32 spawn_count)
+{
+  map->spawns = SDL_malloc (SDL_max ((size_t)spawn_count, (size_t)1u)
+                            * sizeof (struct map_spawn));
+  if (map->spawns == NULL)
+    {
+      return false;
+    }
+  read_ints ((Sint32 *)map->spawns, spawns, spawn_count * 3);
+  map->spawn_count = spawn_count;
+  for (Sint32 i = 0; i < spawn_count; i++)
+    {
+      const struct map_spawn *spawn = &map->spawns[i];
+      if (spawn->prefab < 0 || spawn->prefab >= MAP_PREFAB_COUNT
+          || grid_contains (&map->grid, spawn->x, spawn->y) == false)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+bool
+map_load_binary (const char *path, struct map *map)
+{
+  map_free (map);
+
+  size_t size = 0u;
+  void *data = SDL_LoadFile (path, &size);
+  if (data == NULL)
+    {
+      return false;
+    }
+
+  int type = 0;
+  int count = 0;
+  int data_size = size <= SDL_MAX_SINT32 ? (int)size : 0;
+  unsigned int version = 0u;
+  int w = 0;
+  int h = 0;
+  void *chunks = NULL;
+  int chunks_size = 0;
+  void *cells = NULL;
+  int cells_size = 0;
+  void *spawns = NULL;
+  int spawns_size = 0;
+  bool b_is_valid
+      = data_size > 0 && binn_is_valid_ex (data, &type, &count, &data_size)
+        && type == BINN_OBJECT
+        && binn_object_get_uint32 (data, "version", &version)
+        && version == MAP_BINARY_VERSION
+        && binn_object_get_int32 (data, "w", &w)
+        && binn_object_get_int32 (data, "h", &h)
+        && binn_object_get_blob (data, "chunks", &chunks, &chunks_size)
+        && binn_object_get_blob (data, "cells", &cells, &cells_size)
+        && binn_object_get_blob (data, "spawns", &spawns, &spawns_size)
+        && w > 0 && h > 0 && w <= SDL_MAX_SINT32 / h
+        && chunks_size % (int)sizeof (Sint32) == 0
+        && cells_size % GRID_CHUNK_CELLS == 0
+        && cells_size / GRID_CHUNK_CELLS == chunks_size / (int)sizeof (Sint32)
+        && spawns_size % (int)sizeof (struct map_spawn) == 0;
+
+  const Sint32 slot_count = chunks_size / (Sint32)sizeof (Sint32);
+  b_is_valid = b_is_valid && grid_init (&map->grid, w, h)
+               && slot_count <= map->grid.chunks_w * map->grid.chunks_h
+               && place_chunks (&map->grid, chunks, cells, slot_count)
+               && place_spawns (map, spawns,
+                                spawns_size
+                                    / (Sint32)sizeof (struct map_spawn));
+
+  SDL_free (data);
+  if (b_is_valid == false)
+    {
+      map_free (map);
+    }
+  return b_is_valid;
+}
+
+bool
+map_load (const char *path, struct map *map)
+{
+  const size_t length = SDL_strlen (path);
+  const size_t extension_length = SDL_strlen (MAP_BINARY_EXTENSION);
+  if (length >= extension_length
+      && SDL_strcasecmp (path + length - extension_length,
+                         MAP_BINARY_EXTENSION)
+             == 0)
+    {
+      return map_load_binary (path, map);
+    }
+  return map_load_text (path, map);
+}
+
+bool
+map_save_binary (const char *path, const struct map *map)
+{
+  const struct grid *grid = &map->grid;
+  const Sint32 spawn_int_count = map->spawn_count * 3;
+
+  /* Little-endian copies of the int32 tables, never empty so binn always
+   * gets a pointer. */
+  Sint32 *chunks = SDL_malloc (SDL_max ((size_t)grid->slot_count, (size_t)1u)
+                               * sizeof (Sint32));
+  Sint32 *spawns = SDL_malloc (SDL_max ((size_t)spawn_int_count, (size_t)1u)
+                               * sizeof (Sint32));
+  binn *obj = binn_object ();
+  bool b_is_saved = chunks != NULL && spawns != NULL && obj != NULL;
+  if (b_is_saved == true)
+    {
+      for (Sint32 slot = 0; slot < grid->slot_count; slot++)
+        {
+          chunks[slot] = (Sint32)SDL_Swap32LE ((Uint32)grid->slot_chunks[slot]);
+        }
+      const Sint32 *spawn_ints = (const Sint32 *)map->spawns;
+      for (Sint32 i = 0; i < spawn_int_count; i++)
+        {
+          spawns[i] = (Sint32)SDL_Swap32LE ((Uint32)spawn_ints[i]);
+        }
+
+      b_is_saved
+          = binn_object_set_uint32 (obj, "version", MAP_BINARY_VERSION)
+            && binn_object_set_int32 (obj, "w", grid->w)
+            && binn_object_set_int32 (obj, "h", grid->h)
+            && binn_object_set_blob (obj, "chunks", chunks,
+                                     grid->slot_count * (int)sizeof (Sint32))
+            && binn_object_set_blob (obj, "cells",
+                                     grid->cells != NULL ? grid->cells
+                                                         : (void *)chunks,
+                                     grid_cell_count (grid))
+            && binn_object_set_blob (obj, "spawns", spawns,
+                                     spawn_int_count * (int)sizeof (Sint32))
+            && SDL_SaveFile (path, binn_ptr (obj), (size_t)binn_size (obj));
+    }
+
+  if (obj != NULL)
+    {
+      binn_free (obj);
+    }
+  SDL_free (chunks);
+  SDL_free (spawns);
+  return b_is_saved;
+}
@@ -0,0 +1,80 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Map files. A text map holds one line per row of cells: '0' is floor, '1'
+ *  a wall, '2' a rock, and ' ' or '.' leave the cell out of the map. Spawn
+ *  points are floor cells marked with the letter of what starts there, see
+ *  map_prefab. Any other letter or digit is plain floor. Rows may differ in
+ *  length, the map is as wide as its longest one.
+ *
+ *  A compiled map is a binn object holding the same map ready to use: the
+ *  chunk cells exactly as the grid stores them, and the spawns. Loading one
+ *  copies the cells in, with nothing to parse. Text maps are compiled with
+ *  bomberman_mapc.
+ *
+ *  Loading a map only builds the cell grid and the spawn list, which do not
+ *  need the ECS world, so the map size is known before the window is
+ *  created. */
+
+#ifndef BOMBERMAN_MAP_FILE_H
+#define BOMBERMAN_MAP_FILE_H
+
+#include "SDL3/SDL.h"
+
+#include "grid.h"
+
+#define MAP_BINARY_VERSION 1u
+#define MAP_BINARY_EXTENSION ".bmap"
+
+/** What spawns on a cell, with its letter in text maps. Stored as is in
+ *  compiled maps, so new ids only ever go at the end. */
+enum map_prefab
+{
+  MAP_PREFAB_BOMBER,         /* 'P' */
+  MAP_PREFAB_CURSED_BALLOON, /* 'b' */
+  MAP_PREFAB_COP_CAR,        /* 'c' */
+  MAP_PREFAB_GHOST,          /* 'g' */
+  MAP_PREFAB_COUNT
+};
+
+struct map_spawn
+{
+  Sint32 x;
+  Sint32 y;
+  Sint32 prefab; /* See map_prefab. */
+};
+
+struct map
+{
+  struct grid grid;
+  struct map_spawn *spawns; /* In file order. */
+  Sint32 spawn_count;
+};
+
+/**
+ * Reads a text map in one go. The map is (re)initialised to the size of the
+ * file, and only the chunks holding map cells are populated.
+ * @return false if the file could not be read or the map allocated.
+ */
+bool map_load_text (const char *path, struct map *map);
+
+/**
+ * Reads a compiled map in one go. The map is (re)initialised.
+ * @return false if the file could not be read, is not a compiled map of
+ * this version, or is inconsistent.
+ */
+bool map_load_binary (const char *path, struct map *map);
+
+/**
+ * Reads a compiled map if the path ends with MAP_BINARY_EXTENSION, a text
+ * map otherwise.
+ */
+bool map_load (const char *path, struct map *map);
+
+/**
+ * Writes a map in the compiled format.
+ * @return false if it could not be encoded or written.
+ */
+bool map_save_binary (const char *path, const struct map *map);
+
+void map_free (struct map *map);
+
+#endif /* BOMBERMAN_MAP_FILE_H */
@@ -0,0 +1,473 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette */
+
+#include "map_view.h"
+
+/* Game modules dependencies. */
+#include "log.h"
+
+static SDL_FColor
+get_color (const color_c *color)
+{
+  return (SDL_FColor){ color->default_r / 255.f, color->default_g / 255.f,
+                       color->default_b / 255.f, 1.f };
+}
+
+/**
+ * Reads the sprite of a tile off its prefab: the first cell-sized frame of
+ * its sheet, tinted with the prefab's colour if the sprite uses it.
+ */
+static void
+set_tile (struct map_view *view, ecs_world_t *world, Uint8 tile,
+          ecs_entity_t pfb)
+{
+  view->tile_color[tile] = (SDL_FColor){ 1.f, 1.f, 1.f, 1.f };
+  const sprite_c *sprite = pfb != 0u ? ecs_get (world, pfb, sprite_c) : NULL;
+  if (sprite == NULL)
+    {
+      return;
+    }
+  const struct sprite_sheet *sheet
+      = sprite_sheets_find (&view->sheets, string_get_cstr (sprite->name));
+  if (sheet == NULL)
+    {
+      log_error (0, "No sheet for the tile sprite %s",
+                 string_get_cstr (sprite->name));
+      return;
+    }
+  view->tile_src[tile]
+      = (SDL_FRect){ (float)sheet->rect.x, (float)sheet->rect.y,
+                     (float)SDL_min (sheet->rect.w, CELL_SIZE),
+                     (float)SDL_min (sheet->rect.h, CELL_SIZE) };
+  const color_c *color = ecs_get (world, pfb, color_c);
+  if (sprite->b_uses_color == true && color != NULL)
+    {
+      view->tile_color[tile] = get_color (color);
+    }
+}
+
+bool
+map_view_init (struct map_view *view, ecs_world_t *world,
+               SDL_Renderer *renderer, const char *dir)
+{
+  SDL_zerop (view);
+  view->renderer = renderer;
+  view->size = (SDL_FPoint){ (float)LOGIC_WIDTH, (float)LOGIC_HEIGHT };
+  sprite_batch_init (&view->batch);
+  arr_view_sprite_init (view->sprites);
+  view->followed = ecs_query (
+      world, { .terms = { { .id = ecs_id (scroll_to_c) },
+                          { .id = ecs_id (index_c) } } });
+  view->dynamic = ecs_query (
+      world, { .terms = { { .id = ecs_id (index_c) },
+                          { .id = ecs_id (sprite_c) },
+                          { .id = ecs_id (layer_c) } } });
+  if (sprite_sheets_load (&view->sheets, renderer, dir) == false)
+    {
+      return false;
+    }
+
+  const game_s *game = ecs_singleton_get (world, game_s);
+  set_tile (view, world, TILE_FLOOR, ecs_lookup (world, "floor_pfb"));
+  set_tile (view, world, TILE_WALL, ecs_lookup (world, "wall_pfb"));
+  set_tile (view, world, TILE_ROCK, game->handles.rock_pfb);
+  return true;
+}
+
+void
+map_view_free (struct map_view *view)
+{
+  for (Sint32 i = 0; i < view->chunk_count; i++)
+    {
+      SDL_DestroyTexture (view->chunks[i]);
+    }
+  SDL_free (view->chunks);
+  if (view->followed != NULL)
+    {
+      ecs_query_fini (view->followed);
+    }
+  if (view->dynamic != NULL)
+    {
+      ecs_query_fini (view->dynamic);
+    }
+  arr_view_sprite_clear (view->sprites);
+  sprite_batch_free (&view->batch);
+  sprite_sheets_free (&view->sheets);
+  SDL_zerop (view);
+}
+
+/**
+ * Render target of a slot, created cleared on first use.
+ * @return NULL if it could not be created.
+ */
+static SDL_Texture *
+get_chunk (struct map_view *view, Sint32 slot, Sint32 slot_count)
+{
+  if (slot_count > view->chunk_count)
+    {
+      SDL_Texture **chunks = SDL_realloc (
+          view->chunks, (size_t)slot_count * sizeof (SDL_Texture *));
+      if (chunks == NULL)
+        {
+          return NULL;
+        }
+      SDL_memset (&chunks[view->chunk_count], 0,
+                  (size_t)(slot_count - view->chunk_count)
+                      * sizeof (SDL_Texture *));
+      view->chunks = chunks;
+      view->chunk_count = slot_count;
+    }
+
+  if (view->chunks[slot] == NULL)
+    {
+      SDL_Texture *texture = SDL_CreateTexture (
+          view->renderer, SDL_PIXELFORMAT_RGBA8888,
+          SDL_TEXTUREACCESS_TARGET, CHUNK_WIDTH, CHUNK_WIDTH);
+      if (texture == NULL
+          || SDL_SetRenderTarget (view->renderer, texture) == false)
+        {
+          log_error (0, "Failed to create a chunk target: %s",
+                     SDL_GetError ());
+          SDL_DestroyTexture (texture);
+          return NULL;
+        }
+      SDL_SetTextureScaleMode (texture, SDL_SCALEMODE_NEAREST);
+      SDL_SetRenderDrawColor (view->renderer, 0, 0, 0, 255);
+      SDL_RenderClear (view->renderer);
+      view->chunks[slot] = texture;
+    }
+  return view->chunks[slot];
+}
+
+static void
+add_tile (struct map_view *view, Uint8 tile, const SDL_FRect *dst)
+{
+  if (view->tile_src[tile].w > 0.f)
+    {
+      sprite_batch_add (&view->batch, view->sheets.texture, 0,
+                        &view->tile_src[tile], dst, view->tile_color[tile]);
+    }
+}
+
+/**
+ * Paints cells of one slot into its chunk: the cells are cleared, then
+ * each gets its floor and the wall or rock over it, all in one draw call.
+ * Rocks are outlined when their prefab shows its box, see the G key.
+ */
+static void
+paint_chunk (struct map_view *view, ecs_world_t *world,
+             const tilemap_c *tilemap, const Sint32 *cells, Sint32 count)
+{
+  const game_s *game = ecs_singleton_get (world, game_s);
+  const Sint32 slot = cells[0] / GRID_CHUNK_CELLS;
+  SDL_Texture *texture = get_chunk (view, slot, game->grid.slot_count);
+  if (texture == NULL
+      || SDL_SetRenderTarget (view->renderer, texture) == false)
+    {
+      return;
+    }
+
+  const box_c *box = ecs_get (world, game->handles.rock_pfb, box_c);
+  const bool b_outlines_rocks = box != NULL && box->b_is_shown == true;
+  Sint32 outline_count = 0;
+  for (Sint32 i = 0; i < count; i++)
+    {
+      const Sint32 local = cells[i] & (GRID_CHUNK_CELLS - 1);
+      const SDL_FRect dst
+          = { (float)((local & GRID_CHUNK_MASK) * CELL_SIZE),
+              (float)((local >> GRID_CHUNK_BITS) * CELL_SIZE),
+              (float)CELL_SIZE, (float)CELL_SIZE };
+      const Uint8 tile = tilemap_get (&tilemap->map, cells[i]);
+      view->cleared[i] = dst;
+      add_tile (view, TILE_FLOOR, &dst);
+      if (tile != TILE_FLOOR)
+        {
+          add_tile (view, tile, &dst);
+        }
+      if (tile == TILE_ROCK && b_outlines_rocks == true)
+        {
+          view->outlined[outline_count++] = dst;
+        }
+    }
+
+  SDL_BlendMode blend_mode = SDL_BLENDMODE_BLEND;
+  SDL_GetRenderDrawBlendMode (view->renderer, &blend_mode);
+  SDL_SetRenderDrawBlendMode (view->renderer, SDL_BLENDMODE_NONE);
+  SDL_SetRenderDrawColor (view->renderer, 0, 0, 0, 255);
+  SDL_RenderFillRects (view->renderer, view->cleared, count);
+  SDL_SetRenderDrawBlendMode (view->renderer, blend_mode);
+  sprite_batch_flush (&view->batch, view->renderer);
+
+  const color_c *color = ecs_get (world, game->handles.rock_pfb, color_c);
+  if (outline_count > 0 && color != NULL)
+    {
+      const SDL_FColor outline = get_color (color);
+      SDL_SetRenderDrawColorFloat (view->renderer, outline.r, outline.g,
+                                   outline.b, outline.a);
+      SDL_RenderRects (view->renderer, view->outlined, outline_count);
+    }
+}
+
+static int
+compare_cells (const void *a, const void *b)
+{
+  const Sint32 lhs = *(const Sint32 *)a;
+  const Sint32 rhs = *(const Sint32 *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+/**
+ * Paints every tile the tilemap hands out, chunk by chunk. The dense cell
+ * indices run slot by slot, so sorting them groups the cells of a chunk.
+ */
+static void
+paint_tiles (struct map_view *view, ecs_world_t *world)
+{
+  tilemap_c *tilemap = ecs_get_mut (world, ecs_id (tilemap_c), tilemap_c);
+  const Sint32 count = tilemap_take (&tilemap->map);
+  if (count == 0)
+    {
+      return;
+    }
+
+  Sint32 *cells = tilemap->map.taken;
+  SDL_qsort (cells, (size_t)count, sizeof (Sint32), compare_cells);
+  SDL_Texture *target = SDL_GetRenderTarget (view->renderer);
+  for (Sint32 first = 0, last = 0; first < count; first = last)
+    {
+      const Sint32 slot = cells[first] / GRID_CHUNK_CELLS;
+      while (last < count && cells[last] / GRID_CHUNK_CELLS == slot)
+        {
+          last++;
+        }
+      paint_chunk (view, world, tilemap, &cells[first], last - first);
+    }
+  SDL_SetRenderTarget (view->renderer, target);
+}
+
+static bool
+is_in_sight (const struct map_view *view, const SDL_FRect *dst)
+{
+  return dst->x + dst->w > 0.f && dst->y + dst->h > 0.f
+         && dst->x < view->size.x && dst->y < view->size.y;
+}
+
+/**
+ * Centres the camera on the followed entity, without showing past the
+ * edges of the map. A map smaller than the view stays in its corner.
+ */
+static void
+follow (struct map_view *view, ecs_world_t *world)
+{
+  const game_s *game = ecs_singleton_get (world, game_s);
+  ecs_iter_t it = ecs_query_iter (world, view->followed);
+  while (ecs_query_next (&it))
+    {
+      for (Sint32 i = 0; i < it.count; i++)
+        {
+          const ecs_entity_t ent = it.entities[i];
+          const index_c *index = ecs_field (&it, index_c, 1);
+          const origin_c *origin = ecs_get (world, ent, origin_c);
+          SDL_FPoint pos = { (float)(index[i].x * CELL_SIZE),
+                             (float)(index[i].y * CELL_SIZE) };
+          if (origin != NULL && origin->relative_callback != NULL)
+            {
+              pos = origin->relative_callback (ent, world);
+            }
+          view->camera.x = pos.x + (CELL_SIZE - view->size.x) / 2.f;
+          view->camera.y = pos.y + (CELL_SIZE - view->size.y) / 2.f;
+        }
+    }
+
+  const float max_x = (float)(game->grid.w * CELL_SIZE) - view->size.x;
+  const float max_y = (float)(game->grid.h * CELL_SIZE) - view->size.y;
+  view->camera.x = SDL_floorf (SDL_clamp (view->camera.x, 0.f,
+                                          SDL_max (max_x, 0.f)));
+  view->camera.y = SDL_floorf (SDL_clamp (view->camera.y, 0.f,
+                                          SDL_max (max_y, 0.f)));
+}
+
+void
+map_view_draw (struct map_view *view, ecs_world_t *world)
+{
+  paint_tiles (view, world);
+  follow (view, world);
+
+  const game_s *game = ecs_singleton_get (world, game_s);
+  for (Sint32 slot = 0; slot < view->chunk_count; slot++)
+    {
+      if (view->chunks[slot] == NULL)
+        {
+          continue;
+        }
+      const Sint32 chunk = game->grid.slot_chunks[slot];
+      const SDL_FRect dst
+          = { (float)((chunk % game->grid.chunks_w) * CHUNK_WIDTH)
+                  - view->camera.x,
+              (float)((chunk / game->grid.chunks_w) * CHUNK_WIDTH)
+                  - view->camera.y,
+              (float)CHUNK_WIDTH, (float)CHUNK_WIDTH };
+      if (is_in_sight (view, &dst) == true)
+        {
+          SDL_RenderTexture (view->renderer, view->chunks[slot], NULL, &dst);
+        }
+    }
+}
+
+static int
+compare_sprites (const void *a, const void *b)
+{
+  const struct map_view_sprite *lhs = a;
+  const struct map_view_sprite *rhs = b;
+  if (lhs->layer != rhs->layer)
+    {
+      return (lhs->layer > rhs->layer) - (lhs->layer < rhs->layer);
+    }
+  return (lhs->ent > rhs->ent) - (lhs->ent < rhs->ent);
+}
+
+/**
+ * Flipbook an anim player is playing, NULL if it has none.
+ */
+static const struct anim_flipbook *
+get_flipbook (const anim_player_c *anim_player)
+{
+  struct anim_pose *const *pose = dict_string_anim_pose_cget (
+      anim_player->poses, anim_player->control_pose);
+  if (pose == NULL)
+    {
+      return NULL;
+    }
+  struct anim_flipbook *const *flipbook = dict_sint32_anim_flipbook_cget (
+      (*pose)->directions, anim_player->control_direction);
+  return flipbook != NULL ? *flipbook : NULL;
+}
+
+/**
+ * Finds the current frame of an entity in the atlas. Animated entities
+ * play the flipbook of their anim player, play_speed frames per second of
+ * the match. The others play their sprite's sheet as a flipbook of
+ * cell-sized frames.
+ * @return false if the sheet was not packed.
+ */
+static bool
+get_frame (const struct map_view *view, ecs_world_t *world, ecs_entity_t ent,
+           const sprite_c *sprite, SDL_FRect *src)
+{
+  const game_s *game = ecs_singleton_get (world, game_s);
+  const anim_player_c *anim_player = ecs_get (world, ent, anim_player_c);
+  const struct anim_flipbook *flipbook
+      = anim_player != NULL ? get_flipbook (anim_player) : NULL;
+  const struct sprite_sheet *sheet = sprite_sheets_find (
+      &view->sheets, string_get_cstr (flipbook != NULL ? flipbook->name
+                                                       : sprite->name));
+  if (sheet == NULL)
+    {
+      return false;
+    }
+
+  SDL_FPoint size = { (float)CELL_SIZE,
+                      (float)SDL_min (sheet->rect.h, CELL_SIZE) };
+  Sint32 frames = SDL_max (sheet->rect.w / CELL_SIZE, 1);
+  Uint64 played = game->timers.now / MAP_VIEW_FRAME_TICKS;
+  if (flipbook != NULL)
+    {
+      size = flipbook->frame_size;
+      frames = SDL_max (flipbook->frame_count.x, 1);
+      played = game->timers.now * flipbook->play_speed / SIM_TICK_RATE;
+    }
+  const Sint32 frame = (Sint32)(played % (Uint64)frames);
+  *src = (SDL_FRect){ (float)sheet->rect.x + (float)frame * size.x,
+                      (float)sheet->rect.y, size.x, size.y };
+  return true;
+}
+
+void
+map_view_gather (struct map_view *view, ecs_world_t *world)
+{
+  arr_view_sprite_reset (view->sprites);
+  ecs_iter_t it = ecs_query_iter (world, view->dynamic);
+  while (ecs_query_next (&it))
+    {
+      const index_c *index = ecs_field (&it, index_c, 0);
+      const sprite_c *sprite = ecs_field (&it, sprite_c, 1);
+      const layer_c *layer = ecs_field (&it, layer_c, 2);
+      for (Sint32 i = 0; i < it.count; i++)
+        {
+          const sprite_c *own = ecs_field_is_self (&it, 1) ? &sprite[i]
+                                                           : sprite;
+          const layer_c *own_layer
+              = ecs_field_is_self (&it, 2) ? &layer[i] : layer;
+          SDL_FPoint pos = { (float)(index[i].x * CELL_SIZE),
+                             (float)(index[i].y * CELL_SIZE) };
+          const origin_c *origin = ecs_get (world, it.entities[i], origin_c);
+          if (origin != NULL && origin->relative_callback != NULL)
+            {
+              pos = origin->relative_callback (it.entities[i], world);
+            }
+          const SDL_FRect dst = { pos.x - view->camera.x,
+                                  pos.y - view->camera.y, (float)CELL_SIZE,
+                                  (float)CELL_SIZE };
+          SDL_FRect src;
+          if (is_in_sight (view, &dst) == false
+              || get_frame (view, world, it.entities[i], own, &src) == false)
+            {
+              continue;
+            }
+
+          struct map_view_sprite drawn
+              = { .layer = own_layer->value,
+                  .ent = it.entities[i],
+                  .src = src,
+                  .dst = dst };
+          arr_view_sprite_push_back (view->sprites, drawn);
+        }
+    }
+
+  const size_t count = arr_view_sprite_size (view->sprites);
+  if (count > 1u)
+    {
+      SDL_qsort (arr_view_sprite_get (view->sprites, 0u), count,
+                 sizeof (struct map_view_sprite), compare_sprites);
+    }
+}
+
+Sint32
+map_view_draw_sprites (struct map_view *view)
+{
+  const SDL_FColor white = { 1.f, 1.f, 1.f, 1.f };
+  for (size_t i = 0u; i < arr_view_sprite_size (view->sprites); i++)
+    {
+      const struct map_view_sprite *sprite
+          = arr_view_sprite_cget (view->sprites, i);
+      sprite_batch_add (&view->batch, view->sheets.texture, sprite->layer,
+                        &sprite->src, &sprite->dst, white);
+    }
+  return sprite_batch_flush (&view->batch, view->renderer);
+}
+
+static void
+system_draw_sprites (ecs_iter_t *it)
+{
+  struct map_view *view = it->ctx;
+  map_view_gather (view, it->world);
+  map_view_draw_sprites (view);
+}
+
+void
+map_view_add_system (struct map_view *view, ecs_world_t *world)
+{
+  /* The grid objects created from now on are hidden, whether they inherit
+   * the visibility or copy it, and Pluto skips them. The map view draws
+   * them whatever their visibility. */
+  const ecs_entity_t pfb = ecs_lookup (world, "grid_object_pfb");
+  visibility_c *visibility = ecs_get_mut (world, pfb, visibility_c);
+  visibility->b_state = false;
+  ecs_modified (world, pfb, visibility_c);
+
+  ecs_system (world,
+              { .entity = ecs_entity (
+                    world, { .name = "system_draw_sprites",
+                             .add = ecs_ids (ecs_dependson (EcsOnStore)) }),
+                .callback = system_draw_sprites,
+                .ctx = view });
+}
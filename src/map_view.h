@@ -0,0 +1,92 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Map view: draws the tilemap of the match. Every populated chunk of the
+ *  grid gets its own render target, CHUNK_WIDTH pixels a side, into which
+ *  the tiles taken from the tilemap are painted, sprites taken from the
+ *  floor_pfb, wall_pfb and rock_pfb prefabs. The tiles of a chunk are
+ *  painted in one sprite_batch flush, a single draw call however many
+ *  changed. The chunks in sight are then drawn under a camera following the
+ *  entity with a scroll_to_c, kept within the map.
+ *
+ *  The dynamic layer (characters, bombs and explosions) is drawn over it
+ *  from the same atlas, through the sprite batch as well: one draw call per
+ *  layer rather than one per sprite. Entities with an anim player play its
+ *  flipbook, the others play their sheet as a flipbook of cell-sized
+ *  frames, MAP_VIEW_FRAME_TICKS ticks each. */
+
+#ifndef BOMBERMAN_MAP_VIEW_H
+#define BOMBERMAN_MAP_VIEW_H
+
+#include "SDL3/SDL.h"
+
+#include "sim.h"
+#include "sprite_batch.h"
+#include "sprite_sheets.h"
+
+#define MAP_VIEW_FRAME_TICKS 4u /* Ticks per flipbook frame. */
+
+/* A sprite of the dynamic layer, gathered before it is drawn. */
+struct map_view_sprite
+{
+  Sint32 layer;
+  ecs_entity_t ent; /* Orders the sprites of a layer, frame after frame. */
+  SDL_FRect src;
+  SDL_FRect dst;
+};
+
+ARRAY_DEF (arr_view_sprite, struct map_view_sprite, M_POD_OPLIST)
+
+struct map_view
+{
+  SDL_Renderer *renderer;
+  struct sprite_sheets sheets;
+  struct sprite_batch batch;
+  SDL_Texture **chunks; /* Target of each slot of the grid, NULL if unused. */
+  Sint32 chunk_count;
+  SDL_FRect tile_src[TILE_COUNT]; /* Empty for the tiles without a sheet. */
+  SDL_FColor tile_color[TILE_COUNT];
+  SDL_FPoint camera; /* Map position drawn at the top-left corner. */
+  SDL_FPoint size;   /* Pixels in sight, LOGIC_WIDTH by LOGIC_HEIGHT. */
+  ecs_query_t *followed;
+  ecs_query_t *dynamic;
+  arr_view_sprite_t sprites; /* Dynamic layer in sight, in drawing order. */
+  SDL_FRect cleared[GRID_CHUNK_CELLS]; /* Cells painted in the chunk. */
+  SDL_FRect outlined[GRID_CHUNK_CELLS];
+};
+
+/**
+ * Loads the sheets of a directory for a renderer and looks up the sprites
+ * of the tiles. Call once init_sim is done.
+ * @return false if the sheets could not be loaded.
+ */
+bool map_view_init (struct map_view *view, ecs_world_t *world,
+                    SDL_Renderer *renderer, const char *dir);
+void map_view_free (struct map_view *view);
+
+/**
+ * Paints the tiles taken from the tilemap into their chunk, moves the
+ * camera and draws the chunks in sight on the current render target.
+ * Called once per frame, before the entities are drawn over the map.
+ */
+void map_view_draw (struct map_view *view, ecs_world_t *world);
+
+/**
+ * Lists the sprites of the dynamic layer in sight into view->sprites, in
+ * drawing order, placed under the camera. The sprites of a layer are drawn
+ * in the order of their entity, so overlapping ones never swap.
+ */
+void map_view_gather (struct map_view *view, ecs_world_t *world);
+
+/**
+ * Draws the gathered sprites through the sprite batch.
+ * @return the number of draw calls it took.
+ */
+Sint32 map_view_draw_sprites (struct map_view *view);
+
+/**
+ * Has the map view draw the dynamic layer in the OnStore phase, in place of
+ * Pluto: the grid objects are hidden from its sprite render. Call before
+ * any grid object is created.
+ */
+void map_view_add_system (struct map_view *view, ecs_world_t *world);
+
+#endif /* BOMBERMAN_MAP_VIEW_H */
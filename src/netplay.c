@@ -0,0 +1,606 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Netplay over SDL_net datagrams. Every packet starts with NETPLAY_MAGIC and
+ *  a packet type, all integers are little-endian:
+ *    HELLO    uint32 protocol version, sent by the joining peer until welcomed
+ *    WELCOME  uint64 match seed, the host's answer to every HELLO
+ *    INPUTS   uint32 first tick, uint32 ack, uint8 count, int8 advantage,
+ *             count inputs
+ *  The ack of an INPUTS packet is how many of the receiver's inputs the
+ *  sender holds, the receiver resends from there. The advantage is how many
+ *  ticks the sender runs past the last input it received, see
+ *  should_wait_for_peer. */
+
+#include "netplay.h"
+
+#include "SDL3_net/SDL_net.h"
+
+#include "log.h"
+
+#define NETPLAY_MAGIC 0x504E4D42u /* "BMNP" */
+#define NETPLAY_PROTOCOL_VERSION 1u
+#define NETPLAY_HELLO_INTERVAL_MS 100u
+#define NETPLAY_SILENCE_WARNING_MS 3000u
+#define NETPLAY_INPUT_WINDOW 128 /* Ticks of inputs kept, a power of two. */
+#define NETPLAY_INPUTS_PER_PACKET 48 /* Inputs repeated in a packet at most. */
+#define NETPLAY_INPUTS_HEADER 15
+#define NETPLAY_MAX_PACKET (NETPLAY_INPUTS_HEADER + NETPLAY_INPUTS_PER_PACKET)
+#define NETPLAY_SYNC_INTERVAL 10 /* Ticks between two frames skipped. */
+#define NETPLAY_DELAY_QUEUE 256 /* Packets held back by the simulated delay. */
+#define NETPLAY_HISTORY_FRAMES                                                \
+  (NETPLAY_MAX_PREDICTION + 2 * SNAPSHOT_KEY_INTERVAL)
+
+SDL_COMPILE_TIME_ASSERT (
+    netplay_window,
+    NETPLAY_INPUT_WINDOW > 2 * (NETPLAY_MAX_PREDICTION + NETPLAY_INPUT_DELAY)
+        + NETPLAY_INPUTS_PER_PACKET);
+
+enum netplay_packet_type
+{
+  NETPLAY_PACKET_HELLO,
+  NETPLAY_PACKET_WELCOME,
+  NETPLAY_PACKET_INPUTS
+};
+
+struct netplay_packet
+{
+  Uint64 due_ms; /* When a delayed packet leaves. */
+  Sint32 size;
+  Uint8 data[NETPLAY_MAX_PACKET];
+};
+
+struct netplay
+{
+  NET_DatagramSocket *socket;
+  NET_Address *peer; /* NULL until the joining peer said hello. */
+  Uint16 peer_port;
+  bool b_is_host;
+  bool b_is_welcomed; /* The host answered, when joining. */
+  Uint64 seed;
+  Sint32 loss_percent;
+  Uint32 delay_ms;
+  struct netplay_packet *delayed; /* Ring of NETPLAY_DELAY_QUEUE packets. */
+  Sint32 delayed_head;
+  Sint32 delayed_count;
+
+  /* Inputs by tick, modulo NETPLAY_INPUT_WINDOW. */
+  Uint8 local[NETPLAY_INPUT_WINDOW];
+  Uint8 remote[NETPLAY_INPUT_WINDOW];
+  Uint8 predicted[NETPLAY_INPUT_WINDOW]; /* Remote input simulated with. */
+  Uint64 frame;         /* Next tick to simulate. */
+  Uint64 local_count;   /* Local inputs known, from tick 0. */
+  Uint64 remote_count;  /* Remote inputs received, from tick 0. */
+  Uint64 peer_ack;      /* Local inputs the peer holds. */
+  Uint64 rollback_tick; /* Earliest mispredicted tick, or SDL_MAX_UINT64. */
+  Sint32 peer_advantage;
+  Uint64 last_skip; /* Tick at which a frame was last skipped to sync. */
+
+  struct snapshot_ring history; /* State at the start of each tick. */
+  Uint8 *state;
+  size_t state_capacity;
+  Uint64 last_receive_ms;
+  bool b_has_warned;
+  struct netplay_stats stats;
+};
+
+static Uint8 *
+write_u32 (Uint8 *out, Uint32 value)
+{
+  value = SDL_Swap32LE (value);
+  SDL_memcpy (out, &value, sizeof (value));
+  return out + sizeof (value);
+}
+
+static Uint8 *
+write_u64 (Uint8 *out, Uint64 value)
+{
+  value = SDL_Swap64LE (value);
+  SDL_memcpy (out, &value, sizeof (value));
+  return out + sizeof (value);
+}
+
+static Uint32
+read_u32 (const Uint8 *in)
+{
+  Uint32 value = 0u;
+  SDL_memcpy (&value, in, sizeof (value));
+  return SDL_Swap32LE (value);
+}
+
+static Uint64
+read_u64 (const Uint8 *in)
+{
+  Uint64 value = 0u;
+  SDL_memcpy (&value, in, sizeof (value));
+  return SDL_Swap64LE (value);
+}
+
+static Uint8 *
+write_header (Uint8 *out, enum netplay_packet_type type)
+{
+  out = write_u32 (out, NETPLAY_MAGIC);
+  *out++ = (Uint8)type;
+  return out;
+}
+
+/* Flushes the delayed packets which are due. */
+static void
+flush_delayed (struct netplay *netplay)
+{
+  const Uint64 now = SDL_GetTicks ();
+  while (netplay->delayed_count > 0)
+    {
+      const struct netplay_packet *packet
+          = &netplay->delayed[netplay->delayed_head];
+      if (packet->due_ms > now)
+        {
+          break;
+        }
+      NET_SendDatagram (netplay->socket, netplay->peer, netplay->peer_port,
+                        packet->data, packet->size);
+      netplay->delayed_head
+          = (netplay->delayed_head + 1) % NETPLAY_DELAY_QUEUE;
+      netplay->delayed_count--;
+    }
+}
+
+/* Sends a packet to the peer, through the simulated loss and delay. */
+static void
+send_packet (struct netplay *netplay, const Uint8 *data, Sint32 size)
+{
+  netplay->stats.packets_sent++;
+  if (netplay->loss_percent > 0 && SDL_rand (100) < netplay->loss_percent)
+    {
+      return;
+    }
+  if (netplay->delay_ms == 0u)
+    {
+      NET_SendDatagram (netplay->socket, netplay->peer, netplay->peer_port,
+                        data, size);
+      return;
+    }
+  if (netplay->delayed_count == NETPLAY_DELAY_QUEUE)
+    {
+      return;
+    }
+
+  struct netplay_packet *packet
+      = &netplay->delayed[(netplay->delayed_head + netplay->delayed_count)
+                          % NETPLAY_DELAY_QUEUE];
+  packet->due_ms = SDL_GetTicks () + netplay->delay_ms;
+  packet->size = size;
+  SDL_memcpy (packet->data, data, (size_t)size);
+  netplay->delayed_count++;
+}
+
+static void
+send_hello (struct netplay *netplay)
+{
+  Uint8 data[NETPLAY_MAX_PACKET];
+  Uint8 *cursor = write_header (data, NETPLAY_PACKET_HELLO);
+  cursor = write_u32 (cursor, NETPLAY_PROTOCOL_VERSION);
+  send_packet (netplay, data, (Sint32)(cursor - data));
+}
+
+static void
+send_welcome (struct netplay *netplay)
+{
+  Uint8 data[NETPLAY_MAX_PACKET];
+  Uint8 *cursor = write_header (data, NETPLAY_PACKET_WELCOME);
+  cursor = write_u64 (cursor, netplay->seed);
+  send_packet (netplay, data, (Sint32)(cursor - data));
+}
+
+/* Sends the local inputs the peer does not hold yet, oldest first. */
+static void
+send_inputs (struct netplay *netplay)
+{
+  const Uint64 oldest_kept
+      = netplay->local_count
+        - SDL_min (netplay->local_count, (Uint64)NETPLAY_INPUT_WINDOW);
+  const Uint64 first = SDL_max (netplay->peer_ack, oldest_kept);
+  const Uint64 count
+      = SDL_min (netplay->local_count - first, NETPLAY_INPUTS_PER_PACKET);
+
+  Uint8 data[NETPLAY_MAX_PACKET];
+  Uint8 *cursor = write_header (data, NETPLAY_PACKET_INPUTS);
+  cursor = write_u32 (cursor, (Uint32)first);
+  cursor = write_u32 (cursor, (Uint32)netplay->remote_count);
+  *cursor++ = (Uint8)count;
+  *cursor++ = (Uint8)(Sint8)SDL_clamp ((Sint64)netplay->frame
+                                            - (Sint64)netplay->remote_count,
+                                        -127, 127);
+  for (Uint64 tick = first; tick < first + count; tick++)
+    {
+      *cursor++ = netplay->local[tick % NETPLAY_INPUT_WINDOW];
+    }
+  send_packet (netplay, data, (Sint32)(cursor - data));
+}
+
+/* Appends the inputs of a packet following the ones already received, and
+ * notes the earliest tick simulated with a wrong prediction. */
+static void
+receive_inputs (struct netplay *netplay, const Uint8 *data, Sint32 size)
+{
+  if (size < NETPLAY_INPUTS_HEADER)
+    {
+      return;
+    }
+  const Uint64 first = read_u32 (data + 5);
+  const Uint64 ack = read_u32 (data + 9);
+  const Sint32 count = data[13];
+  if (count > NETPLAY_INPUTS_PER_PACKET
+      || size < NETPLAY_INPUTS_HEADER + count
+      || first > netplay->remote_count)
+    {
+      return;
+    }
+
+  netplay->peer_advantage = (Sint8)data[14];
+
+  netplay->peer_ack
+      = SDL_max (netplay->peer_ack, SDL_min (ack, netplay->local_count));
+  for (Uint64 tick = netplay->remote_count; tick < first + (Uint64)count;
+       tick++)
+    {
+      const Uint8 input = data[NETPLAY_INPUTS_HEADER + (tick - first)];
+      const Sint32 slot = (Sint32)(tick % NETPLAY_INPUT_WINDOW);
+      netplay->remote[slot] = input;
+      if (tick < netplay->frame && netplay->predicted[slot] != input)
+        {
+          netplay->rollback_tick = SDL_min (netplay->rollback_tick, tick);
+        }
+    }
+  netplay->remote_count
+      = SDL_max (netplay->remote_count, first + (Uint64)count);
+}
+
+/* Reads every datagram waiting on the socket. */
+static void
+receive_packets (struct netplay *netplay)
+{
+  NET_Datagram *datagram = NULL;
+  while (NET_ReceiveDatagram (netplay->socket, &datagram) == true
+         && datagram != NULL)
+    {
+      const Uint8 *data = datagram->buf;
+      const Sint32 size = datagram->buflen;
+      const bool b_is_ours = size >= 5 && read_u32 (data) == NETPLAY_MAGIC;
+      const bool b_is_from_peer
+          = netplay->peer != NULL
+            && NET_CompareAddresses (datagram->addr, netplay->peer) == 0
+            && datagram->port == netplay->peer_port;
+
+      if (b_is_ours == true && data[4] == NETPLAY_PACKET_HELLO
+          && netplay->b_is_host == true && size >= 9
+          && read_u32 (data + 5) == NETPLAY_PROTOCOL_VERSION
+          && (netplay->peer == NULL || b_is_from_peer == true))
+        {
+          if (netplay->peer == NULL)
+            {
+              netplay->peer = NET_RefAddress (datagram->addr);
+              netplay->peer_port = datagram->port;
+            }
+          netplay->last_receive_ms = SDL_GetTicks ();
+          send_welcome (netplay);
+        }
+      else if (b_is_ours == true && b_is_from_peer == true)
+        {
+          netplay->stats.packets_received++;
+          netplay->last_receive_ms = SDL_GetTicks ();
+          if (data[4] == NETPLAY_PACKET_WELCOME && netplay->b_is_host == false
+              && size >= 13)
+            {
+              netplay->seed = read_u64 (data + 5);
+              netplay->b_is_welcomed = true;
+            }
+          else if (data[4] == NETPLAY_PACKET_INPUTS)
+            {
+              receive_inputs (netplay, data, size);
+            }
+        }
+      NET_DestroyDatagram (datagram);
+      datagram = NULL;
+    }
+}
+
+struct netplay *
+netplay_connect (const struct netplay_params *params)
+{
+  if (NET_Init () == false)
+    {
+      log_error (0, "Failed to start SDL_net: %s", SDL_GetError ());
+      return NULL;
+    }
+
+  struct netplay *netplay = SDL_calloc (1u, sizeof (struct netplay));
+  if (netplay == NULL)
+    {
+      NET_Quit ();
+      return NULL;
+    }
+  netplay->b_is_host = params->host == NULL;
+  netplay->seed = params->seed;
+  netplay->loss_percent = params->loss_percent;
+  netplay->delay_ms = params->delay_ms;
+  netplay->local_count = NETPLAY_INPUT_DELAY;
+  netplay->remote_count = NETPLAY_INPUT_DELAY;
+  netplay->rollback_tick = SDL_MAX_UINT64;
+  netplay->delayed
+      = SDL_calloc (NETPLAY_DELAY_QUEUE, sizeof (struct netplay_packet));
+  netplay->socket = NET_CreateDatagramSocket (
+      NULL, netplay->b_is_host == true ? params->port : 0u);
+  if (netplay->delayed == NULL || netplay->socket == NULL
+      || snapshot_ring_init (&netplay->history, NETPLAY_HISTORY_FRAMES)
+             == false)
+    {
+      log_error (0, "Failed to open the netplay socket: %s", SDL_GetError ());
+      netplay_destroy (netplay);
+      return NULL;
+    }
+
+  if (netplay->b_is_host == false)
+    {
+      netplay->peer = NET_ResolveHostname (params->host);
+      netplay->peer_port = params->port;
+      if (netplay->peer == NULL
+          || NET_WaitUntilResolved (netplay->peer, -1) != NET_SUCCESS)
+        {
+          log_error (0, "Failed to resolve %s: %s", params->host,
+                     SDL_GetError ());
+          netplay_destroy (netplay);
+          return NULL;
+        }
+    }
+
+  /* The joining peer knocks until the host answers with the seed. The host
+   * is done as soon as someone knocked. */
+  SDL_Log (netplay->b_is_host == true ? "Waiting for a peer on port %u"
+                                      : "Joining on port %u",
+           (unsigned int)params->port);
+  const Uint64 start = SDL_GetTicks ();
+  Uint64 last_hello = 0u;
+  while ((netplay->b_is_host == true && netplay->peer == NULL)
+         || (netplay->b_is_host == false && netplay->b_is_welcomed == false))
+    {
+      const Uint64 now = SDL_GetTicks ();
+      if (now - start > NETPLAY_CONNECT_TIMEOUT_MS)
+        {
+          log_error (0, "No peer showed up");
+          netplay_destroy (netplay);
+          return NULL;
+        }
+      if (netplay->b_is_host == false
+          && now - last_hello >= NETPLAY_HELLO_INTERVAL_MS)
+        {
+          send_hello (netplay);
+          last_hello = now;
+        }
+      flush_delayed (netplay);
+      receive_packets (netplay);
+      SDL_Delay (1u);
+    }
+  netplay->last_receive_ms = SDL_GetTicks ();
+  SDL_Log ("Netplay started as player %d, seed %llu",
+           netplay_get_local_player (netplay) + 1,
+           (unsigned long long)netplay->seed);
+  return netplay;
+}
+
+void
+netplay_destroy (struct netplay *netplay)
+{
+  if (netplay == NULL)
+    {
+      return;
+    }
+  if (netplay->stats.ticks > 0u)
+    {
+      SDL_Log ("Netplay: %llu ticks, %llu rollbacks re-simulating %llu ticks, "
+               "%llu stalled frames, %llu packets sent, %llu received",
+               (unsigned long long)netplay->stats.ticks,
+               (unsigned long long)netplay->stats.rollbacks,
+               (unsigned long long)netplay->stats.resimulated_ticks,
+               (unsigned long long)netplay->stats.stalls,
+               (unsigned long long)netplay->stats.packets_sent,
+               (unsigned long long)netplay->stats.packets_received);
+    }
+  if (netplay->socket != NULL)
+    {
+      NET_DestroyDatagramSocket (netplay->socket);
+    }
+  if (netplay->peer != NULL)
+    {
+      NET_UnrefAddress (netplay->peer);
+    }
+  snapshot_ring_free (&netplay->history);
+  SDL_free (netplay->state);
+  SDL_free (netplay->delayed);
+  SDL_free (netplay);
+  NET_Quit ();
+}
+
+Uint64
+netplay_get_seed (const struct netplay *netplay)
+{
+  return netplay->seed;
+}
+
+Sint32
+netplay_get_local_player (const struct netplay *netplay)
+{
+  return netplay->b_is_host == true ? 0 : 1;
+}
+
+const struct netplay_stats *
+netplay_get_stats (const struct netplay *netplay)
+{
+  return &netplay->stats;
+}
+
+bool
+netplay_get_settled_inputs (const struct netplay *netplay, Uint64 tick,
+                            Uint8 *inputs)
+{
+  const Uint64 newest = SDL_max (netplay->local_count, netplay->remote_count);
+  if (tick >= netplay->frame || tick >= netplay->remote_count
+      || tick + NETPLAY_INPUT_WINDOW <= newest)
+    {
+      return false;
+    }
+  const Sint32 slot = (Sint32)(tick % NETPLAY_INPUT_WINDOW);
+  const Sint32 local_player = netplay_get_local_player (netplay);
+  inputs[local_player] = netplay->local[slot];
+  inputs[1 - local_player] = netplay->remote[slot];
+  return true;
+}
+
+/* Remote input a tick is simulated with: the real one if it arrived, the
+ * last one received otherwise. */
+static Uint8
+predict (const struct netplay *netplay, Uint64 tick)
+{
+  const Uint64 known = SDL_min (tick + 1u, netplay->remote_count);
+  return known > 0u ? netplay->remote[(known - 1u) % NETPLAY_INPUT_WINDOW]
+                    : 0u;
+}
+
+static void
+write_inputs (struct netplay *netplay, ecs_world_t *world)
+{
+  const Sint32 slot = (Sint32)(netplay->frame % NETPLAY_INPUT_WINDOW);
+  const Sint32 local_player = netplay_get_local_player (netplay);
+  netplay->predicted[slot] = predict (netplay, netplay->frame);
+  write_sim_input (world, get_player_controller (world, local_player),
+                   netplay->local[slot]);
+  write_sim_input (world, get_player_controller (world, 1 - local_player),
+                   netplay->predicted[slot]);
+}
+
+static void
+record_state (struct netplay *netplay, ecs_world_t *world)
+{
+  const size_t size
+      = snapshot_sim (world, &netplay->state, &netplay->state_capacity);
+  if (size == 0u
+      || snapshot_ring_push (&netplay->history, netplay->frame,
+                             netplay->state, size)
+             == false)
+    {
+      log_error (0, "Failed to record the state of tick %llu",
+                 (unsigned long long)netplay->frame);
+    }
+}
+
+/* Restores the first mispredicted tick and simulates again up to the present
+ * with what is now known of the remote inputs. Nothing is drawn meanwhile. */
+static void
+roll_back (struct netplay *netplay, ecs_world_t *world)
+{
+  const Uint64 tick = netplay->rollback_tick;
+  netplay->rollback_tick = SDL_MAX_UINT64;
+  if (tick >= netplay->frame)
+    {
+      return;
+    }
+
+  size_t size = 0u;
+  const Uint8 *state = snapshot_ring_get (&netplay->history, tick, &size);
+  if (state == NULL || restore_sim (world, state, size) == false
+      || snapshot_ring_rewind (&netplay->history, tick) == false)
+    {
+      log_error (0, "Failed to roll back to tick %llu, the match desyncs",
+                 (unsigned long long)tick);
+      return;
+    }
+
+  const Uint64 present = netplay->frame;
+  netplay->frame = tick;
+  while (netplay->frame < present)
+    {
+      write_inputs (netplay, world);
+      tick_sim (world);
+      ecs_progress (world, 0.f);
+      netplay->frame++;
+      record_state (netplay, world);
+    }
+
+  netplay->stats.rollbacks++;
+  netplay->stats.resimulated_ticks += present - tick;
+}
+
+/**
+ * Keeps the peers at the same pace. The one running further past the inputs
+ * of the other is the one predicting, and rolling back, all the time: it
+ * skips a frame now and then until both are as far ahead. A peer too far
+ * ahead waits altogether.
+ */
+static bool
+should_wait_for_peer (struct netplay *netplay)
+{
+  if (netplay->frame >= netplay->remote_count + NETPLAY_MAX_PREDICTION)
+    {
+      return true;
+    }
+
+  const Sint64 advantage
+      = (Sint64)netplay->frame - (Sint64)netplay->remote_count;
+  if (advantage - netplay->peer_advantage >= 2
+      && netplay->frame >= netplay->last_skip + NETPLAY_SYNC_INTERVAL)
+    {
+      netplay->last_skip = netplay->frame;
+      return true;
+    }
+  return false;
+}
+
+bool
+netplay_begin_tick (struct netplay *netplay, ecs_world_t *world,
+                    Uint8 local_input)
+{
+  if (netplay->history.count == 0)
+    {
+      record_state (netplay, world);
+    }
+
+  /* One local input per simulated tick, none while waiting. */
+  if (netplay->local_count == netplay->frame + NETPLAY_INPUT_DELAY)
+    {
+      netplay->local[netplay->local_count % NETPLAY_INPUT_WINDOW]
+          = local_input;
+      netplay->local_count++;
+    }
+
+  receive_packets (netplay);
+  send_inputs (netplay);
+  flush_delayed (netplay);
+  roll_back (netplay, world);
+
+  const Uint64 now = SDL_GetTicks ();
+  if (now - netplay->last_receive_ms > NETPLAY_SILENCE_WARNING_MS
+      && netplay->b_has_warned == false)
+    {
+      log_error (0, "Nothing heard from the peer for %u ms",
+                 (unsigned int)(now - netplay->last_receive_ms));
+      netplay->b_has_warned = true;
+    }
+  else if (now - netplay->last_receive_ms <= NETPLAY_SILENCE_WARNING_MS)
+    {
+      netplay->b_has_warned = false;
+    }
+
+  if (should_wait_for_peer (netplay) == true)
+    {
+      netplay->stats.stalls++;
+      return false;
+    }
+  write_inputs (netplay, world);
+  return true;
+}
+
+void
+netplay_end_tick (struct netplay *netplay, ecs_world_t *world)
+{
+  netplay->frame++;
+  netplay->stats.ticks++;
+  record_state (netplay, world);
+}
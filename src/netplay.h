@@ -0,0 +1,98 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Netplay: a versus match between two machines, each running the whole
+ *  simulation. Only the per-tick inputs of the players (see sim_input_bits)
+ *  cross the network, over UDP. The remote input of a tick which has not
+ *  arrived yet is predicted to repeat the last one received. When the real
+ *  one turns out to differ, the match is restored to that tick from a
+ *  snapshot history and simulated again up to the present, see restore_sim.
+ *
+ *  Local inputs take effect NETPLAY_INPUT_DELAY ticks after they are
+ *  sampled, which hides that much latency without any rollback. A peer never
+ *  runs more than NETPLAY_MAX_PREDICTION ticks past the last input it got
+ *  from the other, it waits for it instead. Every packet repeats the inputs
+ *  the other peer has not acknowledged yet, so a lost packet only costs a
+ *  rollback.
+ *
+ *  The host plays player 1 and picks the match seed, the peer joining it
+ *  plays player 2. Both must load the same map. */
+
+#ifndef BOMBERMAN_NETPLAY_H
+#define BOMBERMAN_NETPLAY_H
+
+#include "SDL3/SDL.h"
+
+#include "sim.h"
+
+#define NETPLAY_INPUT_DELAY 2
+#define NETPLAY_MAX_PREDICTION 12 /* 200 ms of ticks at 60 per second. */
+#define NETPLAY_CONNECT_TIMEOUT_MS 60000u
+
+struct netplay_params
+{
+  const char *host; /* Host to join, or NULL to host the match. */
+  Uint16 port;
+  Uint64 seed;          /* Match seed, only read when hosting. */
+  Sint32 loss_percent;  /* Outgoing packets dropped on purpose. */
+  Uint32 delay_ms;      /* Latency added to outgoing packets. */
+};
+
+struct netplay_stats
+{
+  Uint64 ticks;
+  Uint64 rollbacks;
+  Uint64 resimulated_ticks;
+  Uint64 stalls; /* Frames spent waiting on the peer. */
+  Uint64 packets_sent;
+  Uint64 packets_received;
+};
+
+struct netplay;
+
+/**
+ * Opens the socket and waits until the peers found each other, up to
+ * NETPLAY_CONNECT_TIMEOUT_MS.
+ * @return the session, or NULL if it could not be established.
+ */
+struct netplay *netplay_connect (const struct netplay_params *params);
+void netplay_destroy (struct netplay *netplay);
+
+/**
+ * @return the seed the host picked for the match.
+ */
+Uint64 netplay_get_seed (const struct netplay *netplay);
+
+/**
+ * @return the player played on this machine.
+ */
+Sint32 netplay_get_local_player (const struct netplay *netplay);
+
+const struct netplay_stats *netplay_get_stats (const struct netplay *netplay);
+
+/**
+ * Reads the inputs of every player on a tick both peers agree on, for
+ * recording the match (see replay_record_tick).
+ * @return false if the tick is not settled yet.
+ */
+bool netplay_get_settled_inputs (const struct netplay *netplay, Uint64 tick,
+                                 Uint8 *inputs);
+
+/**
+ * Starts the next tick: exchanges inputs with the peer, rolls the match back
+ * and simulates it again if a prediction was wrong, then writes the inputs of
+ * the tick into the player controllers.
+ * @param local_input What the local player holds this frame, see
+ * read_sim_input.
+ * Expects the drawing phases off, like the ticks the caller runs.
+ * @return false if the tick has to wait on the peer: nothing is to be
+ * simulated this time. Otherwise the caller runs tick_sim and ecs_progress,
+ * then calls netplay_end_tick.
+ */
+bool netplay_begin_tick (struct netplay *netplay, ecs_world_t *world,
+                         Uint8 local_input);
+
+/**
+ * Records the state the tick started by netplay_begin_tick led to.
+ */
+void netplay_end_tick (struct netplay *netplay, ecs_world_t *world);
+
+#endif /* BOMBERMAN_NETPLAY_H */
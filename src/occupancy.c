@@ -0,0 +1,156 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette */
+
+#include "occupancy.h"
+
+bool
+occupancy_init (struct occupancy *occupancy, const struct grid *grid)
+{
+  occupancy_free (occupancy);
+
+  occupancy->cell_count = grid_cell_count (grid);
+  occupancy->heads = SDL_malloc (
+      SDL_max ((size_t)occupancy->cell_count, (size_t)1u) * sizeof (Sint32));
+  if (occupancy->heads == NULL)
+    {
+      occupancy_free (occupancy);
+      return false;
+    }
+
+  occupancy_clear (occupancy);
+  return true;
+}
+
+void
+occupancy_free (struct occupancy *occupancy)
+{
+  SDL_free (occupancy->heads);
+  SDL_free (occupancy->occupants);
+  SDL_zerop (occupancy);
+}
+
+void
+occupancy_clear (struct occupancy *occupancy)
+{
+  for (Sint32 i = 0; i < occupancy->cell_count; i++)
+    {
+      occupancy->heads[i] = -1;
+    }
+  occupancy->occupant_count = 0;
+  occupancy->free_slot = -1;
+}
+
+static void
+link_occupant (struct occupancy *occupancy, Sint32 slot, Sint32 cell)
+{
+  struct occupant *occupant = &occupancy->occupants[slot];
+  occupant->cell = cell;
+  occupant->prev = -1;
+  occupant->next = occupancy->heads[cell];
+  if (occupant->next >= 0)
+    {
+      occupancy->occupants[occupant->next].prev = slot;
+    }
+  occupancy->heads[cell] = slot;
+}
+
+static void
+unlink_occupant (struct occupancy *occupancy, Sint32 slot)
+{
+  const struct occupant *occupant = &occupancy->occupants[slot];
+  if (occupant->prev >= 0)
+    {
+      occupancy->occupants[occupant->prev].next = occupant->next;
+    }
+  else
+    {
+      occupancy->heads[occupant->cell] = occupant->next;
+    }
+  if (occupant->next >= 0)
+    {
+      occupancy->occupants[occupant->next].prev = occupant->prev;
+    }
+}
+
+/**
+ * @return a free slot, growing the storage if needed, or -1 if it could
+ * not be.
+ */
+static Sint32
+acquire_slot (struct occupancy *occupancy)
+{
+  if (occupancy->free_slot >= 0)
+    {
+      const Sint32 slot = occupancy->free_slot;
+      occupancy->free_slot = occupancy->occupants[slot].next;
+      return slot;
+    }
+
+  if (occupancy->occupant_count == occupancy->occupant_capacity)
+    {
+      const Sint32 capacity = SDL_max (occupancy->occupant_capacity * 2, 64);
+      struct occupant *occupants = SDL_realloc (
+          occupancy->occupants, (size_t)capacity * sizeof (*occupants));
+      if (occupants == NULL)
+        {
+          return -1;
+        }
+      occupancy->occupants = occupants;
+      occupancy->occupant_capacity = capacity;
+    }
+  return occupancy->occupant_count++;
+}
+
+Sint32
+occupancy_add (struct occupancy *occupancy, const struct grid *grid, Sint32 x,
+               Sint32 y, Uint64 owner)
+{
+  const Sint32 cell = grid_index (grid, x, y);
+  const Sint32 slot = cell >= 0 ? acquire_slot (occupancy) : -1;
+  if (slot >= 0)
+    {
+      occupancy->occupants[slot].owner = owner;
+      link_occupant (occupancy, slot, cell);
+    }
+  return slot;
+}
+
+void
+occupancy_move (struct occupancy *occupancy, const struct grid *grid,
+                Sint32 slot, Sint32 x, Sint32 y)
+{
+  const Sint32 cell = grid_index (grid, x, y);
+  if (slot < 0 || occupancy->occupants[slot].cell < 0)
+    {
+      return;
+    }
+  if (cell < 0)
+    {
+      occupancy_remove (occupancy, slot);
+    }
+  else if (occupancy->occupants[slot].cell != cell)
+    {
+      unlink_occupant (occupancy, slot);
+      link_occupant (occupancy, slot, cell);
+    }
+}
+
+void
+occupancy_remove (struct occupancy *occupancy, Sint32 slot)
+{
+  if (slot < 0 || occupancy->occupants[slot].cell < 0)
+    {
+      return;
+    }
+  unlink_occupant (occupancy, slot);
+  occupancy->occupants[slot].cell = -1;
+  occupancy->occupants[slot].next = occupancy->free_slot;
+  occupancy->free_slot = slot;
+}
+
+Sint32
+occupancy_first (const struct occupancy *occupancy, const struct grid *grid,
+                 Sint32 x, Sint32 y)
+{
+  const Sint32 cell = grid_index (grid, x, y);
+  return cell >= 0 ? occupancy->heads[cell] : -1;
+}
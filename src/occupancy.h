@@ -0,0 +1,75 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Cell occupancy index: which characters stand on each cell. Every cell
+ *  heads a doubly linked list of its occupants, so adding, moving and
+ *  removing one is constant time, and listing a cell only touches the
+ *  characters on it. Occupants are referred to by their slot, which stays
+ *  the same until they are removed. Like the danger map, the index is
+ *  addressed with the dense cell indices of its grid. */
+
+#ifndef BOMBERMAN_OCCUPANCY_H
+#define BOMBERMAN_OCCUPANCY_H
+
+#include "SDL3/SDL.h"
+
+#include "grid.h"
+
+struct occupant
+{
+  Uint64 owner; /* What occupies the cell, an entity for the simulation. */
+  Sint32 cell;  /* Dense cell index, -1 while the slot is free. */
+  Sint32 prev;  /* Occupants of the same cell, -1 at either end. */
+  Sint32 next;  /* Also links the free slots. */
+};
+
+struct occupancy
+{
+  Sint32 *heads; /* First occupant of each cell, -1 if none. */
+  Sint32 cell_count;
+  struct occupant *occupants;
+  Sint32 occupant_count; /* Slots handed out so far, freed ones included. */
+  Sint32 occupant_capacity;
+  Sint32 free_slot; /* First free slot, -1 if none. */
+};
+
+/**
+ * Allocates an index over the stored cells of a grid, with no occupant. Any
+ * storage previously held by the index is released first.
+ * @return false if the allocation failed.
+ */
+bool occupancy_init (struct occupancy *occupancy, const struct grid *grid);
+void occupancy_free (struct occupancy *occupancy);
+
+/**
+ * Removes every occupant, keeping the storage.
+ */
+void occupancy_clear (struct occupancy *occupancy);
+
+/**
+ * Puts an occupant on a cell.
+ * @return its slot, or -1 if the cell is not stored or the occupant could
+ * not be.
+ */
+Sint32 occupancy_add (struct occupancy *occupancy, const struct grid *grid,
+                      Sint32 x, Sint32 y, Uint64 owner);
+
+/**
+ * Moves an occupant to another cell. One moved off the stored cells is
+ * removed. Removed occupants, and slot -1, are left alone.
+ */
+void occupancy_move (struct occupancy *occupancy, const struct grid *grid,
+                     Sint32 slot, Sint32 x, Sint32 y);
+
+/**
+ * Takes an occupant off its cell and frees its slot. Does nothing for a
+ * removed occupant or slot -1.
+ */
+void occupancy_remove (struct occupancy *occupancy, Sint32 slot);
+
+/**
+ * @return the slot of the first occupant of a cell, or -1 if it has none.
+ * The others follow through occupant.next.
+ */
+Sint32 occupancy_first (const struct occupancy *occupancy,
+                        const struct grid *grid, Sint32 x, Sint32 y);
+
+#endif /* BOMBERMAN_OCCUPANCY_H */
@@ -0,0 +1,75 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette */
+
+#include "offscreen.h"
+
+/* Game modules dependencies. */
+#include "input_man.h"
+
+void
+handle_key_press (struct input_man *input_man, SDL_Scancode key, void *param)
+{
+}
+void
+handle_key_release (struct input_man *input_man, SDL_Scancode key, void *param)
+{
+}
+void
+handle_key_hold (struct input_man *input_man, SDL_Scancode key, void *param)
+{
+}
+void
+handle_mouse_press (struct input_man *input_man, SDL_FPoint pos, Uint8 button,
+                    void *param)
+{
+}
+void
+handle_mouse_release (struct input_man *input_man, SDL_FPoint pos,
+                      Uint8 button, void *param)
+{
+}
+void
+handle_mouse_hold (struct input_man *input_man, SDL_FPoint pos, Uint8 button,
+                   void *param)
+{
+}
+void
+handle_mouse_motion (struct input_man *input_man, SDL_FPoint pos,
+                     SDL_FPoint rel, void *param)
+{
+}
+
+void
+init_offscreen_pluto (ecs_world_t *world, const struct grid *grid,
+                      const char *window_name)
+{
+  SDL_SetHint (SDL_HINT_VIDEO_DRIVER, "offscreen");
+  SDL_SetHint (SDL_HINT_RENDER_DRIVER, "software");
+
+  struct pluto_core_params params
+      = { .init_flags = SDL_INIT_VIDEO,
+          .initial_window_size = { .x = LOGIC_WIDTH, .y = LOGIC_HEIGHT },
+          .initial_logical_size = { .x = LOGIC_WIDTH, .y = LOGIC_HEIGHT },
+          .initial_layout_size
+          = { .x = grid->w * CELL_SIZE, .y = grid->h * CELL_SIZE },
+          .window_name = window_name,
+          .window_flags = SDL_WINDOW_HIDDEN,
+          .default_user_scaling = 1.f,
+          .renderer_blend_mode = SDL_BLENDMODE_BLEND,
+          .gpu_driver_hint = NULL,
+          .b_is_DPI_aware = false,
+          .b_should_debug_GPU = false,
+          .b_has_logical_size = false,
+          .logical_presentation_mode = SDL_LOGICAL_PRESENTATION_INTEGER_SCALE,
+          .input_data = { .b_is_resizing_widget = false,
+                          .b_is_dragging_widget = false,
+                          .b_is_moving_camera = false },
+          .initial_constant_scroll_speed = 1.f,
+          .initial_scroll_style = PLUTO_SCROLL_STYLE_CONSTANT,
+          .b_should_initially_clamp_scroll_x = true,
+          .b_should_initially_ignore_scroll_y = true,
+          .initial_scroll_poll_frequency_ms = 100u };
+  init_pluto (world, &params);
+
+  ecs_enable (world, EcsPreStore, false);
+  ecs_enable (world, EcsOnStore, false);
+}
@@ -0,0 +1,26 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Offscreen core shared by the executables that only run the simulation
+ *  (the headless runner and the benchmark). Pluto owns the registration of
+ *  the shared components (index_c, movement_c, ...) and their systems, so
+ *  its core still has to come up. The offscreen video driver and the
+ *  software renderer let it do so without a display or a GPU; the window is
+ *  never shown.
+ *
+ *  Linking this in also provides the input callbacks the input manager
+ *  expects from the executable. Nothing is ever pressed offscreen. */
+
+#ifndef BOMBERMAN_OFFSCREEN_H
+#define BOMBERMAN_OFFSCREEN_H
+
+#include "sim.h"
+
+/**
+ * Brings up the Pluto core on the offscreen driver, with a layout the size
+ * of the grid, then switches off the phases where the drawing systems live
+ * (no atlas and no render targets are loaded) so ecs_progress only runs the
+ * simulation. To be followed by init_sim.
+ */
+void init_offscreen_pluto (ecs_world_t *world, const struct grid *grid,
+                           const char *window_name);
+
+#endif /* BOMBERMAN_OFFSCREEN_H */
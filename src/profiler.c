@@ -0,0 +1,235 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette */
+
+#include "profiler.h"
+
+#include "flecs.h"
+
+struct profiler_event
+{
+  Uint64 ns;
+  const char *name; /* NULL when closing a zone. */
+};
+
+/* Ring of one thread, see PROFILER_THREAD_EVENTS. */
+struct profiler_thread
+{
+  SDL_ThreadID id;
+  Uint32 next;
+  bool b_has_wrapped;
+  struct profiler_event events[PROFILER_THREAD_EVENTS];
+};
+
+static struct
+{
+  bool b_is_enabled;
+  const char *trace_path;
+  Uint64 start_ns;
+  SDL_ThreadID main_thread;
+  SDL_TLSID tls;
+  SDL_Mutex *mutex; /* Guards the thread list. */
+  struct profiler_thread **threads;
+  Sint32 thread_count;
+  Sint32 thread_capacity;
+} profiler;
+
+static void
+trace_push (const char *filename, size_t line, const char *name)
+{
+  profiler_begin (name);
+}
+
+static void
+trace_pop (const char *filename, size_t line, const char *name)
+{
+  profiler_end ();
+}
+
+bool
+profiler_init (const char *trace_path)
+{
+  profiler_quit ();
+  profiler.mutex = SDL_CreateMutex ();
+  if (profiler.mutex == NULL)
+    {
+      return false;
+    }
+  profiler.trace_path = trace_path;
+  profiler.start_ns = SDL_GetTicksNS ();
+  profiler.main_thread = SDL_GetCurrentThreadID ();
+  profiler.b_is_enabled = true;
+
+  ecs_os_set_api_defaults ();
+  ecs_os_api_t api = ecs_os_api;
+  api.perf_trace_push_ = trace_push;
+  api.perf_trace_pop_ = trace_pop;
+  ecs_os_set_api (&api);
+  return true;
+}
+
+void
+profiler_quit (void)
+{
+  profiler.b_is_enabled = false;
+  for (Sint32 i = 0; i < profiler.thread_count; i++)
+    {
+      SDL_free (profiler.threads[i]);
+    }
+  SDL_free (profiler.threads);
+  SDL_DestroyMutex (profiler.mutex);
+  SDL_zero (profiler);
+}
+
+/**
+ * @return the ring of the calling thread, created on its first event, or
+ * NULL if it could not be.
+ */
+static struct profiler_thread *
+get_thread (void)
+{
+  struct profiler_thread *thread = SDL_GetTLS (&profiler.tls);
+  if (thread != NULL)
+    {
+      return thread;
+    }
+
+  SDL_LockMutex (profiler.mutex);
+  if (profiler.thread_count == profiler.thread_capacity)
+    {
+      const Sint32 capacity = SDL_max (profiler.thread_capacity * 2, 8);
+      struct profiler_thread **threads = SDL_realloc (
+          profiler.threads, (size_t)capacity * sizeof (*threads));
+      if (threads != NULL)
+        {
+          profiler.threads = threads;
+          profiler.thread_capacity = capacity;
+        }
+    }
+  if (profiler.thread_count < profiler.thread_capacity)
+    {
+      thread = SDL_calloc (1u, sizeof (*thread));
+    }
+  if (thread != NULL)
+    {
+      thread->id = SDL_GetCurrentThreadID ();
+      profiler.threads[profiler.thread_count++] = thread;
+      SDL_SetTLS (&profiler.tls, thread, NULL);
+    }
+  SDL_UnlockMutex (profiler.mutex);
+  return thread;
+}
+
+static void
+record (const char *name)
+{
+  struct profiler_thread *thread = get_thread ();
+  if (thread == NULL)
+    {
+      return;
+    }
+  thread->events[thread->next]
+      = (struct profiler_event){ .ns = SDL_GetTicksNS (), .name = name };
+  thread->next = (thread->next + 1u) % PROFILER_THREAD_EVENTS;
+  thread->b_has_wrapped = thread->b_has_wrapped || thread->next == 0u;
+}
+
+void
+profiler_begin (const char *name)
+{
+  if (profiler.b_is_enabled == true)
+    {
+      record (name != NULL ? name : "?");
+    }
+}
+
+void
+profiler_end (void)
+{
+  if (profiler.b_is_enabled == true)
+    {
+      record (NULL);
+    }
+}
+
+/* Zone names are code identifiers, anything a JSON string cannot hold as
+ * is gets replaced. */
+static void
+write_name (SDL_IOStream *io, const char *name)
+{
+  char escaped[128];
+  size_t length = 0u;
+  for (; name[length] != '\0' && length < sizeof (escaped) - 1u; length++)
+    {
+      const char c = name[length];
+      escaped[length] = c == '"' || c == '\\' || (Uint8)c < 0x20u ? '_' : c;
+    }
+  escaped[length] = '\0';
+  SDL_IOprintf (io, "\"name\":\"%s\"", escaped);
+}
+
+/**
+ * Writes the events of one thread, oldest first. Once the ring wrapped, the
+ * ends of the zones whose start was overwritten are left out.
+ */
+static void
+write_thread (SDL_IOStream *io, const struct profiler_thread *thread,
+              Sint32 tid, bool *b_is_first)
+{
+  const Uint32 first = thread->b_has_wrapped == true ? thread->next : 0u;
+  const Uint32 count
+      = thread->b_has_wrapped == true ? PROFILER_THREAD_EVENTS : thread->next;
+  Sint32 depth = 0;
+  for (Uint32 i = 0u; i < count; i++)
+    {
+      const struct profiler_event *event
+          = &thread->events[(first + i) % PROFILER_THREAD_EVENTS];
+      if (event->name == NULL && depth == 0)
+        {
+          continue;
+        }
+      depth += event->name != NULL ? 1 : -1;
+
+      SDL_IOprintf (io, "%s\n{", *b_is_first == true ? "" : ",");
+      *b_is_first = false;
+      if (event->name != NULL)
+        {
+          write_name (io, event->name);
+          SDL_IOprintf (io, ",");
+        }
+      SDL_IOprintf (io, "\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                    event->name != NULL ? 'B' : 'E',
+                    (double)(event->ns - profiler.start_ns) / 1e3, tid);
+    }
+}
+
+bool
+profiler_write (void)
+{
+  if (profiler.b_is_enabled == false)
+    {
+      return false;
+    }
+  SDL_IOStream *io = SDL_IOFromFile (profiler.trace_path, "w");
+  if (io == NULL)
+    {
+      return false;
+    }
+
+  SDL_LockMutex (profiler.mutex);
+  SDL_IOprintf (io, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  bool b_is_first = true;
+  for (Sint32 i = 0; i < profiler.thread_count; i++)
+    {
+      const struct profiler_thread *thread = profiler.threads[i];
+      SDL_IOprintf (io,
+                    "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                    "\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+                    b_is_first == true ? "" : ",", i,
+                    thread->id == profiler.main_thread ? "main" : "worker",
+                    i);
+      b_is_first = false;
+      write_thread (io, thread, i, &b_is_first);
+    }
+  SDL_IOprintf (io, "\n]}\n");
+  SDL_UnlockMutex (profiler.mutex);
+  return SDL_CloseIO (io);
+}
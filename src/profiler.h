@@ -0,0 +1,48 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Tick profiler: named zones timed on every thread, written out as a
+ *  Chrome trace (chrome://tracing or ui.perfetto.dev) to see where a bad
+ *  frame went. Zones are opened and closed in pairs by profiler_begin and
+ *  profiler_end, and nest as the calls do. The flecs systems run by
+ *  ecs_progress get a zone each through the perf trace hooks of the flecs OS
+ *  API, flecs being built with FLECS_PERF_TRACE.
+ *
+ *  Each thread records into a ring of its own, without locking, which keeps
+ *  its last PROFILER_THREAD_EVENTS events: some twenty seconds of play.
+ *  While the profiler is off, a zone costs the test of a flag. */
+
+#ifndef BOMBERMAN_PROFILER_H
+#define BOMBERMAN_PROFILER_H
+
+#include "SDL3/SDL.h"
+
+#define PROFILER_THREAD_EVENTS (1 << 17)
+
+/**
+ * Turns the profiler on. Has to come before ecs_init for the flecs systems
+ * to be zoned.
+ * @param trace_path Where profiler_write puts the trace.
+ * @return false if it could not be set up, the profiler stays off.
+ */
+bool profiler_init (const char *trace_path);
+void profiler_quit (void);
+
+/**
+ * Opens a zone on the calling thread.
+ * @param name Kept as is until the trace is written, typically a literal.
+ */
+void profiler_begin (const char *name);
+
+/**
+ * Closes the last zone opened on the calling thread.
+ */
+void profiler_end (void);
+
+/**
+ * Writes the events still in the rings as a Chrome trace. Meant to be
+ * called between two frames, while the other threads are idle, and before
+ * the world goes away as the system zones are named by their systems.
+ * @return false if the profiler is off or the file could not be written.
+ */
+bool profiler_write (void);
+
+#endif /* BOMBERMAN_PROFILER_H */
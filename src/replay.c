@@ -0,0 +1,337 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Replay files, all integers little-endian:
+ *    header  uint32 REPLAY_MAGIC, uint32 REPLAY_VERSION, uint64 seed,
+ *            uint8 player count, uint32 map checksum, uint16 map path
+ *            length, map path
+ *    runs    LEB128 varint tick count (never 0), one input per player, held
+ *            for that many ticks
+ *    end     varint 0, uint8 whether a state hash follows, uint64 tick
+ *            count, uint64 state hash
+ *  The end is missing when the recording did not close. */
+
+#include "replay.h"
+
+#define REPLAY_MAGIC 0x50524D42u /* "BMRP" */
+#define REPLAY_HEADER_SIZE 23
+#define REPLAY_END_SIZE 17
+#define REPLAY_MAX_TICKS (1ull << 26) /* Over 12 days at 60 per second. */
+#define FNV_PRIME 0x100000001B3ull
+
+static Uint8 *
+write_u16 (Uint8 *out, Uint16 value)
+{
+  value = SDL_Swap16LE (value);
+  SDL_memcpy (out, &value, sizeof (value));
+  return out + sizeof (value);
+}
+
+static Uint8 *
+write_u32 (Uint8 *out, Uint32 value)
+{
+  value = SDL_Swap32LE (value);
+  SDL_memcpy (out, &value, sizeof (value));
+  return out + sizeof (value);
+}
+
+static Uint8 *
+write_u64 (Uint8 *out, Uint64 value)
+{
+  value = SDL_Swap64LE (value);
+  SDL_memcpy (out, &value, sizeof (value));
+  return out + sizeof (value);
+}
+
+static Uint8 *
+write_varint (Uint8 *out, Uint64 value)
+{
+  while (value >= 0x80u)
+    {
+      *out++ = (Uint8)(value | 0x80u);
+      value >>= 7;
+    }
+  *out++ = (Uint8)value;
+  return out;
+}
+
+static Uint16
+read_u16 (const Uint8 *in)
+{
+  Uint16 value = 0u;
+  SDL_memcpy (&value, in, sizeof (value));
+  return SDL_Swap16LE (value);
+}
+
+static Uint32
+read_u32 (const Uint8 *in)
+{
+  Uint32 value = 0u;
+  SDL_memcpy (&value, in, sizeof (value));
+  return SDL_Swap32LE (value);
+}
+
+static Uint64
+read_u64 (const Uint8 *in)
+{
+  Uint64 value = 0u;
+  SDL_memcpy (&value, in, sizeof (value));
+  return SDL_Swap64LE (value);
+}
+
+/**
+ * @return the byte after the varint, or NULL if it runs past end.
+ */
+static const Uint8 *
+read_varint (const Uint8 *in, const Uint8 *end, Uint64 *value)
+{
+  Uint64 result = 0u;
+  for (Sint32 shift = 0; in < end && shift < 64; shift += 7)
+    {
+      const Uint8 byte = *in++;
+      result |= (Uint64)(byte & 0x7Fu) << shift;
+      if ((byte & 0x80u) == 0u)
+        {
+          *value = result;
+          return in;
+        }
+    }
+  return NULL;
+}
+
+Uint64
+replay_hash (Uint64 hash, const void *data, size_t size)
+{
+  const Uint8 *bytes = data;
+  for (size_t i = 0u; i < size; i++)
+    {
+      hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+  return hash;
+}
+
+Uint32
+replay_map_checksum (const struct grid *grid)
+{
+  Uint64 hash = replay_hash (REPLAY_HASH_INIT, &grid->w, sizeof (grid->w));
+  hash = replay_hash (hash, &grid->h, sizeof (grid->h));
+  for (Sint32 chunk = 0; chunk < grid->chunks_w * grid->chunks_h; chunk++)
+    {
+      const Sint32 slot = grid->chunks[chunk];
+      if (slot >= 0)
+        {
+          hash = replay_hash (hash, &chunk, sizeof (chunk));
+          hash = replay_hash (hash,
+                              grid->cells + (size_t)slot * GRID_CHUNK_CELLS,
+                              GRID_CHUNK_CELLS);
+        }
+    }
+  return (Uint32)(hash ^ (hash >> 32));
+}
+
+bool
+replay_record_open (struct replay_recorder *recorder, const char *path,
+                    Uint64 seed, const char *map_path,
+                    const struct grid *grid, Sint32 player_count)
+{
+  SDL_zerop (recorder);
+  const size_t path_length = SDL_strlen (map_path);
+  if (player_count < 1 || player_count > REPLAY_MAX_PLAYERS
+      || path_length > SDL_MAX_UINT16)
+    {
+      return false;
+    }
+
+  Uint8 header[REPLAY_HEADER_SIZE];
+  Uint8 *cursor = write_u32 (header, REPLAY_MAGIC);
+  cursor = write_u32 (cursor, REPLAY_VERSION);
+  cursor = write_u64 (cursor, seed);
+  *cursor++ = (Uint8)player_count;
+  cursor = write_u32 (cursor, replay_map_checksum (grid));
+  cursor = write_u16 (cursor, (Uint16)path_length);
+
+  recorder->io = SDL_IOFromFile (path, "wb");
+  if (recorder->io == NULL)
+    {
+      return false;
+    }
+  if (SDL_WriteIO (recorder->io, header, sizeof (header)) != sizeof (header)
+      || SDL_WriteIO (recorder->io, map_path, path_length) != path_length)
+    {
+      SDL_CloseIO (recorder->io);
+      recorder->io = NULL;
+      return false;
+    }
+  recorder->player_count = player_count;
+  return true;
+}
+
+/* Writes the current run out, if any. */
+static bool
+write_run (struct replay_recorder *recorder)
+{
+  if (recorder->run == 0u)
+    {
+      return true;
+    }
+  Uint8 data[10 + REPLAY_MAX_PLAYERS];
+  Uint8 *cursor = write_varint (data, recorder->run);
+  SDL_memcpy (cursor, recorder->inputs, (size_t)recorder->player_count);
+  cursor += recorder->player_count;
+  recorder->run = 0u;
+  const size_t size = (size_t)(cursor - data);
+  return SDL_WriteIO (recorder->io, data, size) == size;
+}
+
+void
+replay_record_tick (struct replay_recorder *recorder, const Uint8 *inputs)
+{
+  if (recorder->io == NULL)
+    {
+      return;
+    }
+
+  if (recorder->run == 0u
+      || SDL_memcmp (recorder->inputs, inputs,
+                     (size_t)recorder->player_count)
+             != 0)
+    {
+      write_run (recorder);
+      SDL_memcpy (recorder->inputs, inputs, (size_t)recorder->player_count);
+    }
+  recorder->run++;
+  recorder->ticks++;
+  if (recorder->ticks % REPLAY_FLUSH_TICKS == 0u)
+    {
+      SDL_FlushIO (recorder->io);
+    }
+}
+
+bool
+replay_record_close (struct replay_recorder *recorder,
+                     const Uint64 *state_hash)
+{
+  if (recorder->io == NULL)
+    {
+      return true;
+    }
+
+  Uint8 end[1 + REPLAY_END_SIZE];
+  Uint8 *cursor = write_varint (end, 0u);
+  *cursor++ = state_hash != NULL ? 1u : 0u;
+  cursor = write_u64 (cursor, recorder->ticks);
+  cursor = write_u64 (cursor, state_hash != NULL ? *state_hash : 0u);
+  bool b_is_written = write_run (recorder)
+                      && SDL_WriteIO (recorder->io, end, sizeof (end))
+                             == sizeof (end);
+  b_is_written = SDL_CloseIO (recorder->io) && b_is_written;
+  recorder->io = NULL;
+  return b_is_written;
+}
+
+void
+replay_free (struct replay *replay)
+{
+  SDL_free (replay->map_path);
+  SDL_free (replay->inputs);
+  SDL_zerop (replay);
+}
+
+/**
+ * Walks the runs, counting their ticks, and copies their inputs into out if
+ * it is not NULL. Stops at the end marker, at the first truncated run, or
+ * past REPLAY_MAX_TICKS.
+ * @return the byte after the last run read.
+ */
+static const Uint8 *
+read_runs (const Uint8 *cursor, const Uint8 *end, Sint32 player_count,
+           Uint64 *tick_count, Uint8 *out)
+{
+  Uint64 ticks = 0u;
+  while (cursor < end)
+    {
+      Uint64 run = 0u;
+      const Uint8 *inputs = read_varint (cursor, end, &run);
+      if (inputs == NULL || run == 0u
+          || (size_t)(end - inputs) < (size_t)player_count
+          || run > REPLAY_MAX_TICKS - ticks)
+        {
+          break;
+        }
+      if (out != NULL)
+        {
+          for (Uint64 tick = ticks; tick < ticks + run; tick++)
+            {
+              SDL_memcpy (out + tick * (Uint64)player_count, inputs,
+                          (size_t)player_count);
+            }
+        }
+      ticks += run;
+      cursor = inputs + player_count;
+    }
+  *tick_count = ticks;
+  return cursor;
+}
+
+bool
+replay_load (const char *path, struct replay *replay)
+{
+  replay_free (replay);
+
+  size_t size = 0u;
+  Uint8 *data = SDL_LoadFile (path, &size);
+  if (data == NULL)
+    {
+      return false;
+    }
+
+  const Uint8 *end = data + size;
+  const size_t path_length
+      = size >= REPLAY_HEADER_SIZE ? read_u16 (data + 21) : 0u;
+  bool b_is_valid = size >= REPLAY_HEADER_SIZE
+                    && read_u32 (data) == REPLAY_MAGIC
+                    && read_u32 (data + 4) == REPLAY_VERSION
+                    && data[16] >= 1 && data[16] <= REPLAY_MAX_PLAYERS
+                    && size - REPLAY_HEADER_SIZE >= path_length;
+  if (b_is_valid == true)
+    {
+      replay->seed = read_u64 (data + 8);
+      replay->player_count = data[16];
+      replay->map_checksum = read_u32 (data + 17);
+      replay->map_path = SDL_malloc (path_length + 1u);
+      b_is_valid = replay->map_path != NULL;
+    }
+
+  const Uint8 *runs = data + REPLAY_HEADER_SIZE + path_length;
+  if (b_is_valid == true)
+    {
+      SDL_memcpy (replay->map_path, data + REPLAY_HEADER_SIZE, path_length);
+      replay->map_path[path_length] = '\0';
+
+      read_runs (runs, end, replay->player_count, &replay->tick_count, NULL);
+      replay->inputs
+          = SDL_malloc (SDL_max (replay->tick_count, (Uint64)1u)
+                        * (Uint64)replay->player_count);
+      b_is_valid = replay->inputs != NULL;
+    }
+
+  if (b_is_valid == true)
+    {
+      const Uint8 *cursor = read_runs (runs, end, replay->player_count,
+                                       &replay->tick_count, replay->inputs);
+      Uint64 marker = 1u;
+      const Uint8 *tail = read_varint (cursor, end, &marker);
+      if (tail != NULL && marker == 0u
+          && (size_t)(end - tail) >= REPLAY_END_SIZE
+          && read_u64 (tail + 1) == replay->tick_count)
+        {
+          replay->b_has_state_hash = tail[0] != 0u;
+          replay->state_hash = read_u64 (tail + 9);
+        }
+    }
+
+  SDL_free (data);
+  if (b_is_valid == false)
+    {
+      replay_free (replay);
+    }
+  return b_is_valid;
+}
@@ -0,0 +1,90 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Replays: a match as its seed, its map and the input of every player on
+ *  every tick (see sim_input_bits). The simulation is deterministic, so this
+ *  is enough to play the match again, bit for bit. Recording streams the
+ *  inputs to the file as the match goes, a crash still leaves a replay of
+ *  all but the last few seconds. A cleanly closed replay also ends with a
+ *  hash of the final state, which playback checks.
+ *
+ *  Replays are played back by bomberman_headless, as fast as it can. */
+
+#ifndef BOMBERMAN_REPLAY_H
+#define BOMBERMAN_REPLAY_H
+
+#include "SDL3/SDL.h"
+
+#include "grid.h"
+
+#define REPLAY_VERSION 1u
+#define REPLAY_MAX_PLAYERS 4
+#define REPLAY_FLUSH_TICKS 600 /* Ticks between two writes to the file. */
+#define REPLAY_HASH_INIT 0xCBF29CE484222325ull
+
+struct replay_recorder
+{
+  SDL_IOStream *io;
+  Sint32 player_count;
+  Uint8 inputs[REPLAY_MAX_PLAYERS]; /* Inputs of the current run. */
+  Uint64 run;                       /* Ticks the current run lasted. */
+  Uint64 ticks;
+};
+
+struct replay
+{
+  Uint64 seed;
+  Sint32 player_count;
+  char *map_path;
+  Uint32 map_checksum; /* See replay_map_checksum. */
+  Uint8 *inputs;       /* player_count inputs per tick. */
+  Uint64 tick_count;
+  bool b_has_state_hash; /* Whether the recording was closed with a hash. */
+  Uint64 state_hash;     /* See hash_sim. */
+};
+
+/**
+ * @return a checksum of the cells of a map, telling apart maps of the same
+ * name which changed since a replay was recorded.
+ */
+Uint32 replay_map_checksum (const struct grid *grid);
+
+/**
+ * Extends a hash, starting from REPLAY_HASH_INIT, with size bytes of data
+ * (64-bit FNV-1a).
+ */
+Uint64 replay_hash (Uint64 hash, const void *data, size_t size);
+
+/**
+ * Creates the replay file and writes its header. The map is the one the
+ * match starts with.
+ * @return false if the file could not be written.
+ */
+bool replay_record_open (struct replay_recorder *recorder, const char *path,
+                         Uint64 seed, const char *map_path,
+                         const struct grid *grid, Sint32 player_count);
+
+/**
+ * Appends the inputs of the next tick, one per player.
+ */
+void replay_record_tick (struct replay_recorder *recorder,
+                         const Uint8 *inputs);
+
+/**
+ * Writes what is left and closes the file. Does nothing if the recorder is
+ * not open.
+ * @param state_hash Hash of the state after the last tick, see hash_sim, or
+ * NULL to leave it out.
+ * @return false if the file could not be written.
+ */
+bool replay_record_close (struct replay_recorder *recorder,
+                          const Uint64 *state_hash);
+
+/**
+ * Reads a whole replay in one go. A replay cut short by a crash loads up to
+ * its last complete run.
+ * @return false if the file could not be read or is not a replay of this
+ * version.
+ */
+bool replay_load (const char *path, struct replay *replay);
+void replay_free (struct replay *replay);
+
+#endif /* BOMBERMAN_REPLAY_H */
@@ -0,0 +1,47 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Counter-based random numbers. */
+
+#include "rng.h"
+
+/* SplitMix64 finaliser. */
+static Uint64
+mix (Uint64 x)
+{
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9u;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBu;
+  x ^= x >> 31;
+  return x;
+}
+
+Uint64
+rng_at (Uint64 seed, Uint64 stream, Uint64 counter)
+{
+  const Uint64 key = mix (seed + stream * 0x9E3779B97F4A7C15u);
+  return mix (key ^ (counter * 0xD1B54A32D192ED03u + 0x8CB92BA72F3D8DD7u));
+}
+
+void
+rng_fill (Uint64 seed, Uint64 counter, const Uint64 *streams, Uint64 *out,
+          size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+    {
+      out[i] = rng_at (seed, streams[i], counter);
+    }
+}
+
+void
+rng_stream_init (struct rng_stream *rng, Uint64 seed, Uint64 stream)
+{
+  rng->seed = seed;
+  rng->stream = stream;
+  rng->counter = 0u;
+}
+
+Uint64
+rng_stream_next (struct rng_stream *rng)
+{
+  return rng_at (rng->seed, rng->stream, rng->counter++);
+}
@@ -0,0 +1,40 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Counter-based random numbers. A value is a pure function of the match
+ *  seed, a stream id (typically an entity) and a counter (typically the
+ *  tick), so every entity gets an independent stream which needs no state,
+ *  can be evaluated from any thread, and replays bit for bit. */
+
+#ifndef BOMBERMAN_RNG_H
+#define BOMBERMAN_RNG_H
+
+#include "SDL3/SDL.h"
+
+/* Sequential draws from one stream. */
+struct rng_stream
+{
+  Uint64 seed;
+  Uint64 stream;
+  Uint64 counter;
+};
+
+Uint64 rng_at (Uint64 seed, Uint64 stream, Uint64 counter);
+
+/**
+ * Batch form of rng_at: out[i] = rng_at (seed, streams[i], counter).
+ */
+void rng_fill (Uint64 seed, Uint64 counter, const Uint64 *streams,
+               Uint64 *out, size_t count);
+
+void rng_stream_init (struct rng_stream *rng, Uint64 seed, Uint64 stream);
+Uint64 rng_stream_next (struct rng_stream *rng);
+
+/**
+ * @return a value in [0, bound), bound being at most 2^32.
+ */
+static inline Uint32
+rng_bounded (Uint64 value, Uint32 bound)
+{
+  return (Uint32)(((value >> 32) * (Uint64)bound) >> 32);
+}
+
+#endif /* BOMBERMAN_RNG_H */
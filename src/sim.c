@@ -0,0 +1,1847 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Created in February 2025. */
+
+/* Simulation side of the game: components, prefabs, map loading and the
+ * per-tick rules. Nothing in here touches the window, the renderer or the
+ * sprite atlas, so it can run headless. */
+
+#include "sim.h"
+#include "grid.h"
+
+/* Game modules dependencies. */
+#include "log.h"
+
+ECS_COMPONENT_DECLARE (game_s);
+
+ECS_COMPONENT_DECLARE (bomb_storage_c);
+ECS_COMPONENT_DECLARE (brain_c);
+ECS_COMPONENT_DECLARE (cell_data_c);
+ECS_COMPONENT_DECLARE (controller_c);
+ECS_COMPONENT_DECLARE (glide_c);
+ECS_COMPONENT_DECLARE (lifetime_c);
+ECS_COMPONENT_DECLARE (occupant_c);
+ECS_COMPONENT_DECLARE (tilemap_c);
+
+/* Game-specific hooks */
+
+static void
+brain (void *ptr, Sint32 count, const ecs_type_info_t *type_info)
+{
+  brain_c *brain = ptr;
+  for (Sint32 i = 0; i < count; i++)
+    {
+      brain[i].b_is_active = true;
+      brain[i].stream = 0u;
+    }
+}
+
+static void
+cell_data (void *ptr, Sint32 count, const ecs_type_info_t *type_info)
+{
+  cell_data_c *cell_data = ptr;
+  for (Sint32 i = 0; i < count; i++)
+    {
+      cell_data[i].b_is_blocked = false;
+      cell_data[i].b_has_bomb = false;
+      cell_data[i].b_has_explosion = false;
+    }
+}
+
+static void
+controller (void *ptr, Sint32 count, const ecs_type_info_t *type_info)
+{
+  controller_c *controller = ptr;
+  for (Sint32 i = 0; i < count; i++)
+    {
+      controller[i].control_delta = (SDL_Point){ .x = 0, .y = 0 };
+      controller[i].b_is_placing_bomb = false;
+      controller[i].pawn = 0u;
+    }
+}
+
+static void
+lifetime (void *ptr, Sint32 count, const ecs_type_info_t *type_info)
+{
+  lifetime_c *lifetime = ptr;
+  for (Sint32 i = 0; i < count; i++)
+    {
+      lifetime[i].duration = 500u;
+      lifetime[i].timer = 0u;
+      lifetime[i].pool = SIM_POOL_NONE;
+      lifetime[i].on_delete_callback = NULL;
+    }
+}
+
+/* Game-specific systems. */
+
+/**
+ * Hands a pooled grid object back to its pool, instead of deleting it.
+ */
+static void
+recycle_entity (ecs_world_t *world, game_s *game, ecs_entity_t ent,
+                Sint8 pool)
+{
+  ecs_remove_pair (world, ent, game->handles.instigator, EcsWildcard);
+  entity_pool_release (world, &game->pools[pool], ent);
+}
+
+/**
+ * Advances the lifetime wheel by one tick and ends whatever expires on it,
+ * in the order the lifetimes were started.
+ */
+static void
+system_lifetime_progress (ecs_iter_t *it)
+{
+  game_s *game = ecs_get_mut (it->world, ecs_id (game_s), game_s);
+
+  size_t count = 0u;
+  const Uint64 *expired = timing_wheel_advance (&game->timers, &count);
+  for (size_t i = 0; i < count; i++)
+    {
+      const ecs_entity_t ent = expired[i];
+      if (ecs_is_alive (it->world, ent) == false)
+        {
+          continue;
+        }
+
+      const lifetime_c *lifetime = ecs_get (it->world, ent, lifetime_c);
+      const Sint8 pool = lifetime->pool;
+      if (lifetime->on_delete_callback != NULL)
+        {
+          lifetime->on_delete_callback (it->world, ent);
+        }
+      if (pool != SIM_POOL_NONE)
+        {
+          recycle_entity (it->world, game, ent, pool);
+        }
+      else
+        {
+          ecs_delete (it->world, ent);
+        }
+    }
+}
+
+/* */
+
+/**
+ * Files the expiry of a freshly created entity holding a lifetime_c.
+ * @return the tick the entity expires on.
+ */
+static Uint64
+start_lifetime (ecs_world_t *world, game_s *game, ecs_entity_t ent)
+{
+  lifetime_c *lifetime = ecs_get_mut (world, ent, lifetime_c);
+  const Uint64 expiry
+      = game->timers.now + SDL_max (lifetime->duration, (Uint32)1u);
+  lifetime->timer = timing_wheel_schedule (&game->timers, expiry, ent);
+  return expiry;
+}
+
+/**
+ * Copies the grid flags of a cell onto its cell entity, when the optional
+ * entity-per-cell mirror is enabled. Call after writing to the grid.
+ */
+static void
+sync_cell_entity (ecs_world_t *world, const game_s *game, Sint32 x, Sint32 y)
+{
+  if (game->b_has_cell_entities == false)
+    {
+      return;
+    }
+
+  ecs_entity_t cell = *arr_entity_get (*mat2d_entity_get (game->cells, y), x);
+  cell_data_c *cell_data = ecs_get_mut (world, cell, cell_data_c);
+  cell_data->b_is_blocked = grid_has (&game->grid, x, y, GRID_CELL_BLOCKED);
+  cell_data->b_has_bomb = grid_has (&game->grid, x, y, GRID_CELL_BOMB);
+  cell_data->b_has_explosion
+      = grid_has (&game->grid, x, y, GRID_CELL_EXPLOSION);
+}
+
+/**
+ * Blows a rock up: its cell opens to blasts, characters and the chase field,
+ * and its tile is painted again as a bare floor. The danger map is left to
+ * the caller, see danger_map_refresh.
+ */
+static void
+remove_rock (ecs_world_t *world, game_s *game, Sint32 x, Sint32 y)
+{
+  if (grid_has (&game->grid, x, y, GRID_CELL_ROCK) == false)
+    {
+      return;
+    }
+
+  grid_clear (&game->grid, x, y, GRID_CELL_ROCK | GRID_CELL_BLOCKED);
+  blast_board_set_blocked (&game->blast, x, y, false);
+  flow_field_set_blocked (&game->chase, &game->grid, x, y, false);
+  sync_cell_entity (world, game, x, y);
+  tilemap_c *tilemap = ecs_get_mut (world, ecs_id (tilemap_c), tilemap_c);
+  tilemap_set (&tilemap->map, grid_index (&game->grid, x, y), TILE_FLOOR);
+}
+
+static bool
+is_pawn_alive (ecs_world_t *world, ecs_entity_t pawn)
+{
+  return pawn != 0u && ecs_is_alive (world, pawn) == true
+         && ecs_has_id (world, pawn, EcsDisabled) == false;
+}
+
+/**
+ * Kills a character. They are disabled rather than deleted, so restore_sim
+ * can bring them back.
+ */
+static void
+kill_character (ecs_world_t *world, game_s *game, ecs_entity_t ent)
+{
+  occupant_c *occupant = ecs_get_mut (world, ent, occupant_c);
+  occupancy_remove (&game->occupancy, occupant->slot);
+  occupant->slot = -1;
+  ecs_enable (world, ent, false);
+}
+
+/**
+ * Kills the characters standing on a cell, which just caught fire.
+ */
+static void
+kill_occupants (ecs_world_t *world, game_s *game, Sint32 x, Sint32 y)
+{
+  Sint32 slot = occupancy_first (&game->occupancy, &game->grid, x, y);
+  while (slot >= 0)
+    {
+      const struct occupant *occupant = &game->occupancy.occupants[slot];
+      const Sint32 next = occupant->next;
+      kill_character (world, game, occupant->owner);
+      slot = next;
+    }
+}
+
+/**
+ * Enters a character into the occupancy index, on the cell of its index_c.
+ */
+static void
+track_character (ecs_world_t *world, game_s *game, ecs_entity_t ent)
+{
+  const index_c *index = ecs_get (world, ent, index_c);
+  const occupant_c occupant = { .slot = occupancy_add (
+                                    &game->occupancy, &game->grid, index->x,
+                                    index->y, ent) };
+  ecs_set_ptr (world, ent, occupant_c, &occupant);
+}
+
+static bool
+can_character_move (ecs_world_t *world, ecs_entity_t ent, SDL_Point dir)
+{
+  const game_s *game = ecs_singleton_get (world, game_s);
+  const index_c *index = ecs_get (world, ent, index_c);
+  const Sint32 x = index->x + dir.x;
+  const Sint32 y = index->y + dir.y;
+  if (grid_contains (&game->grid, x, y) == false
+      || grid_has (&game->grid, x, y, GRID_CELL_BLOCKED) == true)
+    {
+      return false;
+    }
+
+  movement_c *movement = ecs_get_mut (world, ent, movement_c);
+  if (movement->cooldown > 0)
+    {
+      movement->cooldown--;
+      return false;
+    }
+
+  return true;
+}
+
+/**
+ * Starts moving a pawn by one cell, if the target cell is free and its
+ * movement cooldown is over. The pawn occupies the target cell from then
+ * on, and dies right away if it is on fire.
+ */
+static void
+try_move_pawn (ecs_world_t *world, ecs_entity_t pawn, SDL_Point delta)
+{
+  if (delta.x == 0 && delta.y == 0)
+    {
+      return;
+    }
+
+  if (can_character_move (world, pawn, delta) == true)
+    {
+      movement_c *movement = ecs_get_mut (world, pawn, movement_c);
+
+      movement->delta.x = delta.x;
+      movement->delta.y = delta.y;
+
+      movement->cooldown = movement->default_cooldown;
+      ecs_modified (world, pawn, movement_c);
+
+      game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+      const index_c *index = ecs_get (world, pawn, index_c);
+      const Sint32 x = index->x + delta.x;
+      const Sint32 y = index->y + delta.y;
+      /* The next step comes once the cooldown ran out, a tick later. */
+      const glide_c glide
+          = { .from = { index->x, index->y },
+              .start = game->timers.now,
+              .duration = movement->default_cooldown + 1u };
+      ecs_set_ptr (world, pawn, glide_c, &glide);
+      occupancy_move (&game->occupancy, &game->grid,
+                      ecs_get (world, pawn, occupant_c)->slot, x, y);
+      if (grid_has (&game->grid, x, y, GRID_CELL_EXPLOSION) == true)
+        {
+          kill_character (world, game, pawn);
+        }
+    }
+}
+
+/**
+ *
+ * @param world
+ * @param ent Player controller or AI entity (expected to have a controller
+ * component).
+ */
+void
+try_move_character (ecs_world_t *world, ecs_entity_t ent)
+{
+  const controller_c *controller = ecs_get (world, ent, controller_c);
+  if (is_pawn_alive (world, controller->pawn) == false)
+    {
+      return;
+    }
+  try_move_pawn (world, controller->pawn, controller->control_delta);
+}
+
+/* State shared by the brain workers during one evaluation. */
+struct brain_job
+{
+  struct brain_intent *intents;
+  const struct grid *grid;
+  const struct flow_field *chase;
+  const struct danger_map *danger;
+  Uint64 seed;
+  Uint64 tick;
+};
+
+/**
+ * Whether a brain may step from its cell by delta without walking into a
+ * blast due within BRAIN_DANGER_HORIZON ticks.
+ */
+static bool
+is_step_safe (const struct brain_job *job, const struct brain_intent *intent,
+              SDL_Point delta)
+{
+  /* Cells off the map read as safe, the move is refused anyway. */
+  return danger_map_ticks_left (job->danger, job->grid,
+                                intent->cell.x + delta.x,
+                                intent->cell.y + delta.y, job->tick)
+         > BRAIN_DANGER_HORIZON;
+}
+
+/**
+ * Job body: decides the move of each brain in [begin, end) and writes it
+ * into that brain's own intent slot. Brains follow the chase field towards
+ * the closest bomber and wander at random when none can be reached, and
+ * hold still rather than step into a blast about to go off. Runs on the
+ * worker threads, so it must not touch the ECS world.
+ */
+static void
+evaluate_brains (void *ctx, size_t begin, size_t end)
+{
+  static const SDL_Point directions[4]
+      = { { 0, -1 }, { -1, 0 }, { 0, 1 }, { 1, 0 } };
+
+  struct brain_job *job = ctx;
+  Uint64 streams[BRAIN_JOB_CHUNK];
+  Uint64 rolls[BRAIN_JOB_CHUNK];
+
+  profiler_begin ("evaluate_brains");
+
+  while (begin < end)
+    {
+      const size_t count = SDL_min (end - begin, (size_t)BRAIN_JOB_CHUNK);
+      for (size_t i = 0; i < count; i++)
+        {
+          streams[i] = job->intents[begin + i].stream;
+        }
+      rng_fill (job->seed, job->tick, streams, rolls, count);
+
+      for (size_t i = 0; i < count; i++)
+        {
+          struct brain_intent *intent = &job->intents[begin + i];
+          intent->delta
+              = flow_field_step (job->chase, job->grid, intent->cell.x,
+                                 intent->cell.y);
+          if ((intent->delta.x == 0 && intent->delta.y == 0)
+              || is_step_safe (job, intent, intent->delta) == false)
+            {
+              intent->delta = directions[rng_bounded (rolls[i], 4u)];
+            }
+          if (is_step_safe (job, intent, intent->delta) == false)
+            {
+              intent->delta = (SDL_Point){ 0, 0 };
+            }
+        }
+      begin += count;
+    }
+  profiler_end ();
+}
+
+/**
+ * Moves the sources of the chase field onto the cells the bombers stand on.
+ * Only the part of the field closer to a bomber's new cell than to its old
+ * one gets updated.
+ */
+static void
+update_chase_field (ecs_world_t *world, game_s *game)
+{
+  arr_cell_reset (game->chase_sources);
+  ecs_iter_t it = ecs_query_iter (world, game->handles.all_bombers);
+  while (ecs_query_next (&it))
+    {
+      const index_c *index = ecs_field (&it, index_c, 1);
+      for (Sint32 i = 0; i < it.count; i++)
+        {
+          const Sint32 cell = grid_index (&game->grid, index[i].x, index[i].y);
+          if (cell >= 0)
+            {
+              arr_cell_push_back (game->chase_sources, cell);
+            }
+        }
+    }
+
+  const Sint32 count = (Sint32)arr_cell_size (game->chase_sources);
+  flow_field_set_sources (
+      &game->chase, &game->grid,
+      count > 0 ? arr_cell_get (game->chase_sources, 0u) : NULL, count);
+}
+
+/**
+ * Gathers every brain into the intent buffer, evaluates them in parallel,
+ * then applies the moves on this thread in query order so the outcome does
+ * not depend on how the work was split.
+ */
+void
+TEST_try_play_all_brains (ecs_world_t *world)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  if (game->brain_cooldown < 2u)
+    {
+      game->brain_cooldown++;
+      return;
+    }
+  game->brain_cooldown = 0u;
+
+  update_chase_field (world, game);
+
+  arr_brain_intent_reset (game->intents);
+  ecs_iter_t it = ecs_query_iter (world, game->handles.all_brains);
+  while (ecs_query_next (&it))
+    {
+      /* Every character owns its brain_c, see create_characters. The
+       * stream, unlike the entity id, is the same in every build. */
+      SDL_assert (ecs_field_is_self (&it, 0) == true);
+      const brain_c *brain = ecs_field (&it, brain_c, 0);
+      const index_c *index = ecs_field (&it, index_c, 2);
+      for (Sint32 i = 0; i < it.count; i++)
+        {
+          struct brain_intent *intent
+              = arr_brain_intent_push_new (game->intents);
+          intent->pawn = it.entities[i];
+          intent->stream = brain[i].stream;
+          intent->cell = (SDL_Point){ index[i].x, index[i].y };
+        }
+    }
+
+  const size_t count = arr_brain_intent_size (game->intents);
+  if (count == 0u)
+    {
+      return;
+    }
+
+  struct brain_job job
+      = { .intents = arr_brain_intent_get (game->intents, 0u),
+          .grid = &game->grid,
+          .chase = &game->chase,
+          .danger = &game->danger,
+          .seed = game->seed,
+          .tick = game->timers.now };
+  job_pool_run (game->jobs, count, BRAIN_JOB_CHUNK, evaluate_brains, &job);
+
+  for (size_t i = 0; i < count; i++)
+    {
+      const struct brain_intent *intent
+          = arr_brain_intent_get (game->intents, i);
+      try_move_pawn (world, intent->pawn, intent->delta);
+    }
+}
+
+void
+dispell_explosion (ecs_world_t *world, ecs_entity_t ent)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  const index_c *index = ecs_get (world, ent, index_c);
+  grid_clear (&game->grid, index->x, index->y, GRID_CELL_EXPLOSION);
+  sync_cell_entity (world, game, index->x, index->y);
+}
+
+static void queue_detonation (ecs_world_t *world, game_s *game,
+                              ecs_entity_t ent);
+
+/**
+ * Spawns one explosion cell, unless an earlier cross of the same batch
+ * already covers it. A bomb sitting in the cell joins the batch right away.
+ */
+static void
+spawn_explosion (ecs_world_t *world, game_s *game, Sint32 x, Sint32 y,
+                 ecs_entity_t instigator)
+{
+  if (blast_board_claim (&game->blast, x, y) == false)
+    {
+      return;
+    }
+
+  ecs_entity_t new
+      = entity_pool_acquire (world, &game->pools[SIM_POOL_EXPLOSIONS]);
+  index_c *index = ecs_ensure (world, new, index_c);
+  index->x = x;
+  index->y = y;
+  ecs_modified (world, new, index_c);
+  if (instigator != 0u)
+    {
+      ecs_add_pair (world, new, game->handles.instigator, instigator);
+    }
+  start_lifetime (world, game, new);
+
+  grid_set (&game->grid, x, y, GRID_CELL_EXPLOSION);
+  sync_cell_entity (world, game, x, y);
+  kill_occupants (world, game, x, y);
+
+  if (grid_has (&game->grid, x, y, GRID_CELL_BOMB))
+    {
+      ecs_entity_t bomb
+          = *dict_cell_to_bomb_get (game->bombs,
+                                    grid_index (&game->grid, x, y));
+      queue_detonation (world, game, bomb);
+      timing_wheel_cancel (&game->timers,
+                           ecs_get (world, bomb, lifetime_c)->timer);
+      recycle_entity (world, game, bomb, SIM_POOL_BOMBS);
+    }
+}
+
+static void
+create_explosion (ecs_world_t *world, game_s *game,
+                  const struct detonation *detonation)
+{
+  const struct blast_cross *cross = &detonation->cross;
+  const ecs_entity_t instigator = detonation->instigator;
+
+  spawn_explosion (world, game, cross->x, cross->y, instigator);
+  for (Sint32 i = 1; i <= cross->up; i++)
+    {
+      spawn_explosion (world, game, cross->x, cross->y - i, instigator);
+    }
+  for (Sint32 i = 1; i <= cross->left; i++)
+    {
+      spawn_explosion (world, game, cross->x - i, cross->y, instigator);
+    }
+  for (Sint32 i = 1; i <= cross->down; i++)
+    {
+      spawn_explosion (world, game, cross->x, cross->y + i, instigator);
+    }
+  for (Sint32 i = 1; i <= cross->right; i++)
+    {
+      spawn_explosion (world, game, cross->x + i, cross->y, instigator);
+    }
+}
+
+/**
+ * Hands a bomb back to its bomber and queues its blast. Clearing the bomb
+ * from its cell is what guarantees a bomb is only ever queued once.
+ */
+static void
+queue_detonation (ecs_world_t *world, game_s *game, ecs_entity_t ent)
+{
+  ecs_entity_t instigator
+      = ecs_get_target (world, ent, game->handles.instigator, 0);
+
+  const index_c *index = ecs_get (world, ent, index_c);
+
+  struct detonation *detonation
+      = arr_detonation_push_new (game->detonations);
+  detonation->instigator = instigator;
+  detonation->range = BOMB_DEFAULT_BLAST_RANGE;
+  detonation->cross.x = index->x;
+  detonation->cross.y = index->y;
+
+  /* The bomber may have been blown up while their bomb was ticking. */
+  if (instigator != 0u)
+    {
+      bomb_storage_c *bomb_storage_p
+          = ecs_get_mut (world, instigator, bomb_storage_c);
+      bomb_storage_p->count++;
+      detonation->range = bomb_storage_p->blast_range;
+    }
+
+  grid_clear (&game->grid, index->x, index->y, GRID_CELL_BOMB);
+  flow_field_set_blocked (&game->chase, &game->grid, index->x, index->y,
+                          false);
+  danger_map_remove_bomb (&game->danger, &game->grid, index->x, index->y);
+  dict_cell_to_bomb_erase (game->bombs,
+                           grid_index (&game->grid, index->x, index->y));
+  sync_cell_entity (world, game, index->x, index->y);
+}
+
+/**
+ * Lifetime callback of bombs. The blast itself is only queued here, every
+ * bomb going off during the tick is resolved by system_resolve_detonations.
+ */
+void
+detonate_bomb (ecs_world_t *world, ecs_entity_t ent)
+{
+  queue_detonation (world, ecs_get_mut (world, ecs_id (game_s), game_s), ent);
+}
+
+/* Lists the rock a blast arm stopped at, if it stopped short of its range
+ * at one. */
+static void
+hit_rock (game_s *game, Sint32 arm, Sint32 range, Sint32 x, Sint32 y)
+{
+  if (arm < range && grid_has (&game->grid, x, y, GRID_CELL_ROCK) == true)
+    {
+      arr_cell_push_back (game->blasted_rocks,
+                          grid_index (&game->grid, x, y));
+    }
+}
+
+static void
+hit_rocks (game_s *game, const struct detonation *detonation)
+{
+  const struct blast_cross *cross = &detonation->cross;
+  const Sint32 range = detonation->range;
+  hit_rock (game, cross->up, range, cross->x, cross->y - cross->up - 1);
+  hit_rock (game, cross->left, range, cross->x - cross->left - 1, cross->y);
+  hit_rock (game, cross->down, range, cross->x, cross->y + cross->down + 1);
+  hit_rock (game, cross->right, range, cross->x + cross->right + 1, cross->y);
+}
+
+/**
+ * Blows up the rocks hit by the blasts of the tick. They only go once every
+ * blast is resolved, so each of them stops every arm reaching it.
+ */
+static void
+remove_blasted_rocks (ecs_world_t *world, game_s *game)
+{
+  const size_t count = arr_cell_size (game->blasted_rocks);
+  for (size_t i = 0u; i < count; i++)
+    {
+      const SDL_Point cell = grid_position (
+          &game->grid, *arr_cell_get (game->blasted_rocks, i));
+      remove_rock (world, game, cell.x, cell.y);
+    }
+  arr_cell_reset (game->blasted_rocks);
+  if (count > 0u && game->danger.bomb_count > 0)
+    {
+      danger_map_refresh (&game->danger, &game->grid, &game->blast);
+    }
+}
+
+/**
+ * Resolves every bomb queued during this tick in a single pass. The queue is
+ * walked breadth-first and grows as blasts reach other bombs, so a whole
+ * chain reaction goes off within the tick. Cells covered by several crosses
+ * only get one explosion. Rocks an arm stops at are blown up.
+ */
+static void
+system_resolve_detonations (ecs_iter_t *it)
+{
+  ecs_world_t *world = it->world;
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+
+  for (size_t i = 0; i < arr_detonation_size (game->detonations); i++)
+    {
+      /* Work on a copy, chained bombs may grow (and move) the queue. */
+      struct detonation detonation
+          = *arr_detonation_get (game->detonations, i);
+      blast_board_cross (&game->blast, detonation.cross.x,
+                         detonation.cross.y, detonation.range,
+                         &detonation.cross);
+      arr_detonation_get (game->detonations, i)->cross = detonation.cross;
+      create_explosion (world, game, &detonation);
+      hit_rocks (game, &detonation);
+    }
+
+  const size_t count = arr_detonation_size (game->detonations);
+  for (size_t i = 0; i < count; i++)
+    {
+      blast_board_release (&game->blast,
+                           &arr_detonation_get (game->detonations, i)->cross);
+    }
+
+  arr_detonation_reset (game->detonations);
+  remove_blasted_rocks (world, game);
+}
+
+bool
+place_bomb (ecs_world_t *world, ecs_entity_t instigator, Sint32 x, Sint32 y)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  if (grid_has (&game->grid, x, y, GRID_CELL_BLOCKED | GRID_CELL_BOMB))
+    {
+      return false;
+    }
+
+  Sint32 range = BOMB_DEFAULT_BLAST_RANGE;
+  if (instigator != 0u)
+    {
+      range = ecs_get (world, instigator, bomb_storage_c)->blast_range;
+    }
+
+  ecs_entity_t ent = entity_pool_acquire (world, &game->pools[SIM_POOL_BOMBS]);
+  index_c *index = ecs_get_mut (world, ent, index_c);
+  index->x = x;
+  index->y = y;
+  ecs_modified (world, ent, index_c);
+  grid_set (&game->grid, x, y, GRID_CELL_BOMB);
+  flow_field_set_blocked (&game->chase, &game->grid, x, y, true);
+  dict_cell_to_bomb_set_at (game->bombs, grid_index (&game->grid, x, y), ent);
+  sync_cell_entity (world, game, x, y);
+
+  if (instigator != 0u)
+    {
+      ecs_add_pair (world, ent, game->handles.instigator, instigator);
+    }
+  const Uint64 fuse_tick = start_lifetime (world, game, ent);
+  danger_map_add_bomb (&game->danger, &game->grid, &game->blast, x, y, range,
+                       fuse_tick);
+  return true;
+}
+
+bool
+try_place_bomb (ecs_world_t *world, ecs_entity_t player)
+{
+  const controller_c *controller = ecs_get (world, player, controller_c);
+  if (is_pawn_alive (world, controller->pawn) == false)
+    {
+      return false;
+    }
+
+  const ecs_entity_t pawn = controller->pawn;
+  const bomb_storage_c *bomb_storage_p = ecs_get (world, pawn, bomb_storage_c);
+  const index_c *index_p = ecs_get (world, pawn, index_c);
+
+  log_debug (DEBUG_LOG_NONE, "Player bomb: %d", bomb_storage_p->count);
+  if (bomb_storage_p->count <= 0
+      || place_bomb (world, pawn, index_p->x, index_p->y) == false)
+    {
+      return false;
+    }
+
+  ecs_get_mut (world, pawn, bomb_storage_c)->count--;
+
+  return true;
+}
+
+/* Layout of a snapshot_sim state: the header, the cell flags padded to
+ * SIM_STATE_ALIGN, then the characters sorted on their entity and the
+ * lifetimes in timer order. */
+#define SIM_STATE_ALIGN 8u /* Of the 64-bit fields of the records. */
+
+struct sim_state_header
+{
+  Uint64 tick;
+  Uint32 brain_cooldown;
+  Sint32 cell_count;
+  Sint32 character_count;
+  Sint32 lifetime_count;
+};
+
+struct sim_state_character
+{
+  ecs_entity_t ent;
+  index_c index;
+  movement_c movement;
+  bomb_storage_c bomb_storage;
+  bool b_has_bomb_storage;
+  bool b_is_alive;
+};
+
+/* A live bomb or explosion. */
+struct sim_state_lifetime
+{
+  Uint64 expiry;
+  ecs_entity_t instigator;
+  index_c index;
+  Sint8 pool;
+  Sint8 range; /* Blast range of a bomb. */
+};
+
+SDL_COMPILE_TIME_ASSERT (sim_state_header_align,
+                         sizeof (struct sim_state_header) % SIM_STATE_ALIGN
+                             == 0u);
+SDL_COMPILE_TIME_ASSERT (sim_state_character_align,
+                         sizeof (struct sim_state_character)
+                                 % SIM_STATE_ALIGN
+                             == 0u);
+
+/* Bytes taken by the cell flags, padding included. */
+static size_t
+cells_size (Sint32 cell_count)
+{
+  return ((size_t)cell_count + SIM_STATE_ALIGN - 1u)
+         & ~(size_t)(SIM_STATE_ALIGN - 1u);
+}
+
+static size_t
+state_size (const struct sim_state_header *header)
+{
+  return sizeof (*header) + cells_size (header->cell_count)
+         + (size_t)header->character_count
+               * sizeof (struct sim_state_character)
+         + (size_t)header->lifetime_count * sizeof (struct sim_state_lifetime);
+}
+
+static int
+compare_characters (const void *a, const void *b)
+{
+  const ecs_entity_t ent_a = ((const struct sim_state_character *)a)->ent;
+  const ecs_entity_t ent_b = ((const struct sim_state_character *)b)->ent;
+  return (ent_a > ent_b) - (ent_a < ent_b);
+}
+
+/* Lists the lifetime timers into game->pending. */
+static size_t
+list_lifetimes (game_s *game)
+{
+  size_t count = timing_wheel_pending (&game->timers, NULL, 0u);
+  arr_timer_resize (game->pending, count);
+  if (count > 0u)
+    {
+      timing_wheel_pending (&game->timers,
+                            arr_timer_get (game->pending, 0u), count);
+    }
+  return count;
+}
+
+size_t
+snapshot_sim (ecs_world_t *world, Uint8 **state, size_t *capacity)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+
+  struct sim_state_header header
+      = { .tick = game->timers.now,
+          .brain_cooldown = game->brain_cooldown,
+          .cell_count = grid_cell_count (&game->grid),
+          .lifetime_count = (Sint32)list_lifetimes (game) };
+  ecs_iter_t it = ecs_query_iter (world, game->handles.every_character);
+  while (ecs_query_next (&it))
+    {
+      header.character_count += it.count;
+    }
+  const size_t size = state_size (&header);
+  if (size > *capacity)
+    {
+      Uint8 *grown = SDL_realloc (*state, size);
+      if (grown == NULL)
+        {
+          return 0u;
+        }
+      *state = grown;
+      *capacity = size;
+    }
+
+  Uint8 *cursor = *state + sizeof (header);
+  SDL_memcpy (cursor, game->grid.cells, (size_t)header.cell_count);
+  SDL_memset (cursor + header.cell_count, 0,
+              cells_size (header.cell_count) - (size_t)header.cell_count);
+  cursor += cells_size (header.cell_count);
+
+  /* Padding included, so unchanged records delta down to nothing. */
+  struct sim_state_character *characters = (void *)cursor;
+  SDL_memset (characters, 0,
+              (size_t)header.character_count * sizeof (*characters));
+  Sint32 character_count = 0;
+  it = ecs_query_iter (world, game->handles.every_character);
+  while (ecs_query_next (&it))
+    {
+      const index_c *index = ecs_field (&it, index_c, 1);
+      const bool b_is_alive = ecs_field_is_set (&it, 2) == false;
+      for (Sint32 i = 0; i < it.count; i++)
+        {
+          struct sim_state_character *character
+              = &characters[character_count++];
+          const ecs_entity_t ent = it.entities[i];
+          character->ent = ent;
+          character->index = index[i];
+          character->b_is_alive = b_is_alive;
+          const movement_c *movement = ecs_get (world, ent, movement_c);
+          if (movement != NULL)
+            {
+              character->movement = *movement;
+            }
+          const bomb_storage_c *bomb_storage
+              = ecs_get (world, ent, bomb_storage_c);
+          character->b_has_bomb_storage = bomb_storage != NULL;
+          if (bomb_storage != NULL)
+            {
+              character->bomb_storage = *bomb_storage;
+            }
+        }
+    }
+  SDL_qsort (characters, (size_t)character_count, sizeof (*characters),
+             compare_characters);
+  cursor += (size_t)character_count * sizeof (*characters);
+
+  struct sim_state_lifetime *lifetimes = (void *)cursor;
+  Sint32 lifetime_count = 0;
+  for (Sint32 i = 0; i < header.lifetime_count; i++)
+    {
+      const struct timing_wheel_timer *timer
+          = arr_timer_get (game->pending, (size_t)i);
+      const ecs_entity_t ent = timer->payload;
+      if (ecs_is_alive (world, ent) == false)
+        {
+          continue;
+        }
+      const lifetime_c *lifetime = ecs_get (world, ent, lifetime_c);
+      if (lifetime->pool == SIM_POOL_NONE)
+        {
+          continue;
+        }
+
+      struct sim_state_lifetime *record = &lifetimes[lifetime_count++];
+      SDL_zerop (record);
+      record->expiry = timer->expiry;
+      record->instigator
+          = ecs_get_target (world, ent, game->handles.instigator, 0);
+      record->index = *ecs_get (world, ent, index_c);
+      record->pool = lifetime->pool;
+      record->range = BOMB_DEFAULT_BLAST_RANGE;
+      if (record->pool == SIM_POOL_BOMBS && record->instigator != 0u)
+        {
+          record->range
+              = ecs_get (world, record->instigator, bomb_storage_c)
+                    ->blast_range;
+        }
+    }
+  header.lifetime_count = lifetime_count;
+
+  SDL_memcpy (*state, &header, sizeof (header));
+  return state_size (&header);
+}
+
+Uint64
+hash_sim (ecs_world_t *world)
+{
+  Uint8 *state = NULL;
+  size_t capacity = 0u;
+  if (snapshot_sim (world, &state, &capacity) == 0u)
+    {
+      return 0u;
+    }
+
+  struct sim_state_header header;
+  SDL_memcpy (&header, state, sizeof (header));
+  Uint64 hash = replay_hash (REPLAY_HASH_INIT, &header.tick,
+                             sizeof (header.tick));
+  hash = replay_hash (hash, &header.brain_cooldown,
+                      sizeof (header.brain_cooldown));
+  const Uint8 *cursor = state + sizeof (header);
+  hash = replay_hash (hash, cursor, (size_t)header.cell_count);
+  cursor += cells_size (header.cell_count);
+
+  /* Characters keep their order in either build, they are created in the
+   * same order. Field by field, the padding of the components is not part
+   * of the state. */
+  const struct sim_state_character *characters = (const void *)cursor;
+  for (Sint32 i = 0; i < header.character_count; i++)
+    {
+      const struct sim_state_character *character = &characters[i];
+      const index_c *index = &character->index;
+      hash = replay_hash (hash, &index->x, sizeof (index->x));
+      hash = replay_hash (hash, &index->y, sizeof (index->y));
+      const movement_c *movement = &character->movement;
+      hash = replay_hash (hash, &movement->delta.x,
+                          sizeof (movement->delta.x));
+      hash = replay_hash (hash, &movement->delta.y,
+                          sizeof (movement->delta.y));
+      hash = replay_hash (hash, &movement->cooldown,
+                          sizeof (movement->cooldown));
+      hash = replay_hash (hash, &movement->default_cooldown,
+                          sizeof (movement->default_cooldown));
+      const bomb_storage_c *bomb_storage = &character->bomb_storage;
+      hash = replay_hash (hash, &bomb_storage->max_count,
+                          sizeof (bomb_storage->max_count));
+      hash = replay_hash (hash, &bomb_storage->count,
+                          sizeof (bomb_storage->count));
+      hash = replay_hash (hash, &bomb_storage->blast_range,
+                          sizeof (bomb_storage->blast_range));
+      hash = replay_hash (hash, &character->b_has_bomb_storage,
+                          sizeof (bool));
+      hash = replay_hash (hash, &character->b_is_alive, sizeof (bool));
+    }
+  cursor += (size_t)header.character_count * sizeof (*characters);
+
+  const struct sim_state_lifetime *lifetimes = (const void *)cursor;
+  for (Sint32 i = 0; i < header.lifetime_count; i++)
+    {
+      const struct sim_state_lifetime *lifetime = &lifetimes[i];
+      hash = replay_hash (hash, &lifetime->expiry, sizeof (lifetime->expiry));
+      hash = replay_hash (hash, &lifetime->index.x,
+                          sizeof (lifetime->index.x));
+      hash = replay_hash (hash, &lifetime->index.y,
+                          sizeof (lifetime->index.y));
+      hash = replay_hash (hash, &lifetime->pool, sizeof (lifetime->pool));
+      hash = replay_hash (hash, &lifetime->range, sizeof (lifetime->range));
+    }
+
+  SDL_free (state);
+  return hash;
+}
+
+/* Drops the live bombs and explosions, as if none had ever been placed. */
+static void
+clear_lifetimes (ecs_world_t *world, game_s *game)
+{
+  while (game->danger.bomb_count > 0)
+    {
+      const SDL_Point cell = grid_position (
+          &game->grid, game->danger.bombs[game->danger.bomb_count - 1].cell);
+      danger_map_remove_bomb (&game->danger, &game->grid, cell.x, cell.y);
+    }
+  dict_cell_to_bomb_reset (game->bombs);
+
+  const size_t count = list_lifetimes (game);
+  for (size_t i = 0; i < count; i++)
+    {
+      const ecs_entity_t ent = arr_timer_get (game->pending, i)->payload;
+      if (ecs_is_alive (world, ent) == false)
+        {
+          continue;
+        }
+      const Sint8 pool = ecs_get (world, ent, lifetime_c)->pool;
+      if (pool != SIM_POOL_NONE)
+        {
+          recycle_entity (world, game, ent, pool);
+        }
+      else
+        {
+          ecs_delete (world, ent);
+        }
+    }
+}
+
+/**
+ * Copies the cell flags in, updating the blast board, the chase field and
+ * the cell mirror wherever the blocked state of a cell changes, and the
+ * tilemap wherever a rock was blown up or comes back.
+ */
+static void
+restore_cells (ecs_world_t *world, game_s *game, const Uint8 *cells)
+{
+  tilemap_c *tilemap = ecs_get_mut (world, ecs_id (tilemap_c), tilemap_c);
+  const Sint32 count = grid_cell_count (&game->grid);
+  for (Sint32 i = 0; i < count; i++)
+    {
+      const Uint8 changed = game->grid.cells[i] ^ cells[i];
+      if (changed == 0u)
+        {
+          continue;
+        }
+
+      game->grid.cells[i] = cells[i];
+      const SDL_Point cell = grid_position (&game->grid, i);
+      if ((changed & GRID_CELL_BLOCKED) != 0u)
+        {
+          blast_board_set_blocked (&game->blast, cell.x, cell.y,
+                                   (cells[i] & GRID_CELL_BLOCKED) != 0u);
+        }
+      if ((changed & (GRID_CELL_BLOCKED | GRID_CELL_BOMB)) != 0u)
+        {
+          flow_field_set_blocked (
+              &game->chase, &game->grid, cell.x, cell.y,
+              (cells[i] & (GRID_CELL_BLOCKED | GRID_CELL_BOMB)) != 0u);
+        }
+      if ((changed & GRID_CELL_ROCK) != 0u)
+        {
+          tilemap_set (&tilemap->map, i, tilemap_tile_of (cells[i]));
+        }
+      sync_cell_entity (world, game, cell.x, cell.y);
+    }
+}
+
+static void
+restore_characters (ecs_world_t *world, const game_s *game,
+                    const struct sim_state_character *characters,
+                    Sint32 count)
+{
+  ecs_defer_begin (world);
+  ecs_iter_t it = ecs_query_iter (world, game->handles.every_character);
+  while (ecs_query_next (&it))
+    {
+      for (Sint32 i = 0; i < it.count; i++)
+        {
+          const struct sim_state_character key = { .ent = it.entities[i] };
+          if (SDL_bsearch (&key, characters, (size_t)count,
+                           sizeof (*characters), compare_characters)
+              == NULL)
+            {
+              ecs_delete (world, it.entities[i]);
+            }
+        }
+    }
+  ecs_defer_end (world);
+
+  for (Sint32 i = 0; i < count; i++)
+    {
+      const struct sim_state_character *character = &characters[i];
+      const ecs_entity_t ent = character->ent;
+      if (ecs_is_alive (world, ent) == false)
+        {
+          continue;
+        }
+      ecs_enable (world, ent, character->b_is_alive);
+      ecs_set_ptr (world, ent, index_c, &character->index);
+      if (ecs_has (world, ent, movement_c))
+        {
+          ecs_set_ptr (world, ent, movement_c, &character->movement);
+        }
+      if (character->b_has_bomb_storage == true)
+        {
+          ecs_set_ptr (world, ent, bomb_storage_c, &character->bomb_storage);
+        }
+    }
+}
+
+/* Fills the occupancy index again with the live characters, drawn standing
+ * on their cell. */
+static void
+restore_occupancy (ecs_world_t *world, game_s *game)
+{
+  occupancy_clear (&game->occupancy);
+  ecs_defer_begin (world);
+  ecs_iter_t it = ecs_query_iter (world, game->handles.every_character);
+  while (ecs_query_next (&it))
+    {
+      const index_c *index = ecs_field (&it, index_c, 1);
+      const bool b_is_dead = ecs_field_is_set (&it, 2);
+      for (Sint32 i = 0; i < it.count; i++)
+        {
+          const occupant_c occupant
+              = { .slot = b_is_dead == true
+                              ? -1
+                              : occupancy_add (&game->occupancy, &game->grid,
+                                               index[i].x, index[i].y,
+                                               it.entities[i]) };
+          ecs_set_ptr (world, it.entities[i], occupant_c, &occupant);
+          ecs_remove (world, it.entities[i], glide_c);
+        }
+    }
+  ecs_defer_end (world);
+}
+
+/* Takes the bombs and explosions back out of their pools. */
+static void
+restore_lifetimes (ecs_world_t *world, game_s *game,
+                   const struct sim_state_lifetime *lifetimes, Sint32 count)
+{
+  for (Sint32 i = 0; i < count; i++)
+    {
+      const struct sim_state_lifetime *record = &lifetimes[i];
+      const ecs_entity_t ent
+          = entity_pool_acquire (world, &game->pools[record->pool]);
+      ecs_set_ptr (world, ent, index_c, &record->index);
+      if (record->instigator != 0u
+          && ecs_is_alive (world, record->instigator) == true)
+        {
+          ecs_add_pair (world, ent, game->handles.instigator,
+                        record->instigator);
+        }
+      lifetime_c *lifetime = ecs_get_mut (world, ent, lifetime_c);
+      lifetime->timer
+          = timing_wheel_schedule (&game->timers, record->expiry, ent);
+
+      if (record->pool == SIM_POOL_BOMBS)
+        {
+          dict_cell_to_bomb_set_at (
+              game->bombs,
+              grid_index (&game->grid, record->index.x, record->index.y),
+              ent);
+          danger_map_add_bomb (&game->danger, &game->grid, &game->blast,
+                               record->index.x, record->index.y,
+                               record->range, record->expiry);
+        }
+    }
+}
+
+bool
+restore_sim (ecs_world_t *world, const Uint8 *state, size_t size)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+
+  struct sim_state_header header;
+  if (size < sizeof (header))
+    {
+      return false;
+    }
+  SDL_memcpy (&header, state, sizeof (header));
+  if (header.cell_count != grid_cell_count (&game->grid)
+      || header.character_count < 0 || header.lifetime_count < 0
+      || state_size (&header) != size)
+    {
+      return false;
+    }
+  const Uint8 *cells = state + sizeof (header);
+  const struct sim_state_character *characters
+      = (const void *)(cells + cells_size (header.cell_count));
+  const struct sim_state_lifetime *lifetimes
+      = (const void *)(characters + header.character_count);
+
+  clear_lifetimes (world, game);
+  timing_wheel_reset (&game->timers, header.tick);
+  restore_cells (world, game, cells);
+  restore_characters (world, game, characters, header.character_count);
+  restore_occupancy (world, game);
+  restore_lifetimes (world, game, lifetimes, header.lifetime_count);
+  game->brain_cooldown = header.brain_cooldown;
+
+  return true;
+}
+
+SDL_FPoint
+get_relative_from_index (ecs_entity_t ent, ecs_world_t *world)
+{
+  const index_c *index = ecs_get (world, ent, index_c);
+  SDL_FPoint result = { .x = index->x * CELL_SIZE, .y = index->y * CELL_SIZE };
+  return result;
+}
+
+/**
+ * Position of a character, along its last step between two cells.
+ */
+static SDL_FPoint
+get_relative_gliding (ecs_entity_t ent, ecs_world_t *world)
+{
+  const SDL_FPoint to = get_relative_from_index (ent, world);
+  const glide_c *glide = ecs_get (world, ent, glide_c);
+  if (glide == NULL)
+    {
+      return to;
+    }
+
+  const game_s *game = ecs_singleton_get (world, game_s);
+  const Sint64 elapsed = (Sint64)(game->timers.now - glide->start) - 1;
+  const float ticks = (float)elapsed + game->tick_alpha;
+  const float t
+      = SDL_clamp (ticks / (float)SDL_max (glide->duration, 1u), 0.f, 1.f);
+  const SDL_FPoint from = { .x = glide->from.x * CELL_SIZE,
+                            .y = glide->from.y * CELL_SIZE };
+  SDL_FPoint result = { .x = from.x + (to.x - from.x) * t,
+                        .y = from.y + (to.y - from.y) * t };
+  return result;
+}
+
+/* Prefabs of the map_prefab ids. */
+static const char *map_prefab_names[MAP_PREFAB_COUNT]
+    = { [MAP_PREFAB_BOMBER] = "grid_character_pfb",
+        [MAP_PREFAB_CURSED_BALLOON] = "char_cursed_balloon_pfb",
+        [MAP_PREFAB_COP_CAR] = "char_cop_car_pfb",
+        [MAP_PREFAB_GHOST] = "char_ghost_pfb" };
+
+void
+create_characters (ecs_world_t *world, const struct map *map)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  Uint32 stream = 0u;
+  for (Sint32 i = 0; i < map->spawn_count; i++)
+    {
+      const struct map_spawn *spawn = &map->spawns[i];
+      if (spawn->prefab == MAP_PREFAB_BOMBER)
+        {
+          continue;
+        }
+
+      ecs_entity_t pfb
+          = ecs_lookup (world, map_prefab_names[spawn->prefab]);
+      ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
+
+      index_c *index = ecs_get_mut (world, ent, index_c);
+      index->x = spawn->x;
+      index->y = spawn->y;
+
+      if (ecs_has (world, ent, brain_c))
+        {
+          brain_c *brain = ecs_ensure (world, ent, brain_c);
+          brain->stream = stream++;
+        }
+      track_character (world, game, ent);
+    }
+}
+
+static void
+TEST_create_game_master (ecs_world_t *world)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  ecs_entity_t ent = ecs_entity (world, { .name = "game_master" });
+  ecs_add (world, ent, controller_c);
+  game->AI = ent;
+}
+
+void
+create_bombers (ecs_world_t *world, const struct map *map,
+                Sint32 player_count, Sint32 local_player)
+{
+  /* Corners of the classic arena, shared round-robin past four players. */
+  static const SDL_Point fallbacks[]
+      = { { 1, 1 }, { 1, 13 }, { 13, 1 }, { 13, 13 } };
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  const ecs_entity_t pfb = ecs_lookup (world, "grid_character_pfb");
+  Sint32 spawn = 0;
+  for (Sint32 player = 0; player < SDL_min (player_count, SIM_MAX_PLAYERS);
+       player++)
+    {
+      while (spawn < map->spawn_count
+             && map->spawns[spawn].prefab != MAP_PREFAB_BOMBER)
+        {
+          spawn++;
+        }
+      SDL_Point cell = fallbacks[player % SDL_arraysize (fallbacks)];
+      if (spawn < map->spawn_count)
+        {
+          cell = (SDL_Point){ map->spawns[spawn].x, map->spawns[spawn].y };
+          spawn++;
+        }
+
+      ecs_entity_t ent = ecs_new_w_pair (world, EcsIsA, pfb);
+      char name[16];
+      SDL_snprintf (name, sizeof (name), "bomber%d", player + 1);
+      ecs_set_name (world, ent, name);
+
+      bomb_storage_c *bomb_storage = ecs_ensure (world, ent, bomb_storage_c);
+      bomb_storage->max_count = 2;
+      bomb_storage->count = bomb_storage->max_count;
+      bomb_storage->blast_range = BOMB_DEFAULT_BLAST_RANGE;
+
+      index_c *index = ecs_get_mut (world, ent, index_c);
+      index->x = cell.x;
+      index->y = cell.y;
+      track_character (world, game, ent);
+
+      if (player == local_player)
+        {
+          ecs_add (world, ent, scroll_to_c);
+        }
+
+      sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
+      string_printf (sprite->name, "T_Flipbook_Bomber%d.png", player + 1);
+
+      controller_c *controller = ecs_get_mut (
+          world, get_player_controller (world, player), controller_c);
+      controller->pawn = ent;
+    }
+}
+
+static void
+create_player_controllers (ecs_world_t *world)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  const ecs_entity_t pfb = ecs_lookup (world, "player_controller_pfb");
+  for (Sint32 player = 0; player < SIM_MAX_PLAYERS; player++)
+    {
+      char name[32];
+      SDL_snprintf (name, sizeof (name), "player%d", player + 1);
+      game->players[player] = ecs_entity (
+          world, { .name = name, .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+    }
+}
+
+/**
+ * Builds the optional grid_cell_pfb mirror, one entity per cell.
+ */
+static void
+create_cell_entities (ecs_world_t *world, game_s *game)
+{
+  const ecs_entity_t pfb = ecs_lookup (world, "grid_cell_pfb");
+  for (Sint32 j = 0; j < game->grid.h; j++)
+    {
+      arr_entity_t row;
+      arr_entity_init (row);
+      for (Sint32 i = 0; i < game->grid.w; i++)
+        {
+          ecs_entity_t cell = ecs_new_w_pair (world, EcsIsA, pfb);
+          if (game->b_names_map_entities == true)
+            {
+              char name[64];
+              SDL_snprintf (name, sizeof (name), "cell_%d_%d", i, j);
+              ecs_set_name (world, cell, name);
+            }
+          index_c *index = ecs_get_mut (world, cell, index_c);
+          index->x = i;
+          index->y = j;
+          arr_entity_push_back (row, cell);
+        }
+      mat2d_entity_push_back (game->cells, row);
+    }
+}
+
+/**
+ * Lays out a loaded map, taking over its grid. The spawns are left to
+ * create_bombers and create_characters. Floors, walls and rocks are no
+ * entities but the tiles of the tilemap, see map_view.h.
+ */
+void
+create_map (ecs_world_t *world, struct map *map)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  grid_free (&game->grid);
+  game->grid = map->grid;
+  SDL_zerop (&map->grid);
+  const struct grid *grid = &game->grid;
+
+  if (game->b_has_cell_entities == true)
+    {
+      create_cell_entities (world, game);
+      for (Sint32 j = 0; j < grid->h; j++)
+        {
+          for (Sint32 i = 0; i < grid->w; i++)
+            {
+              sync_cell_entity (world, game, i, j);
+            }
+        }
+    }
+
+  tilemap_c *tilemap = ecs_get_mut (world, ecs_id (tilemap_c), tilemap_c);
+  if (tilemap_init (&tilemap->map, grid) == false)
+    {
+      log_error (0, "Failed to allocate the tilemap");
+    }
+
+  if (blast_board_init (&game->blast, grid) == false)
+    {
+      log_error (0, "Failed to allocate the blast board");
+    }
+  if (danger_map_init (&game->danger, grid) == false)
+    {
+      log_error (0, "Failed to allocate the danger map");
+    }
+  if (flow_field_init (&game->chase, grid) == false)
+    {
+      log_error (0, "Failed to allocate the chase field");
+    }
+  if (occupancy_init (&game->occupancy, grid) == false)
+    {
+      log_error (0, "Failed to allocate the occupancy index");
+    }
+}
+
+static void
+init_game_character_prefabs (ecs_world_t *world)
+{
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_object_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "grid_character_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+    //    anim_player_c *anim_player = ecs_ensure (ecs, ent, anim_player_c);
+
+    layer_c *layer = ecs_get_mut (world, ent, layer_c);
+    layer->value = 2;
+
+    movement_c *movement = ecs_ensure (world, ent, movement_c);
+    movement->default_cooldown = 10u;
+
+    origin_c *origin = ecs_ensure (world, ent, origin_c);
+    origin->relative_callback = get_relative_gliding;
+  }
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_character_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "grid_AI_character_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+
+    ecs_add (world, ent, brain_c);
+  }
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_AI_character_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "char_cursed_balloon_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+
+    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
+    string_init_set_str (sprite->name, "T_Flipbook_CursedBalloon.png");
+  }
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_AI_character_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "char_ghost_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+
+    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
+    string_init_set_str (sprite->name, "T_Flipbook_Ghost.png");
+  }
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_AI_character_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "char_cop_car_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+
+    anim_player_c *anim_player = ecs_ensure (world, ent, anim_player_c);
+    struct anim_flipbook *flipbook
+        = SDL_malloc (sizeof (struct anim_flipbook));
+    flipbook->frame_count = (SDL_Point){ 6, 1 };
+    flipbook->frame_size = (SDL_FPoint){ 32.f, 32.f };
+    string_init_set_str (flipbook->name, "T_Flipbook_CopCar.png");
+    flipbook->play_speed = 24u;
+    struct anim_pose *pose = SDL_malloc (sizeof (struct anim_pose));
+    dict_sint32_anim_flipbook_init (pose->directions);
+    dict_sint32_anim_flipbook_set_at (pose->directions, 0, flipbook);
+    dict_string_anim_pose_init (anim_player->poses);
+    dict_string_anim_pose_set_at (anim_player->poses, STRING_CTE ("default"),
+                                  pose);
+    string_init_set_str (anim_player->control_pose, "default");
+    anim_player->control_direction = 0;
+
+    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
+  }
+}
+
+static void
+init_game_prefabs (ecs_world_t *world)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  {
+    ecs_entity_t ent = ecs_entity (world, { .name = "player_controller_pfb",
+                                            .add = ecs_ids (EcsPrefab) });
+    ecs_add (world, ent, controller_c);
+  }
+  {
+    ecs_entity_t ent = ecs_entity (
+        world, { .name = "grid_cell_pfb", .add = ecs_ids (EcsPrefab) });
+    array_c *array = ecs_ensure (world, ent, array_c);
+    cell_data_c *cell_data = ecs_ensure (world, ent, cell_data_c);
+    index_c *index = ecs_ensure (world, ent, index_c);
+  }
+  {
+    ecs_entity_t ent = ecs_entity (
+        world, { .name = "grid_element_pfb", .add = ecs_ids (EcsPrefab) });
+    index_c *index = ecs_ensure (world, ent, index_c);
+    origin_c *origin = ecs_ensure (world, ent, origin_c);
+    origin->relative_callback = get_relative_from_index;
+  }
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_element_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "grid_object_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+    bounds_c *bounds = ecs_ensure (world, ent, bounds_c);
+    bounds->size = (SDL_FPoint){ CELL_SIZE, CELL_SIZE };
+    box_c *box = ecs_ensure (world, ent, box_c);
+    box->b_is_shown = false;
+    box->b_uses_color = true;
+    color_c *color = ecs_ensure (world, ent, color_c);
+    color->default_r = 0u;
+    color->default_g = 155u;
+    color->default_b = 0u;
+    layer_c *layer = ecs_ensure (world, ent, layer_c);
+    layer->value = 1;
+    sprite_c *sprite = ecs_ensure (world, ent, sprite_c);
+    visibility_c *visibility = ecs_ensure (world, ent, visibility_c);
+    visibility->b_state = true;
+  }
+  {
+    /* The floors, walls and rocks are never instantiated, the map view
+     * paints their sprite straight into the chunks, see map_view.h. */
+    ecs_entity_t pfb = ecs_lookup (world, "grid_object_pfb");
+    ecs_entity (world, { .name = "grid_object_static_pfb",
+                         .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+  }
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_object_static_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "floor_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+    color_c *color = ecs_ensure (world, ent, color_c);
+    color->default_r = 125u;
+    color->default_g = 0u;
+    color->default_b = 125u;
+    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
+    sprite->b_uses_color = true;
+    string_set_str (sprite->name, "T_Sprite_Floor0.png");
+  }
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_object_static_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "rock_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
+    string_set_str (sprite->name, "T_Sprite_Rock0.png");
+    game->handles.rock_pfb = ent;
+  }
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_object_static_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "factory_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
+    string_set_str (sprite->name, "T_Sprite_Factory.png");
+  }
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_object_static_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "wall_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+    color_c *color = ecs_ensure (world, ent, color_c);
+    color->default_r = 66u;
+    color->default_g = 125u;
+    color->default_b = 45u;
+    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
+    sprite->b_uses_color = true;
+    string_set_str (sprite->name, "T_Sprite_Wall0.png");
+  }
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_object_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "bomb_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+    lifetime_c *lifetime = ecs_ensure (world, ent, lifetime_c);
+    lifetime->on_delete_callback = detonate_bomb;
+    lifetime->pool = SIM_POOL_BOMBS;
+    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
+    string_set_str (sprite->name, "T_Flipbook_Bomb.png");
+    game->handles.bomb_pfb = ent;
+  }
+  {
+    ecs_entity_t pfb = ecs_lookup (world, "grid_object_pfb");
+    ecs_entity_t ent
+        = ecs_entity (world, { .name = "explosion_pfb",
+                               .add = ecs_ids (EcsPrefab, ecs_isa (pfb)) });
+    anim_player_c *anim_player = ecs_ensure (world, ent, anim_player_c);
+    dict_string_anim_pose_init (anim_player->poses);
+    struct anim_pose *pose = SDL_malloc (sizeof (struct anim_pose));
+    dict_sint32_anim_flipbook_init (pose->directions);
+    struct anim_flipbook *flipbook
+        = SDL_malloc (sizeof (struct anim_flipbook));
+    string_init_set_str (flipbook->name, "T_Flipbook_Explo0.png");
+    flipbook->frame_size = (SDL_FPoint){ 32.f, 32.f };
+    flipbook->frame_count = (SDL_Point){ 4, 1 };
+    flipbook->play_speed = 18u;
+    dict_sint32_anim_flipbook_set_at (pose->directions, 0, flipbook);
+    dict_string_anim_pose_set_at (anim_player->poses, STRING_CTE ("default"),
+                                  pose);
+    string_init_set_str (anim_player->control_pose, "default");
+    anim_player->control_direction = 0;
+    lifetime_c *lifetime = ecs_ensure (world, ent, lifetime_c);
+    lifetime->duration = 150u;
+    lifetime->on_delete_callback = dispell_explosion;
+    lifetime->pool = SIM_POOL_EXPLOSIONS;
+    sprite_c *sprite = ecs_get_mut (world, ent, sprite_c);
+    game->handles.explosion_pfb = ent;
+  }
+}
+
+static void
+init_game_queries (ecs_world_t *world)
+{
+  game_s *game = ecs_singleton_ensure (world, game_s);
+  game->handles.all_characters = ecs_query (
+      world,
+      { .terms = { { .id = ecs_isa (ecs_lookup (world, "grid_character_pfb")) },
+                   { .id = ecs_id (index_c) } } });
+  game->handles.every_character = ecs_query (
+      world,
+      { .terms = { { .id = ecs_isa (ecs_lookup (world, "grid_character_pfb")) },
+                   { .id = ecs_id (index_c) },
+                   { .id = EcsDisabled, .oper = EcsOptional } } });
+  game->handles.all_brains
+      = ecs_query (world, { .terms = { { .id = ecs_id (brain_c) },
+                                       { .id = ecs_id (movement_c) },
+                                       { .id = ecs_id (index_c) } } });
+  game->handles.all_bombers
+      = ecs_query (world, { .terms = { { .id = ecs_id (bomb_storage_c) },
+                                       { .id = ecs_id (index_c) } } });
+}
+
+static void
+init_game_systems (ecs_world_t *world)
+{
+  ECS_SYSTEM (world, system_lifetime_progress, EcsOnUpdate, 0);
+  ECS_SYSTEM (world, system_resolve_detonations, EcsPostUpdate, 0);
+
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  game->handles.lifetime_system = ecs_id (system_lifetime_progress);
+  game->handles.detonation_system = ecs_id (system_resolve_detonations);
+}
+
+void
+enable_sim_systems (ecs_world_t *world, bool b_is_enabled)
+{
+  const game_s *game = ecs_singleton_get (world, game_s);
+  ecs_enable (world, game->handles.lifetime_system, b_is_enabled);
+  ecs_enable (world, game->handles.detonation_system, b_is_enabled);
+}
+
+static void
+init_game_pools (ecs_world_t *world)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  {
+    struct entity_pool *pool = &game->pools[SIM_POOL_BOMBS];
+    entity_pool_init (pool, game->handles.bomb_pfb);
+    entity_pool_reset_on_reuse (pool, ecs_id (lifetime_c));
+  }
+  {
+    struct entity_pool *pool = &game->pools[SIM_POOL_EXPLOSIONS];
+    entity_pool_init (pool, game->handles.explosion_pfb);
+    entity_pool_reset_on_reuse (pool, ecs_id (lifetime_c));
+    entity_pool_reset_on_reuse (pool, ecs_id (anim_player_c));
+  }
+}
+
+static void
+init_game_hooks (ecs_world_t *world)
+{
+  ecs_type_hooks_t brain_hooks = { .ctor = brain };
+  ecs_set_hooks_id (world, ecs_id (brain_c), &brain_hooks);
+
+  ecs_type_hooks_t cell_data_hooks = { .ctor = cell_data };
+  ecs_set_hooks_id (world, ecs_id (cell_data_c), &cell_data_hooks);
+
+  ecs_type_hooks_t controller_hooks = { .ctor = controller };
+  ecs_set_hooks_id (world, ecs_id (controller_c), &controller_hooks);
+
+  ecs_type_hooks_t lifetime_hooks = { .ctor = lifetime };
+  ecs_set_hooks_id (world, ecs_id (lifetime_c), &lifetime_hooks);
+}
+
+void
+init_sim (ecs_world_t *world)
+{
+  ECS_TAG (world, instigator);
+
+  ECS_COMPONENT_DEFINE (world, game_s);
+  game_s *game = ecs_singleton_ensure (world, game_s);
+  game->handles.instigator = instigator;
+  mat2d_entity_init (game->cells);
+  arr_detonation_init (game->detonations);
+  dict_cell_to_bomb_init (game->bombs);
+  timing_wheel_init (&game->timers, 0u);
+  arr_brain_intent_init (game->intents);
+  arr_cell_init (game->chase_sources);
+  arr_cell_init (game->blasted_rocks);
+  arr_timer_init (game->pending);
+  game->jobs = job_pool_create (-1);
+
+  ECS_COMPONENT_DEFINE (world, bomb_storage_c);
+  ECS_COMPONENT_DEFINE (world, brain_c);
+  ECS_COMPONENT_DEFINE (world, cell_data_c);
+  ECS_COMPONENT_DEFINE (world, controller_c);
+  ECS_COMPONENT_DEFINE (world, glide_c);
+  ECS_COMPONENT_DEFINE (world, lifetime_c);
+  ECS_COMPONENT_DEFINE (world, occupant_c);
+  ECS_COMPONENT_DEFINE (world, tilemap_c);
+  ecs_singleton_ensure (world, tilemap_c);
+
+  init_game_hooks (world);
+  init_game_prefabs (world);
+  init_game_character_prefabs (world);
+  init_game_queries (world);
+  init_game_systems (world);
+  init_game_pools (world);
+  TEST_create_game_master (world);
+  create_player_controllers (world);
+}
+
+void
+fini_sim (ecs_world_t *world)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  job_pool_destroy (game->jobs);
+  game->jobs = NULL;
+  for (Sint32 i = 0; i < SIM_POOL_COUNT; i++)
+    {
+      entity_pool_free (&game->pools[i]);
+    }
+  grid_free (&game->grid);
+  blast_board_free (&game->blast);
+  danger_map_free (&game->danger);
+  flow_field_free (&game->chase);
+  occupancy_free (&game->occupancy);
+  timing_wheel_free (&game->timers);
+  arr_detonation_clear (game->detonations);
+  dict_cell_to_bomb_clear (game->bombs);
+  arr_brain_intent_clear (game->intents);
+  arr_cell_clear (game->chase_sources);
+  arr_cell_clear (game->blasted_rocks);
+  arr_timer_clear (game->pending);
+  mat2d_entity_clear (game->cells);
+
+  tilemap_c *tilemap = ecs_get_mut (world, ecs_id (tilemap_c), tilemap_c);
+  tilemap_free (&tilemap->map);
+}
+
+void
+seed_sim (ecs_world_t *world, Uint64 seed)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  game->seed = seed;
+}
+
+void
+tick_sim (ecs_world_t *world)
+{
+  profiler_begin ("tick_sim");
+  for (Sint32 player = 0; player < SIM_MAX_PLAYERS; player++)
+    {
+      const ecs_entity_t controller = get_player_controller (world, player);
+      if (ecs_get (world, controller, controller_c)->b_is_placing_bomb
+          == true)
+        {
+          profiler_begin ("try_place_bomb");
+          try_place_bomb (world, controller);
+          profiler_end ();
+        }
+      profiler_begin ("try_move_character");
+      try_move_character (world, controller);
+      profiler_end ();
+    }
+  profiler_begin ("TEST_try_play_all_brains");
+  TEST_try_play_all_brains (world);
+  profiler_end ();
+  profiler_end ();
+}
+
+void
+interpolate_sim (ecs_world_t *world, float alpha)
+{
+  game_s *game = ecs_get_mut (world, ecs_id (game_s), game_s);
+  game->tick_alpha = SDL_clamp (alpha, 0.f, 1.f);
+}
+
+Uint8
+read_sim_input (ecs_world_t *world, ecs_entity_t controller)
+{
+  const controller_c *controller_p = ecs_get (world, controller, controller_c);
+  Uint8 input = 0u;
+  input |= controller_p->control_delta.y < 0 ? SIM_INPUT_UP : 0u;
+  input |= controller_p->control_delta.y > 0 ? SIM_INPUT_DOWN : 0u;
+  input |= controller_p->control_delta.x < 0 ? SIM_INPUT_LEFT : 0u;
+  input |= controller_p->control_delta.x > 0 ? SIM_INPUT_RIGHT : 0u;
+  input |= controller_p->b_is_placing_bomb == true ? SIM_INPUT_BOMB : 0u;
+  return input;
+}
+
+void
+write_sim_input (ecs_world_t *world, ecs_entity_t controller, Uint8 input)
+{
+  controller_c *controller_p = ecs_get_mut (world, controller, controller_c);
+  controller_p->control_delta.x = ((input & SIM_INPUT_RIGHT) != 0u ? 1 : 0)
+                                  - ((input & SIM_INPUT_LEFT) != 0u ? 1 : 0);
+  controller_p->control_delta.y = ((input & SIM_INPUT_DOWN) != 0u ? 1 : 0)
+                                  - ((input & SIM_INPUT_UP) != 0u ? 1 : 0);
+  controller_p->b_is_placing_bomb = (input & SIM_INPUT_BOMB) != 0u;
+}
+
+ecs_entity_t
+get_player_controller (ecs_world_t *world, Sint32 player)
+{
+  SDL_assert (player >= 0 && player < SIM_MAX_PLAYERS);
+  const game_s *game = ecs_singleton_get (world, game_s);
+  return game->players[player];
+}
@@ -0,0 +1,326 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Simulation library: everything needed to run a match without presenting
+ *  it. Both the windowed game and the headless runner link against it. */
+
+#ifndef BOMBERMAN_SIM_H
+#define BOMBERMAN_SIM_H
+
+#include "SDL3/SDL.h"
+
+/* Pluto framework. */
+#include "pluto.h"
+
+/* M*Lib containers. */
+#include "m-array.h"
+#include "m-dict.h"
+
+#include "blast.h"
+#include "danger_map.h"
+#include "entity_pool.h"
+#include "flow_field.h"
+#include "grid.h"
+#include "job_pool.h"
+#include "map_file.h"
+#include "occupancy.h"
+#include "profiler.h"
+#include "replay.h"
+#include "rng.h"
+#include "snapshot.h"
+#include "tilemap.h"
+#include "timing_wheel.h"
+
+#define CELL_SIZE 32
+#define CHUNK_WIDTH (CELL_SIZE * GRID_CHUNK_SIZE) /* Pixels per chunk side. */
+#define VIEW_CELL_COUNT_W 15
+#define VIEW_CELL_COUNT_H 15
+#define LOGIC_WIDTH (CELL_SIZE * VIEW_CELL_COUNT_W)
+#define LOGIC_HEIGHT (CELL_SIZE * VIEW_CELL_COUNT_H)
+
+#define BOMB_DEFAULT_BLAST_RANGE 2 /* Cells reached past the bomb's own. */
+#define BRAIN_JOB_CHUNK 256        /* Brains evaluated per worker job. */
+#define BRAIN_DANGER_HORIZON 30 /* Brains keep out of cells burning sooner. */
+#define SIM_MAX_PLAYERS 2
+#define SIM_TICK_RATE 60 /* Ticks per second, whatever the frame rate. */
+#define SIM_TICK_NS ((Uint64)SDL_NS_PER_SECOND / SIM_TICK_RATE)
+
+/* A player controller's input for one tick, packed in a byte so it can be
+ * sent over the network. See read_sim_input. */
+enum sim_input_bits
+{
+  SIM_INPUT_UP = 1u << 0,
+  SIM_INPUT_DOWN = 1u << 1,
+  SIM_INPUT_LEFT = 1u << 2,
+  SIM_INPUT_RIGHT = 1u << 3,
+  SIM_INPUT_BOMB = 1u << 4
+};
+
+/* Pools recycling the short-lived grid objects, see game_s.pools. */
+enum sim_pool
+{
+  SIM_POOL_NONE = -1,
+  SIM_POOL_BOMBS,
+  SIM_POOL_EXPLOSIONS,
+  SIM_POOL_COUNT
+};
+
+/* A bomb that went off this tick, waiting for the batched blast pass. */
+struct detonation
+{
+  ecs_entity_t instigator;
+  Sint32 range;
+  struct blast_cross cross;
+};
+
+ARRAY_DEF (arr_detonation, struct detonation, M_POD_OPLIST)
+
+/* Move decided by a brain, applied once every brain has been evaluated. */
+struct brain_intent
+{
+  ecs_entity_t pawn;
+  Uint64 stream; /* See brain_c. */
+  SDL_Point cell;
+  SDL_Point delta;
+};
+
+ARRAY_DEF (arr_brain_intent, struct brain_intent, M_POD_OPLIST)
+
+/* Row-major cell indices. */
+ARRAY_DEF (arr_cell, Sint32, M_BASIC_OPLIST)
+
+ARRAY_DEF (arr_timer, struct timing_wheel_timer, M_POD_OPLIST)
+
+/* Live bomb entities, keyed on their row-major cell index. */
+DICT_DEF2 (dict_cell_to_bomb, Sint32, M_BASIC_OPLIST, ecs_entity_t,
+           M_BASIC_OPLIST)
+
+/* Pre-resolved handles, filled once at startup so the per-tick code never
+ * looks anything up by name. */
+struct sim_handles
+{
+  ecs_entity_t instigator;
+  ecs_entity_t bomb_pfb;
+  ecs_entity_t explosion_pfb;
+  ecs_entity_t rock_pfb;
+  ecs_query_t *all_characters;
+  ecs_query_t *every_character; /* Dead ones included. */
+  ecs_query_t *all_brains;
+  ecs_query_t *all_bombers;
+  ecs_entity_t lifetime_system;
+  ecs_entity_t detonation_system;
+};
+
+/* Game-specific components. */
+typedef struct singleton_game
+{
+  ecs_entity_t players[SIM_MAX_PLAYERS]; /* Their controllers. */
+  ecs_entity_t AI;
+  ecs_entity_t camera;
+  Uint64 seed; /* Match seed, every random stream derives from it. */
+  struct grid grid; /* Authoritative cell flags, see grid.h. */
+  struct blast_board blast;         /* Blocked cells as row/column masks. */
+  struct danger_map danger;         /* When pending blasts reach each cell. */
+  arr_detonation_t detonations;     /* Bombs gone off during this tick. */
+  dict_cell_to_bomb_t bombs;
+  struct timing_wheel timers; /* Lifetime expiries, one tick per advance. */
+  struct entity_pool pools[SIM_POOL_COUNT];
+  struct flow_field chase; /* Distance to the nearest bomber. */
+  struct occupancy occupancy; /* Live characters on each cell. */
+  arr_cell_t chase_sources; /* Bomber cells as of the last brain pass. */
+  arr_brain_intent_t intents; /* One slot per brain, see brain_intent. */
+  Uint32 brain_cooldown;      /* Ticks since the last brain pass. */
+  arr_timer_t pending;        /* Scratch list of the lifetime timers. */
+  arr_cell_t blasted_rocks;   /* Rocks hit during the current blast pass. */
+  struct job_pool *jobs;      /* Workers for the brain evaluation. */
+  bool b_has_cell_entities; /* Mirror the grid with grid_cell_pfb entities. */
+  bool b_names_map_entities; /* Name the cell entities after their cell. */
+  mat2d_entity_t cells;
+  ecs_entity_t current_scene;
+  struct sim_handles handles;
+  float tick_alpha; /* See interpolate_sim. Not part of the match state. */
+} game_s;
+
+typedef struct component_bomb_storage
+{
+  Sint8 max_count;
+  Sint8 count;
+  Sint8 blast_range;
+} bomb_storage_c;
+
+typedef struct component_brain
+{
+  bool b_is_active;
+  Uint32 stream; /* Random stream, numbered in spawn order so it does not
+                    depend on entity ids. */
+} brain_c;
+
+typedef struct component_cell_data
+{
+  bool b_is_blocked;
+  bool b_has_bomb;
+  bool b_has_explosion;
+} cell_data_c;
+
+/* A live character's slot in game_s.occupancy, which follows it from the
+ * moment it starts moving into a cell. */
+typedef struct component_occupant
+{
+  Sint32 slot; /* -1 once dead. */
+} occupant_c;
+
+/* Drawing of a character stepping between two cells, spread over the
+ * ticks until it may step again. Only read when drawing. */
+typedef struct component_glide
+{
+  SDL_Point from;
+  Uint64 start;    /* Tick the step was taken on. */
+  Uint32 duration; /* Ticks. */
+} glide_c;
+
+typedef struct component_lifetime
+{
+  Uint32 duration; /* Ticks to live, read once when the lifetime starts. */
+  Uint64 timer;    /* Handle in game_s.timers. */
+  Sint8 pool;      /* Pool taking the entity back on expiry, or none. */
+  void (*on_delete_callback) (ecs_world_t *world, ecs_entity_t ent);
+} lifetime_c;
+
+typedef struct component_controller
+{
+  SDL_Point control_delta;
+  bool b_is_placing_bomb; /* Bomb wanted this tick, placed by tick_sim. */
+  ecs_entity_t pawn;
+} controller_c;
+
+/* Singleton holding the floors, walls and rocks of the map, painted by the
+ * map view, see map_view.h. */
+typedef struct component_tilemap
+{
+  struct tilemap map;
+} tilemap_c;
+
+extern ECS_COMPONENT_DECLARE (game_s);
+
+extern ECS_COMPONENT_DECLARE (bomb_storage_c);
+extern ECS_COMPONENT_DECLARE (brain_c);
+extern ECS_COMPONENT_DECLARE (cell_data_c);
+extern ECS_COMPONENT_DECLARE (controller_c);
+extern ECS_COMPONENT_DECLARE (glide_c);
+extern ECS_COMPONENT_DECLARE (lifetime_c);
+extern ECS_COMPONENT_DECLARE (occupant_c);
+extern ECS_COMPONENT_DECLARE (tilemap_c);
+
+/**
+ * Registers the game components, hooks, prefabs, queries and systems, then
+ * creates the AI game master and the player controllers. Expects the world to
+ * already hold the Pluto components (see init_pluto).
+ */
+void init_sim (ecs_world_t *world);
+
+/**
+ * Stops the brain workers and frees the state of the match held outside
+ * flecs. Call before ecs_fini.
+ */
+void fini_sim (ecs_world_t *world);
+
+/**
+ * Sets the match seed. The same seed and inputs replay the same match.
+ */
+void seed_sim (ecs_world_t *world, Uint64 seed);
+
+/**
+ * Runs the per-tick game logic (bombs and movement of the players, AI)
+ * from the input held by the controllers. The caller is expected to
+ * follow up with ecs_progress so the game systems run as well.
+ */
+void tick_sim (ecs_world_t *world);
+
+/**
+ * Turns the game systems run by ecs_progress on or off, so a drawing pass
+ * can run the other systems without advancing the match. The phases are
+ * left alone: disabling one disables every phase depending on it.
+ */
+void enable_sim_systems (ecs_world_t *world, bool b_is_enabled);
+
+/**
+ * Sets how far into the next tick the coming frames are drawn, from 0 to 1,
+ * so characters move smoothly whatever the frame rate. Frames are drawn one
+ * tick behind the match, between its last two ticks.
+ */
+void interpolate_sim (ecs_world_t *world, float alpha);
+
+/**
+ * @return the input held by a player controller, as sim_input_bits.
+ */
+Uint8 read_sim_input (ecs_world_t *world, ecs_entity_t controller);
+
+/**
+ * Sets the input held by a player controller from sim_input_bits.
+ */
+void write_sim_input (ecs_world_t *world, ecs_entity_t controller,
+                      Uint8 input);
+
+/**
+ * @return the controller of a player, from 0 to SIM_MAX_PLAYERS - 1.
+ */
+ecs_entity_t get_player_controller (ecs_world_t *world, Sint32 player);
+
+/**
+ * Creates the entities of a map loaded with map_load. Its grid is moved into
+ * game_s and the caller's copy is left empty, its spawns are kept.
+ */
+void create_map (ecs_world_t *world, struct map *map);
+
+/**
+ * Creates the bombers of the first player_count players on the bomber spawns
+ * of the map, in order, or on fallback cells for the ones missing. The camera
+ * follows the bomber of local_player.
+ */
+void create_bombers (ecs_world_t *world, const struct map *map,
+                     Sint32 player_count, Sint32 local_player);
+
+/**
+ * Creates the AI characters spawning on the map.
+ */
+void create_characters (ecs_world_t *world, const struct map *map);
+
+/**
+ * Writes the gameplay state of the match into *state, grown as needed: the
+ * cell flags, the characters and their bombs, and the live bombs and
+ * explosions with their expiries. Meant to be called between two ticks.
+ * @return the size of the state, or 0 if it could not be stored.
+ */
+size_t snapshot_sim (ecs_world_t *world, Uint8 **state, size_t *capacity);
+
+/**
+ * @return a hash of the gameplay state snapshot_sim writes, entity ids left
+ * out. A match therefore hashes the same in builds creating different
+ * entities around it, like the game and the headless runner.
+ */
+Uint64 hash_sim (ecs_world_t *world);
+
+/**
+ * Brings the match back to a state written by snapshot_sim on the same map,
+ * read in place from an allocated buffer (or a snapshot ring).
+ * Characters deleted since cannot be brought back and are left out,
+ * characters created since are deleted.
+ * @return false if the state does not belong to this map, in which case the
+ * world is left untouched.
+ */
+bool restore_sim (ecs_world_t *world, const Uint8 *state, size_t size);
+
+/**
+ * Places a bomb on a free cell. Its instigator gets a bomb back when it goes
+ * off, taking one from them first is up to the caller (see try_place_bomb).
+ * A bomb without an instigator has the default blast range.
+ * @return false if the cell is blocked or already holds a bomb.
+ */
+bool place_bomb (ecs_world_t *world, ecs_entity_t instigator, Sint32 x,
+                 Sint32 y);
+
+void try_move_character (ecs_world_t *world, ecs_entity_t ent);
+bool try_place_bomb (ecs_world_t *world, ecs_entity_t player);
+void TEST_try_play_all_brains (ecs_world_t *world);
+void detonate_bomb (ecs_world_t *world, ecs_entity_t ent);
+void dispell_explosion (ecs_world_t *world, ecs_entity_t ent);
+
+#endif /* BOMBERMAN_SIM_H */
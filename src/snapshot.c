@@ -0,0 +1,321 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Snapshot ring. A frame's data is a list of (zero run, literal run) pairs,
+ *  both lengths as LEB128 varints followed by the literal bytes, covering
+ *  state_size bytes of XOR against the previous frame's state (or against
+ *  zeroes for a key frame). Bytes past the end of the shorter state read as
+ *  zero. */
+
+#include "snapshot.h"
+
+/* Worst case of an encoding: every pair but the first and the last skips at
+ * least 4 bytes and carries at least one, with two varints of up to 10
+ * bytes each. */
+#define ENCODED_BOUND(size) ((size) + ((size) / 5u + 2u) * 20u)
+
+static bool
+reserve (Uint8 **buffer, size_t *capacity, size_t size)
+{
+  if (size <= *capacity)
+    {
+      return true;
+    }
+
+  const size_t grown = SDL_max (size, *capacity * 2u);
+  Uint8 *data = SDL_realloc (*buffer, grown);
+  if (data == NULL)
+    {
+      return false;
+    }
+  *buffer = data;
+  *capacity = grown;
+  return true;
+}
+
+static Uint8 *
+write_varint (Uint8 *out, size_t value)
+{
+  while (value >= 0x80u)
+    {
+      *out++ = (Uint8)(value | 0x80u);
+      value >>= 7;
+    }
+  *out++ = (Uint8)value;
+  return out;
+}
+
+static const Uint8 *
+read_varint (const Uint8 *in, size_t *value)
+{
+  size_t result = 0u;
+  Sint32 shift = 0;
+  while ((*in & 0x80u) != 0u)
+    {
+      result |= (size_t)(*in++ & 0x7Fu) << shift;
+      shift += 7;
+    }
+  *value = result | ((size_t)*in++ << shift);
+  return in;
+}
+
+static Uint8
+byte_at (const Uint8 *state, size_t size, size_t i)
+{
+  return i < size ? state[i] : 0u;
+}
+
+/* Encodes state against base, which may be NULL for a key frame. */
+static size_t
+encode (Uint8 *out, const Uint8 *state, size_t size, const Uint8 *base,
+        size_t base_size)
+{
+  Uint8 *cursor = out;
+  size_t i = 0u;
+  while (i < size)
+    {
+      const size_t zero_start = i;
+      while (i < size && state[i] == byte_at (base, base_size, i))
+        {
+          i++;
+        }
+
+      /* A literal swallows matching runs shorter than 4 bytes, a new pair
+       * would cost more than it saves. */
+      const size_t literal_start = i;
+      size_t literal_end = i;
+      size_t matches = 0u;
+      while (i < size && matches < 4u)
+        {
+          if (state[i] == byte_at (base, base_size, i))
+            {
+              matches++;
+            }
+          else
+            {
+              matches = 0u;
+              literal_end = i + 1u;
+            }
+          i++;
+        }
+      i = literal_end;
+
+      cursor = write_varint (cursor, literal_start - zero_start);
+      cursor = write_varint (cursor, literal_end - literal_start);
+      for (size_t k = literal_start; k < literal_end; k++)
+        {
+          *cursor++ = state[k] ^ byte_at (base, base_size, k);
+        }
+    }
+  return (size_t)(cursor - out);
+}
+
+/* XORs a frame onto out, which already holds the previous state. */
+static void
+apply (Uint8 *out, const struct snapshot_frame *frame)
+{
+  const Uint8 *cursor = frame->data;
+  const Uint8 *end = frame->data + frame->size;
+  size_t i = 0u;
+  while (cursor < end)
+    {
+      size_t zeros = 0u;
+      size_t literals = 0u;
+      cursor = read_varint (cursor, &zeros);
+      cursor = read_varint (cursor, &literals);
+      i += zeros;
+      for (size_t k = 0u; k < literals; k++)
+        {
+          out[i++] ^= *cursor++;
+        }
+    }
+}
+
+static struct snapshot_frame *
+frame_at (const struct snapshot_ring *ring, Sint32 n)
+{
+  return &ring->frames[(ring->oldest + n) % ring->frame_count];
+}
+
+/**
+ * @return the position of a tick from the oldest frame, or -1.
+ */
+static Sint32
+find (const struct snapshot_ring *ring, Uint64 tick)
+{
+  for (Sint32 n = ring->count - 1; n >= 0; n--)
+    {
+      const Uint64 frame_tick = frame_at (ring, n)->tick;
+      if (frame_tick == tick)
+        {
+          return n;
+        }
+      if (frame_tick < tick)
+        {
+          break;
+        }
+    }
+  return -1;
+}
+
+/**
+ * Replays the frames from the closest key frame up to position n into
+ * ring->scratch.
+ * @return the size of the state, or 0 if no key frame precedes it.
+ */
+static size_t
+decode (struct snapshot_ring *ring, Sint32 n)
+{
+  Sint32 key = n;
+  while (key >= 0 && frame_at (ring, key)->b_is_key == false)
+    {
+      key--;
+    }
+  if (key < 0)
+    {
+      return 0u;
+    }
+
+  size_t capacity = 0u;
+  for (Sint32 k = key; k <= n; k++)
+    {
+      capacity = SDL_max (capacity, frame_at (ring, k)->state_size);
+    }
+  if (reserve (&ring->scratch, &ring->scratch_capacity, capacity) == false)
+    {
+      return 0u;
+    }
+
+  SDL_memset (ring->scratch, 0, capacity);
+  for (Sint32 k = key; k <= n; k++)
+    {
+      const struct snapshot_frame *frame = frame_at (ring, k);
+      apply (ring->scratch, frame);
+      /* A shorter state ends there, the next one grows from zeroes. */
+      SDL_memset (ring->scratch + frame->state_size, 0,
+                  capacity - frame->state_size);
+    }
+  return frame_at (ring, n)->state_size;
+}
+
+bool
+snapshot_ring_init (struct snapshot_ring *ring, Sint32 frame_count)
+{
+  snapshot_ring_free (ring);
+
+  ring->frames = SDL_calloc ((size_t)SDL_max (frame_count, 1),
+                             sizeof (struct snapshot_frame));
+  if (ring->frames == NULL)
+    {
+      return false;
+    }
+  ring->frame_count = SDL_max (frame_count, 1);
+  return true;
+}
+
+void
+snapshot_ring_free (struct snapshot_ring *ring)
+{
+  for (Sint32 i = 0; i < ring->frame_count; i++)
+    {
+      SDL_free (ring->frames[i].data);
+    }
+  SDL_free (ring->frames);
+  SDL_free (ring->last);
+  SDL_free (ring->scratch);
+  SDL_zerop (ring);
+}
+
+bool
+snapshot_ring_push (struct snapshot_ring *ring, Uint64 tick,
+                    const Uint8 *state, size_t size)
+{
+  const bool b_is_key = ring->count == 0
+                        || ring->since_key + 1 >= SNAPSHOT_KEY_INTERVAL;
+  if (reserve (&ring->scratch, &ring->scratch_capacity, ENCODED_BOUND (size))
+          == false
+      || reserve (&ring->last, &ring->last_capacity, size) == false)
+    {
+      return false;
+    }
+  const size_t encoded_size
+      = b_is_key == true ? encode (ring->scratch, state, size, NULL, 0u)
+                         : encode (ring->scratch, state, size, ring->last,
+                                   ring->last_size);
+
+  /* Frames are sized to their encoding, a slot which held a key frame must
+   * not keep its room once it holds a delta. */
+  const Sint32 slot = (ring->oldest + ring->count) % ring->frame_count;
+  struct snapshot_frame *frame = &ring->frames[slot];
+  Uint8 *data = SDL_realloc (frame->data, SDL_max (encoded_size, (size_t)1u));
+  if (data == NULL)
+    {
+      return false;
+    }
+  SDL_memcpy (data, ring->scratch, encoded_size);
+  frame->data = data;
+  frame->size = encoded_size;
+  frame->tick = tick;
+  frame->b_is_key = b_is_key;
+  frame->state_size = size;
+
+  SDL_memcpy (ring->last, state, size);
+  ring->last_size = size;
+  ring->since_key = b_is_key == true ? 0 : ring->since_key + 1;
+  if (ring->count == ring->frame_count)
+    {
+      ring->oldest = (ring->oldest + 1) % ring->frame_count;
+    }
+  else
+    {
+      ring->count++;
+    }
+  return true;
+}
+
+const Uint8 *
+snapshot_ring_get (struct snapshot_ring *ring, Uint64 tick, size_t *size)
+{
+  const Sint32 n = find (ring, tick);
+  if (n < 0)
+    {
+      return NULL;
+    }
+  *size = decode (ring, n);
+  return *size > 0u ? ring->scratch : NULL;
+}
+
+bool
+snapshot_ring_rewind (struct snapshot_ring *ring, Uint64 tick)
+{
+  const Sint32 n = find (ring, tick);
+  if (n < 0)
+    {
+      return false;
+    }
+  const size_t size = decode (ring, n);
+  if (size == 0u
+      || reserve (&ring->last, &ring->last_capacity, size) == false)
+    {
+      return false;
+    }
+
+  SDL_memcpy (ring->last, ring->scratch, size);
+  ring->last_size = size;
+  ring->count = n + 1;
+  ring->since_key = 0;
+  while (frame_at (ring, n - ring->since_key)->b_is_key == false)
+    {
+      ring->since_key++;
+    }
+  return true;
+}
+
+size_t
+snapshot_ring_bytes (const struct snapshot_ring *ring)
+{
+  size_t bytes = 0u;
+  for (Sint32 n = 0; n < ring->count; n++)
+    {
+      bytes += frame_at (ring, n)->size;
+    }
+  return bytes;
+}
@@ -0,0 +1,80 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Snapshot ring: a history of opaque state buffers, one per tick. Each
+ *  frame is stored as the XOR of its state against the previous frame's,
+ *  with the runs of zero bytes squeezed out. Consecutive ticks barely differ,
+ *  so a frame usually costs a few dozen bytes. Every SNAPSHOT_KEY_INTERVAL
+ *  frames a key frame is taken against nothing, which bounds how many deltas
+ *  a lookup has to replay. See snapshot_sim for the state itself. */
+
+#ifndef BOMBERMAN_SNAPSHOT_H
+#define BOMBERMAN_SNAPSHOT_H
+
+#include "SDL3/SDL.h"
+
+#define SNAPSHOT_KEY_INTERVAL 32
+#define SNAPSHOT_HISTORY_FRAMES 640 /* Over 10 s of ticks at 60 per second. */
+
+struct snapshot_frame
+{
+  Uint64 tick;
+  Uint8 *data; /* Encoded delta, see snapshot.c. */
+  size_t size;
+  size_t state_size; /* Size of the decoded state. */
+  bool b_is_key;
+};
+
+struct snapshot_ring
+{
+  struct snapshot_frame *frames;
+  Sint32 frame_count; /* Capacity of the ring. */
+  Sint32 oldest;
+  Sint32 count;
+  Sint32 since_key; /* Frames pushed since the last key frame. */
+  Uint8 *last;      /* Decoded state of the newest frame. */
+  size_t last_size;
+  size_t last_capacity;
+  Uint8 *scratch; /* Encodings, and the states snapshot_ring_get decodes. */
+  size_t scratch_capacity;
+};
+
+/**
+ * Allocates a ring keeping the last frame_count frames. Any storage
+ * previously held by the ring is released first.
+ * @return false if the allocation failed.
+ */
+bool snapshot_ring_init (struct snapshot_ring *ring, Sint32 frame_count);
+void snapshot_ring_free (struct snapshot_ring *ring);
+
+/**
+ * Appends the state of a tick, dropping the oldest frame once the ring is
+ * full. Ticks are expected to grow from one push to the next.
+ * @return false if the frame could not be stored, the ring is left as it
+ * was.
+ */
+bool snapshot_ring_push (struct snapshot_ring *ring, Uint64 tick,
+                         const Uint8 *state, size_t size);
+
+/**
+ * Decodes the state stored for a tick. The frames between the oldest one and
+ * the first key frame after it are no longer decodable, so the reachable
+ * history is at least frame_count - SNAPSHOT_KEY_INTERVAL frames long.
+ * @return the state, valid until the next call on the ring, or NULL if the
+ * tick is not available.
+ */
+const Uint8 *snapshot_ring_get (struct snapshot_ring *ring, Uint64 tick,
+                                size_t *size);
+
+/**
+ * Forgets every frame after a tick, so the next push follows it. Meant for
+ * rolling back: restore the state of the tick, then simulate and push again
+ * from there.
+ * @return false if the tick is not available, the ring is left as it was.
+ */
+bool snapshot_ring_rewind (struct snapshot_ring *ring, Uint64 tick);
+
+/**
+ * @return the bytes held by the encoded frames.
+ */
+size_t snapshot_ring_bytes (const struct snapshot_ring *ring);
+
+#endif /* BOMBERMAN_SNAPSHOT_H */
@@ -0,0 +1,181 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette */
+
+#include "sprite_batch.h"
+
+void
+sprite_batch_init (struct sprite_batch *batch)
+{
+  SDL_zerop (batch);
+}
+
+void
+sprite_batch_free (struct sprite_batch *batch)
+{
+  for (Sint32 i = 0; i < batch->bucket_count; i++)
+    {
+      SDL_free (batch->buckets[i].vertices);
+      SDL_free (batch->buckets[i].indices);
+    }
+  SDL_free (batch->buckets);
+  SDL_zerop (batch);
+}
+
+/**
+ * Makes room for one more bucket, inserted before the first bucket of a
+ * higher layer.
+ * @return the new bucket, or NULL if it could not be allocated.
+ */
+static struct sprite_batch_bucket *
+insert_bucket (struct sprite_batch *batch, SDL_Texture *texture,
+               Sint32 layer)
+{
+  if (batch->bucket_count == batch->bucket_capacity)
+    {
+      const Sint32 capacity = SDL_max (batch->bucket_capacity * 2, 8);
+      struct sprite_batch_bucket *buckets = SDL_realloc (
+          batch->buckets, (size_t)capacity * sizeof (*buckets));
+      if (buckets == NULL)
+        {
+          return NULL;
+        }
+      batch->buckets = buckets;
+      batch->bucket_capacity = capacity;
+    }
+
+  float w = 1.f;
+  float h = 1.f;
+  if (SDL_GetTextureSize (texture, &w, &h) == false || w <= 0.f || h <= 0.f)
+    {
+      return NULL;
+    }
+
+  Sint32 slot = batch->bucket_count;
+  while (slot > 0 && batch->buckets[slot - 1].layer > layer)
+    {
+      slot--;
+    }
+  SDL_memmove (&batch->buckets[slot + 1], &batch->buckets[slot],
+               (size_t)(batch->bucket_count - slot)
+                   * sizeof (*batch->buckets));
+  batch->bucket_count++;
+
+  struct sprite_batch_bucket *bucket = &batch->buckets[slot];
+  *bucket = (struct sprite_batch_bucket){
+    .texture = texture, .layer = layer, .texel = { 1.f / w, 1.f / h }
+  };
+  batch->last = slot;
+  return bucket;
+}
+
+static struct sprite_batch_bucket *
+find_bucket (struct sprite_batch *batch, SDL_Texture *texture, Sint32 layer)
+{
+  if (batch->last < batch->bucket_count)
+    {
+      struct sprite_batch_bucket *bucket = &batch->buckets[batch->last];
+      if (bucket->texture == texture && bucket->layer == layer)
+        {
+          return bucket;
+        }
+    }
+
+  for (Sint32 i = 0; i < batch->bucket_count; i++)
+    {
+      struct sprite_batch_bucket *bucket = &batch->buckets[i];
+      if (bucket->texture == texture && bucket->layer == layer)
+        {
+          batch->last = i;
+          return bucket;
+        }
+    }
+  return insert_bucket (batch, texture, layer);
+}
+
+static bool
+reserve_quads (struct sprite_batch_bucket *bucket, Sint32 count)
+{
+  if (count <= bucket->quad_capacity)
+    {
+      return true;
+    }
+
+  const Sint32 capacity = SDL_max (bucket->quad_capacity * 2, 64);
+  SDL_Vertex *vertices = SDL_realloc (
+      bucket->vertices, (size_t)capacity * 4u * sizeof (SDL_Vertex));
+  if (vertices == NULL)
+    {
+      return false;
+    }
+  bucket->vertices = vertices;
+  int *indices = SDL_realloc (bucket->indices,
+                              (size_t)capacity * 6u * sizeof (int));
+  if (indices == NULL)
+    {
+      return false;
+    }
+  bucket->indices = indices;
+
+  /* Every quad is two triangles over its own four vertices, so the index
+   * buffer never changes once written. */
+  for (Sint32 quad = bucket->quad_capacity; quad < capacity; quad++)
+    {
+      int *index = &indices[quad * 6];
+      const int first = quad * 4;
+      index[0] = first;
+      index[1] = first + 1;
+      index[2] = first + 2;
+      index[3] = first;
+      index[4] = first + 2;
+      index[5] = first + 3;
+    }
+  bucket->quad_capacity = capacity;
+  return true;
+}
+
+bool
+sprite_batch_add (struct sprite_batch *batch, SDL_Texture *texture,
+                  Sint32 layer, const SDL_FRect *src, const SDL_FRect *dst,
+                  SDL_FColor color)
+{
+  struct sprite_batch_bucket *bucket = find_bucket (batch, texture, layer);
+  if (bucket == NULL
+      || reserve_quads (bucket, bucket->quad_count + 1) == false)
+    {
+      return false;
+    }
+
+  const float u0 = src->x * bucket->texel.x;
+  const float v0 = src->y * bucket->texel.y;
+  const float u1 = (src->x + src->w) * bucket->texel.x;
+  const float v1 = (src->y + src->h) * bucket->texel.y;
+  SDL_Vertex *vertex = &bucket->vertices[bucket->quad_count * 4];
+  vertex[0] = (SDL_Vertex){ { dst->x, dst->y }, color, { u0, v0 } };
+  vertex[1] = (SDL_Vertex){ { dst->x + dst->w, dst->y }, color, { u1, v0 } };
+  vertex[2] = (SDL_Vertex){
+    { dst->x + dst->w, dst->y + dst->h }, color, { u1, v1 }
+  };
+  vertex[3] = (SDL_Vertex){ { dst->x, dst->y + dst->h }, color, { u0, v1 } };
+  bucket->quad_count++;
+  return true;
+}
+
+Sint32
+sprite_batch_flush (struct sprite_batch *batch, SDL_Renderer *renderer)
+{
+  Sint32 calls = 0;
+  for (Sint32 i = 0; i < batch->bucket_count; i++)
+    {
+      struct sprite_batch_bucket *bucket = &batch->buckets[i];
+      if (bucket->quad_count == 0)
+        {
+          continue;
+        }
+      SDL_RenderGeometry (renderer, bucket->texture, bucket->vertices,
+                          bucket->quad_count * 4, bucket->indices,
+                          bucket->quad_count * 6);
+      bucket->quad_count = 0;
+      calls++;
+    }
+  batch->draw_calls += (Uint64)calls;
+  return calls;
+}
@@ -0,0 +1,57 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Sprite batch: collects textured quads into one vertex buffer per texture
+ *  and layer, then submits each buffer with a single SDL_RenderGeometry
+ *  call. Sprites taken from the same atlas texture therefore cost one draw
+ *  call per layer, however many there are. Layers are drawn in increasing
+ *  order. Within a layer, a texture's sprites are drawn in the order they
+ *  were added, with textures in the order they first showed up.
+ *
+ *  Buffers are kept from one flush to the next, a steady scene does not
+ *  allocate. */
+
+#ifndef BOMBERMAN_SPRITE_BATCH_H
+#define BOMBERMAN_SPRITE_BATCH_H
+
+#include "SDL3/SDL.h"
+
+struct sprite_batch_bucket
+{
+  SDL_Texture *texture;
+  Sint32 layer;
+  SDL_FPoint texel; /* Size of a texel in texture coordinates. */
+  SDL_Vertex *vertices; /* 4 per quad. */
+  int *indices;         /* 6 per quad, written once per quad of capacity. */
+  Sint32 quad_count;
+  Sint32 quad_capacity;
+};
+
+struct sprite_batch
+{
+  struct sprite_batch_bucket *buckets; /* Sorted on their layer. */
+  Sint32 bucket_count;
+  Sint32 bucket_capacity;
+  Sint32 last; /* Bucket of the last sprite added, tried first. */
+  Uint64 draw_calls; /* Since the batch was initialised. */
+};
+
+void sprite_batch_init (struct sprite_batch *batch);
+void sprite_batch_free (struct sprite_batch *batch);
+
+/**
+ * Queues a sprite.
+ * @param src Part of the texture to draw, in texels.
+ * @param dst Where to draw it on the render target.
+ * @return false if the sprite could not be stored.
+ */
+bool sprite_batch_add (struct sprite_batch *batch, SDL_Texture *texture,
+                       Sint32 layer, const SDL_FRect *src,
+                       const SDL_FRect *dst, SDL_FColor color);
+
+/**
+ * Draws the queued sprites and empties the batch.
+ * @return the number of draw calls it took.
+ */
+Sint32 sprite_batch_flush (struct sprite_batch *batch,
+                           SDL_Renderer *renderer);
+
+#endif /* BOMBERMAN_SPRITE_BATCH_H */
@@ -0,0 +1,104 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette */
+
+#include "SDL3_image/SDL_image.h"
+
+#include "sprite_sheets.h"
+
+bool
+sprite_sheets_load (struct sprite_sheets *sheets, SDL_Renderer *renderer,
+                    const char *dir)
+{
+  sprite_sheets_free (sheets);
+
+  int count = 0;
+  char **names = SDL_GlobDirectory (dir, "*.png", 0u, &count);
+  const size_t capacity = SDL_max ((size_t)count, (size_t)1u);
+  SDL_Surface **surfaces = SDL_calloc (capacity, sizeof (SDL_Surface *));
+  sheets->sheets = SDL_calloc (capacity, sizeof (struct sprite_sheet));
+  if (names == NULL || surfaces == NULL || sheets->sheets == NULL)
+    {
+      count = 0;
+    }
+
+  SDL_Point cursor = { 0, 0 };
+  Sint32 row_height = 0;
+  for (int i = 0; i < count; i++)
+    {
+      char path[256];
+      SDL_snprintf (path, sizeof (path), "%s/%s", dir, names[i]);
+      SDL_Surface *surface = IMG_Load (path);
+      if (surface == NULL || surface->w > SPRITE_SHEETS_WIDTH)
+        {
+          SDL_DestroySurface (surface);
+          continue;
+        }
+      if (cursor.x + surface->w > SPRITE_SHEETS_WIDTH)
+        {
+          cursor = (SDL_Point){ 0, cursor.y + row_height };
+          row_height = 0;
+        }
+      struct sprite_sheet *sheet = &sheets->sheets[sheets->count];
+      sheet->rect = (SDL_Rect){ cursor.x, cursor.y, surface->w, surface->h };
+      SDL_strlcpy (sheet->name, names[i], sizeof (sheet->name));
+      surfaces[sheets->count++] = surface;
+      cursor.x += surface->w;
+      row_height = SDL_max (row_height, surface->h);
+    }
+
+  SDL_Surface *atlas = NULL;
+  if (sheets->count > 0)
+    {
+      atlas = SDL_CreateSurface (SPRITE_SHEETS_WIDTH, cursor.y + row_height,
+                                 SDL_PIXELFORMAT_RGBA32);
+    }
+  for (Sint32 i = 0; i < sheets->count; i++)
+    {
+      if (atlas != NULL)
+        {
+          SDL_SetSurfaceBlendMode (surfaces[i], SDL_BLENDMODE_NONE);
+          SDL_BlitSurface (surfaces[i], NULL, atlas, &sheets->sheets[i].rect);
+        }
+      SDL_DestroySurface (surfaces[i]);
+    }
+  if (atlas != NULL)
+    {
+      sheets->texture = SDL_CreateTextureFromSurface (renderer, atlas);
+      SDL_DestroySurface (atlas);
+    }
+  if (sheets->texture != NULL)
+    {
+      /* The sheets touch each other, filtering would bleed them into their
+       * neighbours wherever a sprite lands between two pixels. */
+      SDL_SetTextureScaleMode (sheets->texture, SDL_SCALEMODE_NEAREST);
+    }
+  SDL_free (surfaces);
+  SDL_free (names);
+
+  if (sheets->texture == NULL)
+    {
+      sprite_sheets_free (sheets);
+      return false;
+    }
+  return true;
+}
+
+void
+sprite_sheets_free (struct sprite_sheets *sheets)
+{
+  SDL_DestroyTexture (sheets->texture);
+  SDL_free (sheets->sheets);
+  SDL_zerop (sheets);
+}
+
+const struct sprite_sheet *
+sprite_sheets_find (const struct sprite_sheets *sheets, const char *name)
+{
+  for (Sint32 i = 0; i < sheets->count; i++)
+    {
+      if (SDL_strcmp (sheets->sheets[i].name, name) == 0)
+        {
+          return &sheets->sheets[i];
+        }
+    }
+  return NULL;
+}
@@ -0,0 +1,42 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Sprite sheets: packs the PNG sheets of a directory, row by row, into one
+ *  atlas texture, so everything drawn from them can go through a single
+ *  sprite_batch bucket per layer. Sheets wider than SPRITE_SHEETS_WIDTH are
+ *  left out. The atlas is sampled without filtering. */
+
+#ifndef BOMBERMAN_SPRITE_SHEETS_H
+#define BOMBERMAN_SPRITE_SHEETS_H
+
+#include "SDL3/SDL.h"
+
+#define SPRITE_SHEETS_WIDTH 2048 /* Texels per row of the atlas. */
+
+struct sprite_sheet
+{
+  char name[64]; /* File name, like the sprite_c names. */
+  SDL_Rect rect; /* Place in the atlas. */
+};
+
+struct sprite_sheets
+{
+  SDL_Texture *texture;
+  struct sprite_sheet *sheets;
+  Sint32 count;
+};
+
+/**
+ * Loads every sheet of a directory into an atlas texture of a renderer.
+ * Any sheets previously held are released first.
+ * @return false if no sheet could be packed.
+ */
+bool sprite_sheets_load (struct sprite_sheets *sheets, SDL_Renderer *renderer,
+                         const char *dir);
+void sprite_sheets_free (struct sprite_sheets *sheets);
+
+/**
+ * @return the sheet of a file name, or NULL if it was not packed.
+ */
+const struct sprite_sheet *
+sprite_sheets_find (const struct sprite_sheets *sheets, const char *name);
+
+#endif /* BOMBERMAN_SPRITE_SHEETS_H */
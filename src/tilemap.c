@@ -0,0 +1,111 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette */
+
+#include "tilemap.h"
+
+bool
+tilemap_init (struct tilemap *map, const struct grid *grid)
+{
+  tilemap_free (map);
+
+  map->cell_count = grid_cell_count (grid);
+  const size_t count = SDL_max ((size_t)map->cell_count, (size_t)1u);
+  map->tiles = SDL_malloc (count);
+  map->dirty = SDL_malloc (count * sizeof (Sint32));
+  map->taken = SDL_malloc (count * sizeof (Sint32));
+  if (map->tiles == NULL || map->dirty == NULL || map->taken == NULL)
+    {
+      tilemap_free (map);
+      return false;
+    }
+
+  for (Sint32 i = 0; i < map->cell_count; i++)
+    {
+      map->tiles[i] = tilemap_tile_of (grid->cells[i]);
+    }
+  return true;
+}
+
+void
+tilemap_free (struct tilemap *map)
+{
+  SDL_free (map->tiles);
+  SDL_free (map->dirty);
+  SDL_free (map->taken);
+  SDL_zerop (map);
+}
+
+Uint8
+tilemap_tile_of (Uint8 flags)
+{
+  if ((flags & GRID_CELL_VOID) != 0u)
+    {
+      return TILE_NONE;
+    }
+  if ((flags & GRID_CELL_ROCK) != 0u)
+    {
+      return TILE_ROCK;
+    }
+  return (flags & GRID_CELL_BLOCKED) != 0u ? TILE_WALL : TILE_FLOOR;
+}
+
+void
+tilemap_set (struct tilemap *map, Sint32 cell, Uint8 tile)
+{
+  if (cell < 0 || cell >= map->cell_count || tilemap_get (map, cell) == tile)
+    {
+      return;
+    }
+  map->tiles[cell] = (Uint8)(tile | (map->tiles[cell] & TILEMAP_DIRTY));
+  tilemap_mark (map, cell);
+}
+
+void
+tilemap_mark (struct tilemap *map, Sint32 cell)
+{
+  /* Cells past the cursor are painted on their turn anyway. */
+  if (cell < 0 || cell >= map->cursor
+      || (map->tiles[cell] & TILEMAP_DIRTY) != 0u)
+    {
+      return;
+    }
+  map->tiles[cell] |= TILEMAP_DIRTY;
+  map->dirty[map->dirty_count++] = cell;
+}
+
+void
+tilemap_mark_all (struct tilemap *map, Uint8 tile)
+{
+  for (Sint32 i = 0; i < map->cursor; i++)
+    {
+      if (tilemap_get (map, i) == tile)
+        {
+          tilemap_mark (map, i);
+        }
+    }
+}
+
+Sint32
+tilemap_take (struct tilemap *map)
+{
+  /* The listed cells are all below the cursor and listed once, so the two
+   * together never outnumber the cells. */
+  Sint32 *cells = map->taken;
+  Sint32 count = 0;
+  while (map->dirty_count > 0)
+    {
+      const Sint32 cell = map->dirty[--map->dirty_count];
+      map->tiles[cell] &= (Uint8)~TILEMAP_DIRTY;
+      if (tilemap_get (map, cell) != TILE_NONE)
+        {
+          cells[count++] = cell;
+        }
+    }
+  for (; map->cursor < map->cell_count; map->cursor++)
+    {
+      if (tilemap_get (map, map->cursor) != TILE_NONE)
+        {
+          cells[count++] = map->cursor;
+        }
+    }
+  return count;
+}
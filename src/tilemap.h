@@ -0,0 +1,83 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Tilemap: the static geometry of the map (floors, walls and rocks) as one
+ *  tile id per cell, in place of an entity per floor and per block. The ids
+ *  follow the cell flags of the grid and the tilemap keeps track of the
+ *  cells to paint: every stored cell once, then the cells whose tile
+ *  changed, each listed once however often it did. Like the danger map, it
+ *  is addressed with the dense cell indices of its grid. Painting itself is
+ *  left to the caller, see tilemap_take. */
+
+#ifndef BOMBERMAN_TILEMAP_H
+#define BOMBERMAN_TILEMAP_H
+
+#include "SDL3/SDL.h"
+
+#include "grid.h"
+
+#define TILEMAP_DIRTY 0x80u /* Flag of the listed cells, over their id. */
+
+enum tile_id
+{
+  TILE_NONE, /* Outside the map, never painted. */
+  TILE_FLOOR,
+  TILE_WALL, /* Over a floor. */
+  TILE_ROCK, /* Over a floor. */
+  TILE_COUNT
+};
+
+struct tilemap
+{
+  Uint8 *tiles; /* A tile_id per cell, TILEMAP_DIRTY once listed. */
+  Sint32 cell_count;
+  Sint32 *dirty; /* Cells to paint again, cell_count long. */
+  Sint32 dirty_count;
+  Sint32 cursor; /* Cells from here on were never painted. */
+  Sint32 *taken; /* Cells handed out by tilemap_take, cell_count long. */
+};
+
+/**
+ * Allocates a tilemap over the stored cells of a grid, with the tiles of
+ * their flags, none of them painted yet. Any storage previously held by the
+ * tilemap is released first.
+ * @return false if the allocation failed.
+ */
+bool tilemap_init (struct tilemap *map, const struct grid *grid);
+void tilemap_free (struct tilemap *map);
+
+/**
+ * @return the tile of a cell with the given flags.
+ */
+Uint8 tilemap_tile_of (Uint8 flags);
+
+/**
+ * @return the tile of a cell.
+ */
+static inline Uint8
+tilemap_get (const struct tilemap *map, Sint32 cell)
+{
+  return (Uint8)(map->tiles[cell] & ~TILEMAP_DIRTY);
+}
+
+/**
+ * Sets the tile of a cell, and lists it to paint again if it changed.
+ */
+void tilemap_set (struct tilemap *map, Sint32 cell, Uint8 tile);
+
+/**
+ * Lists a cell to paint again, whether its tile changed or not.
+ */
+void tilemap_mark (struct tilemap *map, Sint32 cell);
+
+/**
+ * Lists every cell of a tile to paint again.
+ */
+void tilemap_mark_all (struct tilemap *map, Uint8 tile);
+
+/**
+ * Hands out every cell to paint, the changed ones first, into map->taken,
+ * and considers them painted. Cells with no tile are skipped.
+ * @return the number of cells written to map->taken.
+ */
+Sint32 tilemap_take (struct tilemap *map);
+
+#endif /* BOMBERMAN_TILEMAP_H */
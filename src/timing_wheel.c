@@ -0,0 +1,304 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Hierarchical timing wheel. */
+
+#include "timing_wheel.h"
+
+#define SLOT_MASK (TIMING_WHEEL_SLOTS - 1)
+#define LEVEL_SPAN(level)                                                     \
+  ((Uint64)1u << (TIMING_WHEEL_SLOT_BITS * ((level) + 1)))
+#define SLOT_INDEX(level, expiry)                                             \
+  ((level) * TIMING_WHEEL_SLOTS                                               \
+   + (Sint32)(((expiry) >> (TIMING_WHEEL_SLOT_BITS * (level))) & SLOT_MASK))
+
+#define HANDLE_OF(index, generation)                                          \
+  (((Uint64)(generation) << 32) | (Uint64)((index) + 1))
+
+static void
+link_node (struct timing_wheel *wheel, Sint32 index)
+{
+  struct timing_wheel_node *node = &wheel->nodes[index];
+  const Uint64 delta = node->expiry - wheel->now;
+
+  Sint32 level = 0;
+  while (level < TIMING_WHEEL_LEVELS - 1 && delta >= LEVEL_SPAN (level))
+    {
+      level++;
+    }
+
+  /* Past the top level, park the timer in the slot which cascades last; it
+   * is filed again from there. */
+  Uint64 expiry = node->expiry;
+  if (delta >= LEVEL_SPAN (TIMING_WHEEL_LEVELS - 1))
+    {
+      expiry = wheel->now + LEVEL_SPAN (TIMING_WHEEL_LEVELS - 1) - 1u;
+    }
+
+  const Sint32 slot = SLOT_INDEX (level, expiry);
+  node->slot = slot;
+  node->prev = -1;
+  node->next = wheel->slots[slot];
+  if (node->next >= 0)
+    {
+      wheel->nodes[node->next].prev = index;
+    }
+  wheel->slots[slot] = index;
+}
+
+static void
+unlink_node (struct timing_wheel *wheel, Sint32 index)
+{
+  struct timing_wheel_node *node = &wheel->nodes[index];
+  if (node->prev >= 0)
+    {
+      wheel->nodes[node->prev].next = node->next;
+    }
+  else
+    {
+      wheel->slots[node->slot] = node->next;
+    }
+  if (node->next >= 0)
+    {
+      wheel->nodes[node->next].prev = node->prev;
+    }
+}
+
+static void
+release_node (struct timing_wheel *wheel, Sint32 index)
+{
+  struct timing_wheel_node *node = &wheel->nodes[index];
+  node->slot = -1;
+  node->generation++;
+  node->next = wheel->free_head;
+  wheel->free_head = index;
+}
+
+/* Re-files every timer of a slot relative to the current tick. */
+static void
+cascade (struct timing_wheel *wheel, Sint32 slot)
+{
+  Sint32 index = wheel->slots[slot];
+  wheel->slots[slot] = -1;
+  while (index >= 0)
+    {
+      const Sint32 next = wheel->nodes[index].next;
+      link_node (wheel, index);
+      index = next;
+    }
+}
+
+static bool
+reserve_expired (struct timing_wheel *wheel, size_t count)
+{
+  if (count <= wheel->expired_capacity)
+    {
+      return true;
+    }
+
+  size_t capacity = SDL_max (wheel->expired_capacity * 2u, (size_t)64u);
+  while (capacity < count)
+    {
+      capacity *= 2u;
+    }
+  Uint64 *expired = SDL_realloc (wheel->expired, capacity * sizeof (Uint64));
+  if (expired == NULL)
+    {
+      return false;
+    }
+  wheel->expired = expired;
+  Uint64 *seqs = SDL_realloc (wheel->expired_seqs, capacity * sizeof (Uint64));
+  if (seqs == NULL)
+    {
+      return false;
+    }
+  wheel->expired_seqs = seqs;
+  wheel->expired_capacity = capacity;
+  return true;
+}
+
+void
+timing_wheel_init (struct timing_wheel *wheel, Uint64 now)
+{
+  SDL_zerop (wheel);
+  wheel->now = now;
+  wheel->free_head = -1;
+  for (Sint32 i = 0; i < TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS; i++)
+    {
+      wheel->slots[i] = -1;
+    }
+}
+
+void
+timing_wheel_free (struct timing_wheel *wheel)
+{
+  SDL_free (wheel->nodes);
+  SDL_free (wheel->expired);
+  SDL_free (wheel->expired_seqs);
+  timing_wheel_init (wheel, 0u);
+}
+
+void
+timing_wheel_reset (struct timing_wheel *wheel, Uint64 now)
+{
+  for (Sint32 i = 0; i < wheel->node_count; i++)
+    {
+      if (wheel->nodes[i].slot >= 0)
+        {
+          release_node (wheel, i);
+        }
+    }
+  for (Sint32 i = 0; i < TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS; i++)
+    {
+      wheel->slots[i] = -1;
+    }
+  wheel->now = now;
+}
+
+Uint64
+timing_wheel_schedule (struct timing_wheel *wheel, Uint64 expiry,
+                       Uint64 payload)
+{
+  Sint32 index = wheel->free_head;
+  if (index >= 0)
+    {
+      wheel->free_head = wheel->nodes[index].next;
+    }
+  else
+    {
+      if (wheel->node_count == wheel->node_capacity)
+        {
+          const Sint32 capacity = SDL_max (wheel->node_capacity * 2, 64);
+          struct timing_wheel_node *nodes = SDL_realloc (
+              wheel->nodes, (size_t)capacity * sizeof (*nodes));
+          if (nodes == NULL)
+            {
+              return 0u;
+            }
+          wheel->nodes = nodes;
+          wheel->node_capacity = capacity;
+        }
+      index = wheel->node_count++;
+      wheel->nodes[index].generation = 0u;
+    }
+
+  struct timing_wheel_node *node = &wheel->nodes[index];
+  node->expiry = SDL_max (expiry, wheel->now + 1u);
+  node->payload = payload;
+  node->seq = wheel->next_seq++;
+  link_node (wheel, index);
+
+  return HANDLE_OF (index, node->generation);
+}
+
+bool
+timing_wheel_cancel (struct timing_wheel *wheel, Uint64 handle)
+{
+  const Sint32 index = (Sint32)(handle & 0xFFFFFFFFu) - 1;
+  if (index < 0 || index >= wheel->node_count)
+    {
+      return false;
+    }
+
+  struct timing_wheel_node *node = &wheel->nodes[index];
+  if (node->slot < 0 || HANDLE_OF (index, node->generation) != handle)
+    {
+      return false;
+    }
+
+  unlink_node (wheel, index);
+  release_node (wheel, index);
+  return true;
+}
+
+/* Insertion sort on the scheduling order: a tick's batch is small and the
+ * cascades leave it nearly sorted already. */
+static void
+sort_expired (struct timing_wheel *wheel, size_t count)
+{
+  for (size_t i = 1; i < count; i++)
+    {
+      const Uint64 seq = wheel->expired_seqs[i];
+      const Uint64 payload = wheel->expired[i];
+      size_t j = i;
+      while (j > 0 && wheel->expired_seqs[j - 1] > seq)
+        {
+          wheel->expired_seqs[j] = wheel->expired_seqs[j - 1];
+          wheel->expired[j] = wheel->expired[j - 1];
+          j--;
+        }
+      wheel->expired_seqs[j] = seq;
+      wheel->expired[j] = payload;
+    }
+}
+
+const Uint64 *
+timing_wheel_advance (struct timing_wheel *wheel, size_t *count)
+{
+  wheel->now++;
+
+  /* Pull the upper levels down, innermost first, whenever the level below
+   * wraps around. */
+  for (Sint32 level = 1; level < TIMING_WHEEL_LEVELS; level++)
+    {
+      if ((wheel->now & (LEVEL_SPAN (level - 1) - 1u)) != 0u)
+        {
+          break;
+        }
+      cascade (wheel, SLOT_INDEX (level, wheel->now));
+    }
+
+  *count = 0u;
+  const Sint32 slot = SLOT_INDEX (0, wheel->now);
+  Sint32 index = wheel->slots[slot];
+  wheel->slots[slot] = -1;
+  while (index >= 0)
+    {
+      struct timing_wheel_node *node = &wheel->nodes[index];
+      const Sint32 next = node->next;
+      if (reserve_expired (wheel, *count + 1u) == true)
+        {
+          wheel->expired[*count] = node->payload;
+          wheel->expired_seqs[*count] = node->seq;
+          (*count)++;
+        }
+      release_node (wheel, index);
+      index = next;
+    }
+
+  sort_expired (wheel, *count);
+  return wheel->expired;
+}
+
+static int
+compare_seqs (const void *a, const void *b)
+{
+  const Uint64 seq_a = ((const struct timing_wheel_timer *)a)->seq;
+  const Uint64 seq_b = ((const struct timing_wheel_timer *)b)->seq;
+  return (seq_a > seq_b) - (seq_a < seq_b);
+}
+
+size_t
+timing_wheel_pending (const struct timing_wheel *wheel,
+                      struct timing_wheel_timer *out, size_t capacity)
+{
+  size_t count = 0u;
+  for (Sint32 i = 0; i < wheel->node_count; i++)
+    {
+      const struct timing_wheel_node *node = &wheel->nodes[i];
+      if (node->slot < 0)
+        {
+          continue;
+        }
+      if (count < capacity)
+        {
+          out[count] = (struct timing_wheel_timer){ .expiry = node->expiry,
+                                                    .payload = node->payload,
+                                                    .seq = node->seq };
+        }
+      count++;
+    }
+  if (capacity > 0u)
+    {
+      SDL_qsort (out, SDL_min (count, capacity), sizeof (*out), compare_seqs);
+    }
+  return count;
+}
@@ -0,0 +1,89 @@
+/** Doomsday - A Bomberman Game by Émile Fréchette
+ *  Hierarchical timing wheel keyed on simulation ticks. Timers are filed once
+ *  when scheduled and only touched again when they cascade down a level or
+ *  expire, so advancing a tick costs as much as what actually expires. */
+
+#ifndef BOMBERMAN_TIMING_WHEEL_H
+#define BOMBERMAN_TIMING_WHEEL_H
+
+#include "SDL3/SDL.h"
+
+#define TIMING_WHEEL_LEVELS 4
+#define TIMING_WHEEL_SLOT_BITS 6
+#define TIMING_WHEEL_SLOTS (1 << TIMING_WHEEL_SLOT_BITS)
+
+struct timing_wheel_node
+{
+  Uint64 expiry;
+  Uint64 payload;
+  Uint64 seq; /* Scheduling order, used to dispatch deterministically. */
+  Uint32 generation;
+  Sint32 prev;
+  Sint32 next;
+  Sint32 slot; /* Index in the flattened slot table, -1 when free. */
+};
+
+struct timing_wheel
+{
+  Uint64 now;
+  Uint64 next_seq;
+  struct timing_wheel_node *nodes;
+  Sint32 node_count;
+  Sint32 node_capacity;
+  Sint32 free_head;
+  Sint32 slots[TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS];
+  Uint64 *expired; /* Payloads handed out by the last advance. */
+  Uint64 *expired_seqs;
+  size_t expired_capacity;
+};
+
+/* A pending timer, as listed by timing_wheel_pending. */
+struct timing_wheel_timer
+{
+  Uint64 expiry;
+  Uint64 payload;
+  Uint64 seq;
+};
+
+void timing_wheel_init (struct timing_wheel *wheel, Uint64 now);
+void timing_wheel_free (struct timing_wheel *wheel);
+
+/**
+ * Drops every pending timer and moves the wheel to a tick, backwards
+ * included. The storage is kept, and handles given out before stay stale.
+ */
+void timing_wheel_reset (struct timing_wheel *wheel, Uint64 now);
+
+/**
+ * Files a timer which fires when the wheel advances to the expiry tick.
+ * Expiries at or before the current tick fire on the next advance.
+ * @return a handle usable with timing_wheel_cancel, never 0. 0 is returned
+ * if the node pool could not grow.
+ */
+Uint64 timing_wheel_schedule (struct timing_wheel *wheel, Uint64 expiry,
+                              Uint64 payload);
+
+/**
+ * Removes a pending timer. Stale handles (already fired or cancelled) are
+ * ignored.
+ * @return true if a timer was removed.
+ */
+bool timing_wheel_cancel (struct timing_wheel *wheel, Uint64 handle);
+
+/**
+ * Moves the wheel one tick forward.
+ * @return the payloads of the timers expiring on the new tick, in the order
+ * they were scheduled. The array stays valid until the next advance.
+ */
+const Uint64 *timing_wheel_advance (struct timing_wheel *wheel,
+                                    size_t *count);
+
+/**
+ * Lists the pending timers in the order they were scheduled. Only the first
+ * capacity of them are written to out.
+ * @return the number of pending timers.
+ */
+size_t timing_wheel_pending (const struct timing_wheel *wheel,
+                             struct timing_wheel_timer *out, size_t capacity);
+
+#endif /* BOMBERMAN_TIMING_WHEEL_H */